@@ -0,0 +1,99 @@
+#ifndef __WORK_STEALING_POOL_HH
+#define __WORK_STEALING_POOL_HH
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace Maps {
+
+// Runs tasks on a fixed number of threads, the calling thread being worker 0
+// Each worker has its own deque, takes its newest task first and steals the oldest task of
+// another worker when it runs out. Tasks can push more tasks while the pool is running
+template<typename Task>
+class WorkStealingPool {
+public:
+    WorkStealingPool(unsigned int thread_count)
+    :queues_(thread_count > 0 ? thread_count : 1) {}
+
+    unsigned int thread_count() const { return queues_.size(); }
+
+    // queues a task on the given worker's deque, safe to call from within a running task
+    void push(unsigned int worker, Task task) {
+        pending_++;
+
+        Queue& queue = queues_.at(worker % queues_.size());
+        std::lock_guard lock{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // runs until every pushed task is done
+    // body is called as body(worker, task) and may be called concurrently
+    void run(auto body) {
+        auto work = [this, &body](unsigned int worker) {
+            while (pending_ > 0) {
+                auto task = take(worker);
+                if (!task) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                body(worker, std::move(*task));
+                pending_--;
+            }
+        };
+
+        std::vector<std::thread> workers{};
+        for (unsigned int worker = 1; worker < queues_.size(); worker++)
+            workers.emplace_back(work, worker);
+
+        work(0);
+
+        for (auto& thread: workers)
+            thread.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::optional<Task> take(unsigned int worker) {
+        {
+            Queue& own = queues_.at(worker);
+            std::lock_guard lock{own.mutex};
+
+            if (!own.tasks.empty()) {
+                Task task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+
+        for (size_t offset = 1; offset < queues_.size(); offset++) {
+            Queue& victim = queues_.at((worker + offset) % queues_.size());
+            std::lock_guard lock{victim.mutex};
+
+            if (!victim.tasks.empty()) {
+                Task task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return task;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::vector<Queue> queues_;
+    // pushed but not yet finished, a task's follow-ups are pushed before it counts as finished
+    std::atomic<size_t> pending_ = 0;
+};
+
+} // namespace Maps
+
+#endif
@@ -5,6 +5,7 @@
 
 #include "mapsc/ast/expression.hh"
 #include "mapsc/ast/statement.hh"
+#include "mapsc/ast/definition_body.hh"
 
 namespace Maps {
 
@@ -65,10 +66,15 @@ bool walk_statement(T visitor, Statement* statement) {
         return false;
 
     switch (statement->statement_type) {
-        case StatementType::assignment:
         case StatementType::expression_statement:
         case StatementType::return_:
             return walk_expression(visitor, get<Expression*>(statement->value));
+
+        case StatementType::assignment: {
+            auto [identifier_or_reference, body] = get<Assignment>(statement->value);
+            return walk_expression(visitor, identifier_or_reference) && 
+                walk_definition(visitor, body);
+        }
         
         case StatementType::block:
             for (Statement* sub_statement: get<Block>(statement->value)) {
@@ -77,6 +83,25 @@ bool walk_statement(T visitor, Statement* statement) {
             }
             return true;
 
+        case StatementType::conditional: {
+            auto [condition, body, else_branch] = get<ConditionalValue>(statement->value);
+            if (!walk_expression(visitor, condition) || !walk_statement(visitor, body))
+                return false;
+
+            return !else_branch || walk_statement(visitor, *else_branch);
+        }
+
+        case StatementType::loop: {
+            auto [condition, body, initializer] = get<LoopStatementValue>(statement->value);
+            if (initializer && !walk_statement(visitor, *initializer))
+                return false;
+
+            if (condition && !walk_expression(visitor, condition))
+                return false;
+
+            return walk_statement(visitor, body);
+        }
+
         default:
             return true;
     }
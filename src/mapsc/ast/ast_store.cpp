@@ -1,11 +1,138 @@
 #include "ast_store.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "common/std_visit_helper.hh"
 
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
 
 namespace Maps {
 
+namespace {
+
+std::string_view statement_kind(StatementType statement_type) {
+    switch (statement_type) {
+        case StatementType::user_error: return "user_error";
+        case StatementType::compiler_error: return "compiler_error";
+        case StatementType::deleted: return "deleted";
+        case StatementType::empty: return "empty";
+        case StatementType::expression_statement: return "expression_statement";
+        case StatementType::block: return "block";
+        case StatementType::assignment: return "assignment";
+        case StatementType::return_: return "return";
+        case StatementType::guard: return "guard";
+        case StatementType::switch_s: return "switch";
+        case StatementType::conditional: return "conditional";
+        case StatementType::loop: return "loop";
+    }
+    return "unknown";
+}
+
+std::string_view definition_kind(DefinitionType definition_type) {
+    switch (definition_type) {
+        case DefinitionType::let_definition: return "let";
+        case DefinitionType::operator_def: return "operator";
+        case DefinitionType::parameter: return "parameter";
+        case DefinitionType::discarded_parameter: return "discarded_parameter";
+        case DefinitionType::external: return "external";
+        case DefinitionType::builtin: return "builtin";
+        case DefinitionType::external_builtin: return "external_builtin";
+    }
+    return "unknown";
+}
+
+size_t payload_size(const ExpressionValue& value) {
+    return std::visit(overloaded {
+        [](const std::string& string) { return heap_bytes(string); },
+        [](const maps_MutString& string) { return static_cast<size_t>(string.mem_size); },
+        [](const TermedExpressionValue& termed) { return heap_bytes(termed.terms); },
+        [](const CallExpressionValue& call) { return heap_bytes(std::get<1>(call)); },
+        [](const TypeArgument& argument) { return heap_bytes(std::get<1>(argument)); },
+        [](const TypeConstruct& construct) { return heap_bytes(std::get<1>(construct)); },
+        [](const auto&) { return size_t{0}; }
+    }, value);
+}
+
+size_t payload_size(const StatementValue& value) {
+    return std::visit(overloaded {
+        [](const std::string& string) { return heap_bytes(string); },
+        [](const Block& block) { return heap_bytes(block); },
+        [](const SwitchStatementValue& switch_value) { return heap_bytes(switch_value.cases); },
+        [](const auto&) { return size_t{0}; }
+    }, value);
+}
+
+// calls back with every expression and statement the node points to, including the deleted ones
+void for_each_child(const std::variant<Expression*, Statement*>& node, auto callback) {
+    std::visit(overloaded {
+        [&callback](Expression* expression) {
+            std::visit(overloaded {
+                [&callback](Expression* child) { callback(child); },
+                [&callback](const TermedExpressionValue& termed) {
+                    for (Expression* term: termed.terms)
+                        callback(term);
+                },
+                [&callback](const CallExpressionValue& call) {
+                    for (Expression* arg: std::get<1>(call))
+                        callback(arg);
+                },
+                [&callback](const TernaryExpressionValue& ternary) {
+                    callback(ternary.condition);
+                    callback(ternary.success);
+                    callback(ternary.failure);
+                },
+                [&callback](const TypeArgument& argument) { callback(std::get<0>(argument)); },
+                [&callback](const TypeConstruct& construct) {
+                    callback(std::get<0>(construct));
+                    for (Expression* argument: std::get<1>(construct))
+                        callback(argument);
+                },
+                [](const auto&) {}
+            }, expression->value);
+        },
+        [&callback](Statement* statement) {
+            std::visit(overloaded {
+                [&callback](Expression* expression) { callback(expression); },
+                [&callback](const Assignment& assignment) {
+                    callback(assignment.identifier_or_reference);
+                },
+                [&callback](const Block& block) {
+                    for (Statement* sub_statement: block)
+                        callback(sub_statement);
+                },
+                [&callback](const ConditionalValue& conditional) {
+                    callback(conditional.condition);
+                    callback(conditional.body);
+                    if (conditional.else_branch)
+                        callback(*conditional.else_branch);
+                },
+                [&callback](const LoopStatementValue& loop) {
+                    callback(loop.condition);
+                    callback(loop.body);
+                    if (loop.initializer)
+                        callback(*loop.initializer);
+                },
+                [&callback](const SwitchStatementValue& switch_value) {
+                    callback(switch_value.key);
+                    for (auto [case_value, case_body]: switch_value.cases) {
+                        callback(case_value);
+                        callback(case_body);
+                    }
+                },
+                [](const auto&) {}
+            }, statement->value);
+        }
+    }, node);
+}
+
+} // anonymous namespace
+
 bool AST_Store::empty() const {
     return size() == 0;
 }
@@ -17,37 +144,216 @@ size_t AST_Store::size() const {
         statements_.size();
 }
 
+MemoryStats AST_Store::memory_stats() const {
+    MemoryStats stats{};
+
+    for (const auto& expression: expressions_) {
+        if (expression->expression_type == ExpressionType::deleted)
+            continue;
+
+        stats.add("expression:" + expression->expression_type_string(), sizeof(Expression), 
+            payload_size(expression->value));
+    }
+
+    for (const auto& statement: statements_) {
+        if (statement->statement_type == StatementType::deleted)
+            continue;
+
+        stats.add("statement:" + std::string{statement_kind(statement->statement_type)}, 
+            sizeof(Statement), payload_size(statement->value));
+    }
+
+    for (const auto& header: definition_headers_) {
+        stats.add("definition:" + std::string{definition_kind(header->definition_type_)}, 
+            header->node_size(), header->payload_size());
+    }
+
+    for (const auto& body: definition_bodies_)
+        stats.add("definition body", sizeof(DefinitionBody));
+
+    for (const auto& scope: scopes_)
+        stats.add("scope", sizeof(Scope), scope->payload_size());
+
+    stats.add_overhead(heap_bytes(expressions_) + heap_bytes(statements_) + 
+        heap_bytes(definition_headers_) + heap_bytes(definition_bodies_) + heap_bytes(scopes_));
+
+    return stats;
+}
+
 void AST_Store::delete_expression(Expression* expression) {
+    if (expression->expression_type != ExpressionType::deleted)
+        deleted_count_++;
+
     expression->expression_type = ExpressionType::deleted;
 }
+
+// the payloads of recursively deleted nodes are released too, nothing can point into them
 void AST_Store::delete_expression_recursive(Expression* expression) {
-    assert(false && "not implemented");
+    std::vector<Expression*> to_delete{expression};
+
+    while (!to_delete.empty()) {
+        Expression* current = to_delete.back();
+        to_delete.pop_back();
+
+        switch (current->expression_type) {
+            case ExpressionType::call:
+            case ExpressionType::partial_call:
+                for (Expression* arg: std::get<1>(current->call_value()))
+                    to_delete.push_back(arg);
+                break;
+
+            case ExpressionType::layer2_expression:
+                for (Expression* term: current->terms())
+                    to_delete.push_back(term);
+                break;
+
+            case ExpressionType::ternary_expression: {
+                auto [condition, success, failure] = current->ternary_value();
+                to_delete.insert(to_delete.end(), {condition, success, failure});
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        delete_expression(current);
+        current->value = std::monostate{};
+    }
 }
 
 void AST_Store::delete_statement(Statement* statement) {
+    if (statement->statement_type != StatementType::deleted)
+        deleted_count_++;
+
     statement->statement_type = StatementType::deleted;
 }
+
+size_t AST_Store::free_deleted() {
+    if (deleted_count_ == 0)
+        return 0;
+
+    deleted_count_ = 0;
+
+    using Node = std::variant<Expression*, Statement*>;
+
+    // everything reachable from the definitions, with an explicit stack since generated 
+    // expressions can nest deeply
+    std::unordered_set<const void*> reachable{};
+    std::vector<Node> to_visit{};
+
+    auto push = [&to_visit](auto node) {
+        if (node)
+            to_visit.push_back(Node{node});
+    };
+
+    for (const auto& body: definition_bodies_) {
+        std::visit(overloaded {
+            [&push](Expression* expression) { push(expression); },
+            [&push](Statement* statement) { push(statement); },
+            [](const auto&) {}
+        }, body->body());
+    }
+
+    while (!to_visit.empty()) {
+        Node node = to_visit.back();
+        to_visit.pop_back();
+
+        const void* address = std::visit([](auto node) -> const void* { return node; }, node);
+        if (!reachable.insert(address).second)
+            continue;
+
+        for_each_child(node, push);
+    }
+
+    size_t freed = 0;
+    auto is_garbage = [&reachable, &freed](const auto& node, bool is_deleted) {
+        if (!is_deleted || reachable.contains(node.get()))
+            return false;
+
+        freed++;
+        return true;
+    };
+
+    std::erase_if(expressions_, [&is_garbage](const std::unique_ptr<Expression>& expression) {
+        return is_garbage(expression, expression->expression_type == ExpressionType::deleted);
+    });
+    std::erase_if(statements_, [&is_garbage](const std::unique_ptr<Statement>& statement) {
+        return is_garbage(statement, statement->statement_type == StatementType::deleted);
+    });
+
+    Profiler::count(ProfilerCounter::nodes_freed, freed);
+    return freed;
+}
+
 void AST_Store::delete_statement_recursive(Statement* statement) {
-    assert(false && "not implemented");
+    std::vector<Statement*> to_delete{statement};
+
+    while (!to_delete.empty()) {
+        Statement* current = to_delete.back();
+        to_delete.pop_back();
+
+        switch (current->statement_type) {
+            case StatementType::expression_statement:
+            case StatementType::return_:
+                delete_expression_recursive(std::get<Expression*>(current->value));
+                break;
+
+            case StatementType::block:
+                for (Statement* sub_statement: current->get_value<Block>())
+                    to_delete.push_back(sub_statement);
+                break;
+
+            case StatementType::conditional: {
+                auto [condition, body, else_branch] = current->get_value<ConditionalValue>();
+                delete_expression_recursive(condition);
+                to_delete.push_back(body);
+                if (else_branch)
+                    to_delete.push_back(*else_branch);
+                break;
+            }
+
+            case StatementType::loop: {
+                auto [condition, body, initializer] = current->get_value<LoopStatementValue>();
+                if (condition)
+                    delete_expression_recursive(condition);
+                to_delete.push_back(body);
+                if (initializer)
+                    to_delete.push_back(*initializer);
+                break;
+            }
+
+            // assignments own definitions that may be referred to from elsewhere
+            default:
+                break;
+        }
+
+        delete_statement(current);
+        current->value = EmptyStatementValue{};
+    }
 }
 
 Expression* AST_Store::allocate_expression(const Expression&& expression) {        
+    Profiler::count(ProfilerCounter::nodes_allocated);
     expressions_.push_back(std::make_unique<Expression>(expression));
     return expressions_.back().get();
 }
 
 Statement* AST_Store::allocate_statement(const Statement&& statement) {
+    Profiler::count(ProfilerCounter::nodes_allocated);
     statements_.push_back(std::make_unique<Statement>(statement));
     return statements_.back().get();
 }
 
 DefinitionHeader* AST_Store::allocate_definition_header(RT_DefinitionHeader definition) {
     using Log = LogInContext<LogContext::definition_creation>;
+    Profiler::count(ProfilerCounter::nodes_allocated);
 
     definition_headers_.push_back(std::make_unique<RT_DefinitionHeader>(std::move(definition)));
     auto allocated_header = definition_headers_.back().get();
-    Log::debug_extra(definition.location()) << 
-        "Allocated definition header " << *allocated_header << Endl;
+    Log::debug_extra(allocated_header->location(), [allocated_header](auto& log) {
+        log << "Allocated definition header " << *allocated_header << Endl;
+    });
 
     return allocated_header;
 }
@@ -63,6 +369,7 @@ RT_DefinitionHeader header, const LetDefinitionValue& body) {
 DefinitionBody* AST_Store::allocate_definition_body(DefinitionHeader* header, 
 const LetDefinitionValue& body_value) {    
     using Log = LogInContext<LogContext::definition_creation>;
+    Profiler::count(ProfilerCounter::nodes_allocated);
 
     definition_bodies_.push_back(std::make_unique<DefinitionBody>(header, body_value));
     auto allocated_body = definition_bodies_.back().get();
@@ -77,23 +384,49 @@ const LetDefinitionValue& body_value) {
 }
 
 Operator* AST_Store::allocate_operator(RT_Operator definition) {
+    Profiler::count(ProfilerCounter::nodes_allocated);
     definition_headers_.push_back(std::make_unique<RT_Operator>(std::move(definition)));
     return dynamic_cast<Operator*>(definition_headers_.back().get());
 }
 
 Parameter* AST_Store::allocate_parameter(const Parameter&& definition) {
+    Profiler::count(ProfilerCounter::nodes_allocated);
     definition_headers_.push_back(std::make_unique<Parameter>(definition));
     return dynamic_cast<Parameter*>(definition_headers_.back().get());
 }
 
 External* AST_Store::allocate_external(const External&& definition) {
+    Profiler::count(ProfilerCounter::nodes_allocated);
     definition_headers_.push_back(std::make_unique<External>(definition));
     return dynamic_cast<External*>(definition_headers_.back().get());
 }
 
 Scope* AST_Store::allocate_scope(const Scope&& scope) {
+    Profiler::count(ProfilerCounter::nodes_allocated);
     scopes_.push_back(std::make_unique<Scope>(scope));
     return scopes_.back().get();
 }
 
+namespace {
+
+template <typename T>
+void move_append(std::vector<T>& to, std::vector<T>& from) {
+    to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+    from.clear();
+}
+
+} // anonymous namespace
+
+void AST_Store::merge(AST_Store&& other) {
+    // the nodes the other store deleted can be in either one
+    deleted_count_ += other.deleted_count_;
+    other.deleted_count_ = 0;
+
+    move_append(statements_, other.statements_);
+    move_append(expressions_, other.expressions_);
+    move_append(definition_headers_, other.definition_headers_);
+    move_append(definition_bodies_, other.definition_bodies_);
+    move_append(scopes_, other.scopes_);
+}
+
 } // namespace AST
\ No newline at end of file
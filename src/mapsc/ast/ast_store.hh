@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 
+#include "mapsc/memory_stats.hh"
 #include "mapsc/ast/definition.hh"
 #include "mapsc/ast/external.hh"
 #include "mapsc/ast/definition_body.hh"
@@ -20,13 +21,24 @@ public:
     
     bool empty() const;
     size_t size() const;
+    // walks every node so it's not free, meant for --time-report and :memstats
+    // deleted nodes that haven't been freed yet are left out
+    MemoryStats memory_stats() const;
 
+    // Deleting only tags the node, since a walk in progress might still have it queued
+    // free_deleted frees them later
     void delete_expression(Expression* expression);
     void delete_expression_recursive(Expression* expression);
 
     void delete_statement(Statement* statement);
     void delete_statement_recursive(Statement* statement);
 
+    // Frees the deleted nodes, except ones that a definition in the store still refers to, 
+    // e.g. through the terms of a termed expression that failed to parse
+    // Only safe between stages, when nothing outside the store holds on to deleted nodes.
+    // Returns the number of nodes freed
+    size_t free_deleted();
+
     Expression* allocate_expression(const Expression&& expr);
     Statement* allocate_statement(const Statement&& statement);
     DefinitionHeader* allocate_definition_header(RT_DefinitionHeader definition);
@@ -39,18 +51,24 @@ public:
 
     Scope* allocate_scope(const Scope&& scope);
 
-private:
+    // takes ownership of other's nodes, pointers to them stay valid
+    // Allocating isn't thread safe, so worker threads each allocate into a store of their own, 
+    // which gets merged into the main one once the workers are done
+    void merge(AST_Store&& other);
 
-    // currently these guys, once created, stay in memory forever
-    // we could create a way to sweep them by having some sort of "alive"-flag
-    // or maybe "DeletedStatement" statement type
-    // probably won't need that until we do the interpreter
+private:
+    // expressions and statements are freed by free_deleted, the rest stay for the life of 
+    // the store
     // TODO: move from vector of unique_ptrs to unique_ptr of vectors
     std::vector<std::unique_ptr<Statement>> statements_ = {};
     std::vector<std::unique_ptr<Expression>> expressions_ = {};
     std::vector<std::unique_ptr<DefinitionHeader>> definition_headers_ = {};
     std::vector<std::unique_ptr<DefinitionBody>> definition_bodies_ = {};
     std::vector<std::unique_ptr<Scope>> scopes_ = {};
+
+    // nodes deleted through this store since the last free_deleted, so that it can skip the 
+    // walk if there's nothing to free
+    size_t deleted_count_ = 0;
 };
 
 } // namespace Maps
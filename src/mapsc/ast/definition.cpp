@@ -7,6 +7,7 @@
 #include "common/std_visit_helper.hh"
 
 #include "mapsc/logging.hh"
+#include "mapsc/memory_stats.hh"
 
 #include "mapsc/types/type.hh"
 #include "mapsc/types/type_defs.hh"
@@ -54,6 +55,10 @@ RT_DefinitionHeader::RT_DefinitionHeader(DefinitionType definition_type, std::st
 RT_DefinitionHeader::RT_DefinitionHeader(DefinitionType definition_type, std::string name, SourceLocation location)
 :RT_DefinitionHeader(definition_type, std::move(name), &Unknown, std::move(location)){}
 
+size_t RT_DefinitionHeader::payload_size() const {
+    return heap_bytes(name_string_);
+}
+
 
 
 // ------------------------------------- FACTORY FUNTIONS -----------------------------------------
@@ -101,6 +101,10 @@ public:
 
     std::optional<LetDefinitionValue> get_body_value() const;
 
+    // for memory accounting, payload is the heap memory owned by the header
+    virtual size_t node_size() const { return sizeof(DefinitionHeader); }
+    virtual size_t payload_size() const { return 0; }
+
     bool operator==(const DefinitionHeader& other) const {
         return this == &other;
     };
@@ -160,6 +164,9 @@ public:
     RT_DefinitionHeader& operator=(RT_DefinitionHeader&&) = delete; 
     RT_DefinitionHeader& operator=(const RT_DefinitionHeader&) = delete;
 
+    virtual size_t node_size() const { return sizeof(RT_DefinitionHeader); }
+    virtual size_t payload_size() const;
+
 private:
     std::string name_string_;
 };
@@ -4,6 +4,7 @@
 #include <optional>
 #include <string_view>
 #include <variant>
+#include <vector>
 
 #include "common/std_visit_helper.hh"
 #include "common/maps_datatypes.h"
@@ -52,10 +53,19 @@ public:
     void set_type(const Type* type);
     bool set_declared_type(const Type* type);
 
+    // the parameters of a function definition in order, empty for anything else
+    const std::vector<DefinitionHeader*>& parameters() const { return parameters_; }
+    void set_parameters(std::vector<DefinitionHeader*> parameters) { 
+        parameters_ = std::move(parameters); }
+
     bool is_undefined()const { return header_->is_undefined(); }
     bool is_deleted() const { return header_->is_deleted_; }
     void mark_deleted() { header_->is_deleted_ = true; }
 
+    // new definitions start out dirty and the transform stage cleans them
+    bool is_dirty() const { return dirty_; }
+    void mark_clean() { dirty_ = false; }
+
     bool is_top_level_definition() const { return header_->is_top_level_; }
     Scope* inner_scope() const {
         assert(false && "not updated");
@@ -83,8 +93,10 @@ public:
 private:
     LetDefinitionValue value_;
     std::optional<const Type*> declared_type_ = std::nullopt;
+    std::vector<DefinitionHeader*> parameters_{};
 
     std::optional<Scope*> inner_scope_ = std::nullopt;
+    bool dirty_ = true;
 };
 
 } // namespace Maps
@@ -30,15 +30,12 @@ std::pair<DefinitionHeader*, DefinitionBody*> function_definition(CompilationSta
     for (auto param: parameter_list)
         param_types.push_back(param->get_type());
 
-    if (std::holds_alternative<Expression*>(value)) {
-        return state.ast_store_->allocate_definition(
-            RT_DefinitionHeader{DefinitionType::let_definition, MAPS_INTERNALS_PREFIX + "anonymous_function", 
-                location}, value);
-    }
-
-    return state.ast_store_->allocate_definition(
+    auto [header, body] = state.ast_store_->allocate_definition(
         RT_DefinitionHeader{DefinitionType::let_definition, MAPS_INTERNALS_PREFIX + "anonymous_function", 
             location}, value);
+
+    body->set_parameters(parameter_list);
+    return {header, body};
 }
 
 std::pair<DefinitionHeader*, DefinitionBody*> function_definition(CompilationState& state, 
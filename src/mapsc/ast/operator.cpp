@@ -1,5 +1,6 @@
 #include "operator.hh"
 
+#include "mapsc/memory_stats.hh"
 #include "mapsc/ast/ast_store.hh"
 #include "mapsc/source_location.hh"
 #include "mapsc/ast/definition.hh"
@@ -23,6 +24,10 @@ Operator Operator::create_binary(std::string name, DefinitionHeader* value,
     };
 }
 
+size_t RT_Operator::payload_size() const {
+    return heap_bytes(name_string_);
+}
+
 Operator* create_binary_operator(AST_Store& ast_store, std::string name, DefinitionHeader* value, 
     Operator::Precedence precedence, Operator::Associativity associativity, 
     SourceLocation location) {
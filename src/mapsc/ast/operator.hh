@@ -79,6 +79,8 @@ public:
 
     bool is_operator() const { return true; }
 
+    virtual size_t node_size() const { return sizeof(Operator); }
+
     Properties operator_props() const {
         return operator_props_;
     };
@@ -114,6 +116,9 @@ public:
     RT_Operator& operator=(RT_Operator&&) = delete; 
     RT_Operator& operator=(const RT_Operator&) = delete;
 
+    virtual size_t node_size() const { return sizeof(RT_Operator); }
+    virtual size_t payload_size() const;
+
 private:
     std::string name_string_;
 };
@@ -178,7 +178,7 @@ Operator::Precedence get_operator_precedence(const Expression& operator_ref, boo
                 break;
             }
 
-            auto [callee, args] = operator_ref.call_value();
+            const auto& [callee, args] = operator_ref.call_value();
             assert(callee->is_operator() && "encountered partial binop call left with not an operator as callee");
             auto op = dynamic_cast<const Operator*>(callee);
             assert(op);
@@ -193,7 +193,7 @@ Operator::Precedence get_operator_precedence(const Expression& operator_ref, boo
                 break;
             }
 
-            auto [callee, args] = operator_ref.call_value();
+            const auto& [callee, args] = operator_ref.call_value();
             assert(callee->is_operator() && 
                 "encountered partial binop call left with not an operator as callee");
             auto op = dynamic_cast<const Operator*>(callee);
@@ -9,6 +9,7 @@
 
 #include "mapsc/source_location.hh"
 #include "mapsc/logging.hh"
+#include "mapsc/memory_stats.hh"
 #include "mapsc/types/type.hh"
 #include "mapsc/ast/definition.hh"
 
@@ -34,4 +35,8 @@ std::optional<DefinitionHeader*> Scope::create_identifier(DefinitionHeader* node
     return node;
 }
 
-} // namespace Maps
\ No newline at end of file
+size_t Scope::payload_size() const {
+    return heap_bytes(identifiers_in_order_) + heap_bytes(identifiers_);
+}
+
+} // namespace Maps
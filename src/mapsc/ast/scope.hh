@@ -53,6 +53,9 @@ public:
 
     std::optional<DefinitionHeader*> create_identifier(DefinitionHeader* node);
 
+    // heap memory used for the lookup tables, for memory accounting
+    size_t payload_size() const;
+
     std::vector<DefinitionHeader*> identifiers_in_order_ = {};
 
     bool is_top_level_scope() { return !parent_scope().has_value(); }
@@ -96,7 +96,8 @@ Statement* create_empty_statement(AST_Store& ast_store, SourceLocation location)
 Statement* create_assignment_statement(AST_Store& ast_store, Expression* identifier_or_reference, 
 DefinitionBody* definition, SourceLocation location) {
     return ast_store.allocate_statement(Statement{StatementType::assignment, 
-        identifier_or_reference, identifier_or_reference->type, std::move(location)});
+        Assignment{identifier_or_reference, definition}, identifier_or_reference->type, 
+        std::move(location)});
 }
 
 Statement* create_return_statement(AST_Store& ast_store, Expression* expression, 
@@ -68,6 +68,14 @@ constexpr BuiltinValueScope builtin_values {
     &false_,
 };
 
+// The definitions above get a copy in every translation unit that includes this header, so 
+// builtins have to be compared by name rather than by address
+inline bool same_builtin(const DefinitionHeader& lhs, const DefinitionHeader& rhs) {
+    return lhs.definition_type_ == DefinitionType::external_builtin &&
+        rhs.definition_type_ == DefinitionType::external_builtin &&
+        lhs.name_view() == rhs.name_view();
+}
+
 inline std::optional<const DefinitionHeader*> find_external_runtime_cast(
     const Type* source_type, const Type* target_type) {
     
@@ -1,5 +1,6 @@
 #include "compilation_state.hh"
 #include "mapsc/types/type_store.hh"
+#include "mapsc/procedures/evaluate.hh"
 
 using std::tuple, std::unique_ptr, std::make_unique;
 
@@ -21,7 +22,14 @@ CompilationState::CompilationState(TypeStore* types,
 CompilationState::CompilationState(TypeStore* types, 
     Options compiler_options, SpecialDefinitions special_definitions)
 :compiler_options_(compiler_options), 
+ constant_folds_(std::make_shared<ConstantFoldCache>()),
  types_(types), 
  special_definitions_(special_definitions) {}
 
+MemoryStats CompilationState::memory_stats() const {
+    auto stats = ast_store_->memory_stats();
+    stats += types_->memory_stats();
+    return stats;
+}
+
 } // namespace Maps
\ No newline at end of file
@@ -2,8 +2,11 @@
 #define __COMPILATION_STATE_HH
 
 #include <memory>
+#include <string>
 #include <tuple>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "mapsc/pragma.hh"
 #include "mapsc/builtins.hh"
@@ -14,9 +17,18 @@
 
 namespace Maps {
 
+class ConstantFoldCache;
+
 class CompilationState {
 public:
     struct Options {
+        // worker threads for the stages that can run in parallel, 1 means everything runs 
+        // on the calling thread
+        unsigned int thread_count = 1;
+        // transform passes to turn on (true) or off (false) by name, applied in order
+        std::vector<std::pair<std::string, bool>> pass_overrides = {};
+        // pure functions whose bodies are at most this many nodes get inlined at their call sites
+        size_t inline_budget = 32;
     };
 
     struct SpecialDefinitions {
@@ -42,8 +54,13 @@ public:
     CompilationState& operator=(const CompilationState&) = default;
     ~CompilationState() = default;
 
+    // live memory of the ast and the types combined
+    MemoryStats memory_stats() const;
+
     Options compiler_options_{};
     std::shared_ptr<AST_Store> ast_store_ = std::make_shared<AST_Store>();
+    // shared between copies, compile-time evaluated calls don't depend on anything else
+    std::shared_ptr<ConstantFoldCache> constant_folds_;
     PragmaStore pragmas_ = {};
     
     TypeStore* types_;
@@ -0,0 +1,100 @@
+#include "dependency_tracker.hh"
+
+#include <algorithm>
+
+#include "mapsc/ast/ast_node_visitor.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/scope.hh"
+
+namespace Maps {
+
+namespace {
+
+struct ReferenceCollector {
+    std::vector<const DefinitionHeader*>* references;
+
+    bool visit_expression(Expression* expression) {
+        switch (expression->expression_type) {
+            case ExpressionType::call:
+            case ExpressionType::partial_call:
+            case ExpressionType::partial_binop_call_left:
+            case ExpressionType::partial_binop_call_right:
+            case ExpressionType::partial_binop_call_both:
+                references->push_back(std::get<0>(expression->call_value()));
+                return true;
+
+            case ExpressionType::reference:
+            case ExpressionType::known_value_reference:
+                references->push_back(expression->reference_value());
+                return true;
+
+            default:
+                return true;
+        }
+    }
+
+    bool visit_statement(Statement*) { return true; }
+    bool visit_definition(DefinitionBody*) { return true; }
+};
+
+} // anonymous namespace
+
+std::vector<const DefinitionHeader*> collect_references(DefinitionBody& definition) {
+    std::vector<const DefinitionHeader*> references{};
+    walk_definition(ReferenceCollector{&references}, &definition);
+
+    std::sort(references.begin(), references.end());
+    references.erase(std::unique(references.begin(), references.end()), references.end());
+
+    return references;
+}
+
+std::vector<DefinitionHeader*> DependencyTracker::dirty_definitions(const Scope& scope) const {
+    std::vector<DefinitionHeader*> definitions = dirty_;
+
+    auto first_new = scope.identifiers_in_order_.begin() +
+        std::min(scope_position_, scope.identifiers_in_order_.size());
+    definitions.insert(definitions.end(), first_new, scope.identifiers_in_order_.end());
+
+    return definitions;
+}
+
+void DependencyTracker::commit(const Scope& scope) {
+    std::vector<DefinitionHeader*> still_dirty{};
+
+    for (DefinitionHeader* definition: dirty_definitions(scope)) {
+        if (definition->body_ && (*definition->body_)->is_dirty()) {
+            still_dirty.push_back(definition);
+            continue;
+        }
+
+        record(*definition);
+    }
+
+    dirty_ = std::move(still_dirty);
+    scope_position_ = scope.identifiers_in_order_.size();
+}
+
+void DependencyTracker::record(DefinitionHeader& definition) {
+    auto& dependencies = dependencies_[&definition];
+
+    if (definition.body_) {
+        dependencies = collect_references(**definition.body_);
+    } else {
+        dependencies.clear();
+    }
+}
+
+std::span<const DefinitionHeader* const> DependencyTracker::dependencies(
+    const DefinitionHeader& definition) const {
+
+    auto it = dependencies_.find(&definition);
+    if (it == dependencies_.end())
+        return {};
+
+    return it->second;
+}
+
+} // namespace Maps
@@ -0,0 +1,46 @@
+#ifndef __DEPENDENCY_TRACKER_HH
+#define __DEPENDENCY_TRACKER_HH
+
+#include <cstddef>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Maps {
+
+class DefinitionBody;
+class DefinitionHeader;
+class Scope;
+
+// the definitions a definition body calls or references, without duplicates
+std::vector<const DefinitionHeader*> collect_references(DefinitionBody& definition);
+
+// Keeps track of which top level definitions reference which, and of the ones that still have 
+// to go through the transforms, so that the definitions from earlier inputs aren't redone
+// Nothing is recorded until commit, so an input that fails halfway leaves the tracker as it was
+class DependencyTracker {
+public:
+    // the definitions added to the scope since the last commit, after the ones still dirty
+    // from before
+    std::vector<DefinitionHeader*> dirty_definitions(const Scope& scope) const;
+
+    // records what the definitions that are now clean reference, the ones still dirty are
+    // kept around for the next round
+    void commit(const Scope& scope);
+
+    std::span<const DefinitionHeader* const> dependencies(const DefinitionHeader& definition) const;
+
+private:
+    void record(DefinitionHeader& definition);
+
+    std::unordered_map<const DefinitionHeader*, std::vector<const DefinitionHeader*>>
+        dependencies_{};
+
+    std::vector<DefinitionHeader*> dirty_{};
+    // how much of the scope's definitions have been committed
+    size_t scope_position_ = 0;
+};
+
+} // namespace Maps
+
+#endif
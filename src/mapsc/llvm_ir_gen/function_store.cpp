@@ -18,21 +18,50 @@ namespace Maps {
 namespace LLVM_IR {
 
 std::optional<llvm::FunctionCallee> FunctionStore::get(const DefinitionHeader& definition) const {
+    auto it = bound_definitions_.find(&definition);
+    if (it != bound_definitions_.end())
+        return it->second;
+
+    auto function_callee = resolve_by_name(definition);
+    if (!function_callee)
+        return nullopt;
+
+    bound_definitions_.insert({&definition, *function_callee});
+    return function_callee;
+}
+
+bool FunctionStore::bind(const DefinitionHeader& definition, llvm::FunctionCallee function_callee) {
+    auto [_, success] = bound_definitions_.insert({&definition, function_callee});
+
+    if (!success) {
+        LogInContext<LogContext::ir_gen>::compiler_error(definition.location()) <<
+            "Tried to bind " << definition << " twice in function store" << Endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<llvm::FunctionCallee> FunctionStore::resolve_by_name(
+    const DefinitionHeader& definition) const {
+    
     using Log = LogInContext<LogContext::ir_gen>;
 
     auto name = definition.name_string();
 
-    Log::debug_extra(NO_SOURCE_LOCATION) << "Looking up a function with name \"" << name << "\"" << Endl;
+    Log::debug_extra(NO_SOURCE_LOCATION, [&name](auto& log) {
+        log << "Looking up a function with name \"" << name << "\"" << Endl;
+    });
     
     auto it = functions_.find(name);
     if (it != functions_.end()) {
-        Log::debug_extra(NO_SOURCE_LOCATION) << "Found function" << Endl;
+        Log::debug_extra(NO_SOURCE_LOCATION, [](auto& log) { log << "Found function" << Endl; });
         return it->second;
     }
 
     auto overload_it = functions_.find(name + get_suffix(definition));
     if (overload_it != functions_.end()) {
-        Log::debug_extra(NO_SOURCE_LOCATION) << "Found overload" << Endl;
+        Log::debug_extra(NO_SOURCE_LOCATION, [](auto& log) { log << "Found overload" << Endl; });
         return overload_it->second;
     }
 
@@ -4,7 +4,7 @@
 #include <memory>
 #include <optional>
 #include <string>
-#include <map>
+#include <unordered_map>
 
 #include "llvm/IR/DerivedTypes.h"
 
@@ -42,8 +42,14 @@ public:
     }
 
     // std::optional<llvm::Function*> get_function(const std::string& name, AST::Type* function_type) const;
+    // Looks up the callee for a definition. Definitions that have been bound are a single hash 
+    // probe, otherwise the callee is resolved by (mangled) name and the result is bound
     std::optional<llvm::FunctionCallee> get(const Maps::DefinitionHeader& definition) const;
 
+    // Binds the definition directly to the callee so that get doesn't need to mangle the name
+    // Should be called when the function for the definition gets created
+    bool bind(const Maps::DefinitionHeader& definition, llvm::FunctionCallee function_callee);
+
     bool insert(const std::string& name, llvm::FunctionCallee function_callee);
     bool insert(const Maps::DefinitionHeader&, llvm::FunctionCallee function_callee);
 
@@ -51,7 +57,15 @@ public:
         llvm::FunctionCallee function_callee);
     bool insert_overloaded(const Maps::DefinitionHeader& definition, llvm::FunctionCallee function_callee);
 
-    std::map<std::string, llvm::FunctionCallee> functions_{};
+    std::unordered_map<std::string, llvm::FunctionCallee> functions_{};
+
+private:
+    std::optional<llvm::FunctionCallee> resolve_by_name(const Maps::DefinitionHeader& definition) const;
+
+    // the DefinitionHeaders are owned by the AST_Store or are builtins, so they outlive the 
+    // ir generator
+    mutable std::unordered_map<const Maps::DefinitionHeader*, llvm::FunctionCallee> 
+        bound_definitions_{};
 };
 
 } // namespace LLVM_IR
@@ -1,6 +1,7 @@
 #include "ir_builtins.hh"
 
 #include <array>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <optional>
@@ -10,13 +11,29 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
-
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include "mapsc/source_location.hh"
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
 
 #include "mapsc/types/type.hh"
 #include "mapsc/types/type_defs.hh"
@@ -37,14 +54,20 @@ class FunctionType;
 
 namespace LLVM_IR {
 
+constexpr char BUILTINS_MODULE_NAME[] = "maps_builtins";
+
 bool forward_declare_libmaps(IR_Generator& denerator);
-bool insert_arithmetic_functions(IR_Generator& denerator);
+bool insert_arithmetic_functions(IR_Generator& denerator, llvm::Function::LinkageTypes linkage);
+bool declare_arithmetic_functions(IR_Generator& generator);
+bool bind_builtin_externals(IR_Generator& generator);
 
 // TODO: parse header file
-// TODO: memoize this somehow
 bool insert_builtins(IR_Generator& generator) {
-    forward_declare_libmaps(generator);
-    insert_arithmetic_functions(generator);
+    if (!forward_declare_libmaps(generator) || 
+        !insert_arithmetic_functions(generator, llvm::Function::InternalLinkage) ||
+        !bind_builtin_externals(generator)) {
+        return false;
+    }
 
     // optional<llvm::Function*> cast_Boolean_to_String = generator.function_definition("to_String", 
     //     *generator.maps_types_->get_function_type(&Maps::String, {&Maps::Boolean}, true), 
@@ -66,6 +89,91 @@ bool insert_builtins(IR_Generator& generator) {
     return true;
 }
 
+bool declare_builtins(IR_Generator& generator) {
+    return forward_declare_libmaps(generator) && 
+        declare_arithmetic_functions(generator) &&
+        bind_builtin_externals(generator);
+}
+
+const llvm::MemoryBuffer* builtins_bitcode(const CompilationState& state) {
+    // built on first use, the definitions don't depend on anything that changes between modules
+    static const std::unique_ptr<llvm::MemoryBuffer> bitcode = 
+        [&state]() -> std::unique_ptr<llvm::MemoryBuffer> {
+            ProfileScope profile{"builtins bitcode", "llvm"};
+
+            llvm::LLVMContext context{};
+            llvm::Module module_{BUILTINS_MODULE_NAME, context};
+            IR_Generator generator{&context, &module_, &state, &llvm::errs()};
+
+            // link_builtins gives the copies the same linkage as the other definitions
+            if (!insert_arithmetic_functions(generator, llvm::Function::ExternalLinkage) || 
+                !generator.verify_module()) {
+
+                Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << 
+                    "Generating the builtins bitcode failed" << Endl;
+                return nullptr;
+            }
+
+            llvm::SmallVector<char, 0> buffer{};
+            llvm::raw_svector_ostream stream{buffer};
+            llvm::WriteBitcodeToFile(module_, stream);
+
+            return llvm::MemoryBuffer::getMemBufferCopy(
+                llvm::StringRef{buffer.data(), buffer.size()}, BUILTINS_MODULE_NAME);
+        }();
+
+    return bitcode.get();
+}
+
+std::unique_ptr<llvm::Module> load_builtins(llvm::LLVMContext& context, 
+    const CompilationState& state) {
+
+    ProfileScope profile{"load builtins", "llvm"};
+
+    const llvm::MemoryBuffer* bitcode = builtins_bitcode(state);
+    if (!bitcode)
+        return nullptr;
+
+    auto builtins = llvm::parseBitcodeFile(bitcode->getMemBufferRef(), context);
+    if (!builtins) {
+        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << 
+            "Loading the builtins bitcode failed: " << llvm::toString(builtins.takeError()) << Endl;
+        return nullptr;
+    }
+
+    return std::move(*builtins);
+}
+
+bool link_builtins(IR_Generator& generator, const llvm::Module& builtins) {
+    ProfileScope profile{"link builtins", "llvm"};
+
+    // llvm::Linker would be more general, but it costs more per module than generating the 
+    // builtins did, and they don't reference anything that would need to be mapped
+    for (const llvm::Function& builtin: builtins) {
+        llvm::Function* declaration = generator.module_->getFunction(builtin.getName());
+        if (!declaration || !declaration->isDeclaration() || declaration->use_empty())
+            continue;
+
+        if (declaration->getFunctionType() != builtin.getFunctionType()) {
+            Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << 
+                "Builtin " << builtin.getName().str() << " was declared with the wrong type" << Endl;
+            return false;
+        }
+
+        llvm::ValueToValueMapTy values{};
+        for (auto [builtin_arg, declaration_arg]: llvm::zip(builtin.args(), declaration->args()))
+            values[&builtin_arg] = &declaration_arg;
+
+        llvm::SmallVector<llvm::ReturnInst*, 1> returns{};
+        llvm::CloneFunctionInto(declaration, &builtin, values, 
+            llvm::CloneFunctionChangeType::DifferentModule, returns);
+
+        declaration->setLinkage(generator.definition_linkage(declaration->getName().str()));
+    }
+
+    return true;
+}
+
 bool forward_declare_libmaps(IR_Generator& generator) {
     // ----- declare print types -----
     // const std::array<std::pair<const Maps::Type*, llvm::Type*>, 5> PRINTABLE_TYPES{
@@ -164,7 +272,16 @@ bool forward_declare_libmaps(IR_Generator& generator) {
     return true;
 }
 
-bool insert_arithmetic_functions(IR_Generator& generator) {
+// the arithmetic builtins are simple enough to describe as a name, a type and a single
+// instruction, so that they can be either defined or just declared from the same list
+struct ArithmeticBuiltin {
+    std::string name;
+    const Maps::FunctionType* maps_type;
+    llvm::FunctionType* llvm_type;
+    std::function<llvm::Value*(llvm::IRBuilder<>&, llvm::Function&)> create_body;
+};
+
+std::vector<ArithmeticBuiltin> arithmetic_builtins(IR_Generator& generator) {
     // arithmetic function types
     const Maps::FunctionType* IntInt = generator.maps_types_->get_function_type(
         &Maps::Int, {&Maps::Int}, true);
@@ -181,127 +298,99 @@ bool insert_arithmetic_functions(IR_Generator& generator) {
     llvm::FunctionType* llvm_FloatFloatFloat = llvm::FunctionType::get(generator.types_.double_t, 
         {generator.types_.double_t, generator.types_.double_t}, false);
 
-    llvm::Value* zero = llvm::ConstantInt::get(*generator.context_, llvm::APInt(32, 0, true));
-    
-
-    // ##########  -Int  ##########
-    optional<llvm::Function*> negate_int = generator.overloaded_function_definition(
-        "-", *IntInt, llvm_IntInt);
-
-    if (!negate_int) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin unary - failed" << Endl;
-        return false;
-    }
-
-    generator.builder_->CreateRet(
-        generator.builder_->CreateSub(zero, (*negate_int)->getArg(0))
-    );
-
-    // ##########  Int + Int  ##########
-    optional<llvm::Function*> int_add = generator.overloaded_function_definition(
-        "+", *IntIntInt, llvm_IntIntInt);
-
-    if (!int_add) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin + failed" << Endl;
-        return false;
-    }
-
-    generator.builder_->CreateRet(
-        generator.builder_->CreateAdd(
-            (*int_add)->getArg(0), (*int_add)->getArg(1)
-        )
-    );
-
-    // ##########  Int * Int  ##########
-    optional<llvm::Function*> int_mul = generator.overloaded_function_definition(
-        "*", *IntIntInt, llvm_IntIntInt);
-
-    if (!int_mul) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin * failed" << Endl;
-        return false;
-    }
-
-    generator.builder_->CreateRet(
-        generator.builder_->CreateMul(
-            (*int_mul)->getArg(0), (*int_mul)->getArg(1)
-        )
-    );
-
-    // ##########  Int - Int  ##########
-    optional<llvm::Function*> int_sub = generator.overloaded_function_definition(
-        "-", *IntIntInt, llvm_IntIntInt);
-
-    if (!int_sub) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin - failed" << Endl;
-        return false;
-    }
-
-    generator.builder_->CreateRet(
-        generator.builder_->CreateSub(
-            (*int_sub)->getArg(0), (*int_sub)->getArg(1)
-        )
-    );
-
-    // ##########  Float + Float  ##########
-    optional<llvm::Function*> float_add = generator.overloaded_function_definition(
-        "+", *maps_FloatFloatFloat, llvm_FloatFloatFloat);
+    return {
+        // ##########  -Int  ##########
+        {"-", IntInt, llvm_IntInt, [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+            return builder.CreateSub(builder.getInt32(0), function.getArg(0)); }},
+
+        // ##########  Int + Int  ##########
+        {"+", IntIntInt, llvm_IntIntInt, [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+            return builder.CreateAdd(function.getArg(0), function.getArg(1)); }},
+
+        // ##########  Int * Int  ##########
+        {"*", IntIntInt, llvm_IntIntInt, [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+            return builder.CreateMul(function.getArg(0), function.getArg(1)); }},
+
+        // ##########  Int - Int  ##########
+        {"-", IntIntInt, llvm_IntIntInt, [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+            return builder.CreateSub(function.getArg(0), function.getArg(1)); }},
+
+        // ##########  Float + Float  ##########
+        {"+", maps_FloatFloatFloat, llvm_FloatFloatFloat, 
+            [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+                return builder.CreateFAdd(function.getArg(0), function.getArg(1)); }},
+
+        // ##########  Float * Float  ##########
+        {"*", maps_FloatFloatFloat, llvm_FloatFloatFloat, 
+            [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+                return builder.CreateFMul(function.getArg(0), function.getArg(1)); }},
+
+        // ##########  Float - Float  ##########
+        {"-", maps_FloatFloatFloat, llvm_FloatFloatFloat, 
+            [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+                return builder.CreateFSub(function.getArg(0), function.getArg(1)); }},
+
+        // ##########  Float / Float  ##########
+        {"/", maps_FloatFloatFloat, llvm_FloatFloatFloat, 
+            [](llvm::IRBuilder<>& builder, llvm::Function& function) {
+                return builder.CreateFDiv(function.getArg(0), function.getArg(1)); }},
+    };
+}
 
-    if (!float_add) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin + failed" << Endl;
-        return false;
-    }
+bool insert_arithmetic_functions(IR_Generator& generator, llvm::Function::LinkageTypes linkage) {
+    for (const ArithmeticBuiltin& builtin: arithmetic_builtins(generator)) {
+        optional<llvm::Function*> function = generator.overloaded_function_definition(
+            builtin.name, *builtin.maps_type, builtin.llvm_type, linkage);
 
-    generator.builder_->CreateRet(
-        generator.builder_->CreateFAdd(
-            (*float_add)->getArg(0), (*float_add)->getArg(1)
-        )
-    );
+        if (!function) {
+            Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << 
+                "creating builtin " << builtin.name << " failed" << Endl;
+            return false;
+        }
 
-    // ##########  Float * Float  ##########
-    optional<llvm::Function*> float_mul = generator.overloaded_function_definition(
-        "*", *maps_FloatFloatFloat, llvm_FloatFloatFloat);
+        generator.builder_->CreateRet(builtin.create_body(*generator.builder_, **function));
+        generator.add_memory_attributes(**function, *builtin.maps_type);
 
-    if (!float_mul) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin * failed" << Endl;
-        return false;
+        // llvm can't delete a call whose callee might not return, even if it's otherwise unused
+        // these are single instructions, so unlike user functions they're known to terminate
+        (*function)->setWillReturn();
+        (*function)->setMustProgress();
     }
 
-    generator.builder_->CreateRet(
-        generator.builder_->CreateFMul(
-            (*float_mul)->getArg(0), (*float_mul)->getArg(1)
-        )
-    );
-
-    // ##########  Float - Float  ##########
-    optional<llvm::Function*> float_sub = generator.overloaded_function_definition(
-        "-", *maps_FloatFloatFloat, llvm_FloatFloatFloat);
+    return true;
+}
 
-    if (!float_sub) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin - failed" << Endl;
-        return false;
+bool declare_arithmetic_functions(IR_Generator& generator) {
+    for (const ArithmeticBuiltin& builtin: arithmetic_builtins(generator)) {
+        optional<llvm::Function*> function = generator.overloaded_forward_declaration(
+            builtin.name, *builtin.maps_type, builtin.llvm_type);
+
+        if (!function) {
+            Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << 
+                "declaring builtin " << builtin.name << " failed" << Endl;
+            return false;
+        }
+
+        // add_memory_attributes only goes by bodies, but these are known to be pure and 
+        // the calls to them should get the attributes before the definitions are linked in
+        (*function)->setDoesNotAccessMemory();
+        (*function)->setWillReturn();
+        (*function)->setMustProgress();
     }
 
-    generator.builder_->CreateRet(
-        generator.builder_->CreateFSub(
-            (*float_sub)->getArg(0), (*float_sub)->getArg(1)
-        )
-    );
-
-    // ##########  Float / Float  ##########
-    optional<llvm::Function*> float_div = generator.overloaded_function_definition(
-        "/", *maps_FloatFloatFloat, llvm_FloatFloatFloat);
+    return true;
+}
 
-    if (!float_div) {
-        Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << "creating builtin - failed" << Endl;
-        return false;
+// resolves the builtin externals up front so that calls to them don't need to mangle names
+bool bind_builtin_externals(IR_Generator& generator) {
+    for (const DefinitionHeader* definition: builtin_externals) {
+        if (!generator.function_store_->get(*definition)) {
+            Log::compiler_error(COMPILER_INIT_SOURCE_LOCATION) << 
+                "Binding builtin " << *definition << " failed" << Endl;
+            return false;
+        }
     }
 
-    generator.builder_->CreateRet(
-        generator.builder_->CreateFDiv(
-            (*float_div)->getArg(0), (*float_div)->getArg(1)
-        )
-    );
-
     return true;
 }
 
@@ -1,13 +1,21 @@
 #ifndef __IR_BUILTINS_HH
 #define __IR_BUILTINS_HH
 
+#include <memory>
+
 namespace llvm {
 
 class Function;
+class LLVMContext;
+class MemoryBuffer;
+class Module;
 
 } // namespace llvm
 
 namespace Maps {
+
+class CompilationState;
+
 namespace LLVM_IR {
 
 class IR_Generator;
@@ -20,6 +28,25 @@ struct Builtins {
 // declares builtins and external functions used by them
 bool insert_builtins(IR_Generator& generator);
 
+// Like insert_builtins, except that the arithmetic builtins are only declared
+// Their definitions are copied in from the module given by load_builtins by link_builtins 
+// once ir gen is done
+bool declare_builtins(IR_Generator& generator);
+
+// The arithmetic builtin definitions as bitcode
+// Generated on the first call and kept for the rest of the process, nullptr if it failed
+const llvm::MemoryBuffer* builtins_bitcode(const CompilationState& state);
+
+// Parses the builtins bitcode into the context, should be done once per context
+// The definitions have external linkage, so the module can also be added to a jit as is for 
+// modules that only declare the builtins to call
+std::unique_ptr<llvm::Module> load_builtins(llvm::LLVMContext& context, 
+    const CompilationState& state);
+
+// Fills in the declarations of the builtins the module actually calls with copies of their 
+// definitions. They get the same linkage as generated definitions
+bool link_builtins(IR_Generator& generator, const llvm::Module& builtins);
+
 } // namespace LLVM_IR
 } // nameespace Maps
 
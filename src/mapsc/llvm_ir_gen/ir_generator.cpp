@@ -1,5 +1,6 @@
 #include "ir_generator.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <span>
 #include <sstream>
@@ -31,6 +32,7 @@
 
 #include "mapsc/source_location.hh"
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
 
 #include "mapsc/compilation_state.hh"
 
@@ -101,7 +103,14 @@ bool IR_Generator::run(const Scope& scope,
     if (!handle_global_functions(scope))
         return false;
 
-    for (auto definition: additional_definitions) {
+    return run(additional_definitions);
+}
+
+bool IR_Generator::run(std::span<DefinitionHeader* const> definitions) {
+    if (has_failed_)
+        return false;
+
+    for (auto definition: definitions) {
         if (!handle_global_definition(*definition)) {
             Log::compiler_error(definition->location()) << 
                 "Couldn't generate ir for " << *definition;
@@ -133,6 +142,7 @@ optional<llvm::Function*> IR_Generator::function_definition(const std::string& n
 
     llvm::Function* function = llvm::Function::Create(llvm_type, linkage, name, module_);
     function_store_->insert(name, {llvm_type, function});
+    Profiler::count(ProfilerCounter::functions_emitted);
     llvm::BasicBlock* body = llvm::BasicBlock::Create(*context_, "", function);
     builder_->SetInsertPoint(body);
     return function;
@@ -153,8 +163,10 @@ optional<llvm::Function*> IR_Generator::overloaded_function_definition(const std
 
     llvm::Function* function = llvm::Function::Create(llvm_type, linkage, suffixed_name, module_);
     function_store_->insert_overloaded(name, maps_type, {llvm_type, function});
+    Profiler::count(ProfilerCounter::functions_emitted);
     llvm::BasicBlock* body = llvm::BasicBlock::Create(*context_, "", function);
     builder_->SetInsertPoint(body);
+    add_function_attributes(*function);
     return function;
 }
 
@@ -170,6 +182,7 @@ bool IR_Generator::close_function_definition(const llvm::Function& function,
     if (!options_.verify_functions)
         return true;
 
+    ProfileScope profile{"llvm verification", "llvm"};
     // llvm::verifyFunction returns true on fail for some reason
     return (!llvm::verifyFunction(function, errs_));
 }
@@ -179,6 +192,7 @@ optional<llvm::Function*> IR_Generator::forward_declaration(const std::string& n
     
     llvm::Function* function = llvm::Function::Create(llvm_type, linkage, name, module_);
     function_store_->insert(name, function);
+    add_function_attributes(*function);
     return function;
 }
 
@@ -190,9 +204,68 @@ optional<llvm::Function*> IR_Generator::overloaded_forward_declaration(const std
 
     llvm::Function* function = llvm::Function::Create(llvm_type, linkage, suffixed_name, module_);
     function_store_->insert_overloaded(name, maps_type, function);
+    add_function_attributes(*function);
     return function;
 }
 
+void IR_Generator::add_function_attributes(llvm::Function& function) {
+
+    // maps has no exceptions, and neither does libmaps
+    function.setDoesNotThrow();
+
+    // maps values are never uninitialized, and the strings are never null
+    if (!function.getReturnType()->isVoidTy())
+        function.addRetAttr(llvm::Attribute::NoUndef);
+
+    for (llvm::Argument& arg: function.args()) {
+        arg.addAttr(llvm::Attribute::NoUndef);
+        if (arg.getType()->isPointerTy())
+            arg.addAttr(llvm::Attribute::NonNull);
+    }
+}
+
+void IR_Generator::add_memory_attributes(llvm::Function& function, 
+    const FunctionType& maps_type) {
+
+    if (!maps_type.is_pure() || function.isDeclaration())
+        return;
+
+    // a pure maps type doesn't mean the body doesn't touch memory, e.g. libmaps functions 
+    // allocate, so the effects come from what the body actually does
+    bool reads_memory = false;
+    for (const llvm::BasicBlock& block: function) {
+        for (const llvm::Instruction& instruction: block) {
+            // recursive calls do whatever the rest of the body does
+            auto call = llvm::dyn_cast<llvm::CallBase>(&instruction);
+            if (call && call->getCalledFunction() == &function)
+                continue;
+
+            if (instruction.mayWriteToMemory())
+                return;
+
+            reads_memory |= instruction.mayReadFromMemory();
+        }
+    }
+
+    if (reads_memory) {
+        function.setOnlyReadsMemory();
+    } else {
+        function.setDoesNotAccessMemory();
+    }
+
+    // no mustprogress, with it llvm would infer willreturn and e.g. delete calls to a pure 
+    // function that never returns
+    function.setDoesNotFreeMemory();
+    function.setNoSync();
+}
+
+llvm::Function::LinkageTypes IR_Generator::definition_linkage(const std::string& name) const {
+    if (!options_.entry_point || *options_.entry_point == name)
+        return llvm::Function::ExternalLinkage;
+
+    return llvm::Function::InternalLinkage;
+}
+
 bool IR_Generator::block_has_terminated() const {
     return builder_->GetInsertBlock()->getTerminator() != nullptr;
 }
@@ -201,6 +274,7 @@ bool IR_Generator::verify_module() {
     if (!options_.verify_module)
         return true;
 
+    ProfileScope profile{"llvm verification", "llvm"};
     return (!llvm::verifyModule(*module_, errs_));
 }
 
@@ -227,14 +301,46 @@ std::optional<llvm::FunctionCallee> IR_Generator::handle_global_definition(
     auto definition_body = (*definition.body_)->get_value();
 
     if (const Expression* const* expression = 
-            std::get_if<Expression*>(&definition_body))
-        return wrap_value_in_function(definition.name_string(), **expression);
+            std::get_if<Expression*>(&definition_body)) {
+        auto wrapper = wrap_value_in_function(definition.name_string(), **expression);
+        if (wrapper)
+            function_store_->bind(definition, *wrapper);
+
+        return wrapper;
+    }
 
     Log::compiler_error(definition.location()) << "In IR_Generator::handle_global_definition:" <<
         " definition didn't have a function type but wasn't an expression";
     return fail_optional();
 }
 
+std::optional<llvm::FunctionCallee> IR_Generator::declare_global_definition(
+    const DefinitionHeader& definition) {
+
+    auto type = definition.get_type();
+
+    // values get wrapped into functions with no parameters
+    const FunctionType* maps_type = type->is_function() ? 
+        dynamic_cast<const FunctionType*>(type) :
+        maps_types_->get_function_type(type, {}, type->is_pure());
+
+    optional<llvm::FunctionType*> llvm_type = types_.convert_function_type(
+        *maps_type->return_type(), maps_type->param_types());
+
+    if (!llvm_type) {
+        Log::compiler_error(definition.location()) << 
+            "Converting " << *maps_type << "\" into an llvm type failed";
+        return fail_optional();
+    }
+
+    auto declaration = forward_declaration(definition.name_string(), *llvm_type);
+    if (!declaration)
+        return fail_optional();
+
+    function_store_->bind(definition, *declaration);
+    return *declaration;
+}
+
 std::optional<llvm::FunctionCallee> IR_Generator::wrap_value_in_function(
     const std::string& name, const Expression& expression) {
     
@@ -250,7 +356,11 @@ std::optional<llvm::FunctionCallee> IR_Generator::wrap_value_in_function(
         return fail_optional();
     }
     
-    auto wrapper = function_definition(name, *llvm_type);
+    auto wrapper = function_definition(name, *llvm_type, definition_linkage(name));
+    if (!wrapper)
+        return fail_optional();
+
+    add_function_attributes(**wrapper);
     auto value = handle_expression(expression);
 
     if (!*value) {
@@ -264,6 +374,7 @@ std::optional<llvm::FunctionCallee> IR_Generator::wrap_value_in_function(
         builder_->CreateRetVoid();
     }
 
+    add_memory_attributes(**wrapper, *maps_type);
     return wrapper;
 }
 
@@ -284,10 +395,14 @@ std::optional<llvm::FunctionCallee> IR_Generator::handle_function(
         return nullopt;
     }
 
-    optional<llvm::Function*> function = function_definition(definition.name_string(), *signature);
+    optional<llvm::Function*> function = function_definition(definition.name_string(), *signature,
+        definition_linkage(definition.name_string()));
 
     if (!function)
         return nullopt;
+
+    add_function_attributes(**function);
+    function_store_->bind(definition, *function);
     
     bool success = std::visit(overloaded{
         [this](const Expression* expression) {
@@ -316,6 +431,7 @@ std::optional<llvm::FunctionCallee> IR_Generator::handle_function(
     if (!builder_->GetInsertBlock()->getTerminator())
         builder_->CreateRetVoid();
 
+    add_memory_attributes(**function, *function_type);
     return function;
 }
 
@@ -353,8 +469,7 @@ bool IR_Generator::handle_statement(const Statement& statement) {
             return handle_guard(statement);
         
         case StatementType::assignment:
-            assert(false && "not implemented");
-            return false;
+            return handle_assignment(statement);
             
         case IGNORED_STATEMENT_TYPE:
             return false;
@@ -485,6 +600,24 @@ bool IR_Generator::handle_guard(const Statement& statement) {
     return true;
 }
 
+bool IR_Generator::handle_assignment(const Statement& statement) {
+    auto [identifier, body] = statement.get_value<Assignment>();
+
+    const Expression* const* expression = std::get_if<Expression*>(&body->body());
+    if (!expression) {
+        Log::error(statement.location) << "error during codegen: unhandled: " << statement << Endl;
+        has_failed_ = true;
+        return false;
+    }
+
+    optional<llvm::Value*> value = handle_expression(**expression);
+    if (!value)
+        return false;
+
+    local_values_.insert_or_assign(body->header_, *value);
+    return true;
+}
+
 std::optional<llvm::Value*> IR_Generator::handle_expression_statement(
     const Statement& statement) {
     
@@ -510,6 +643,14 @@ optional<llvm::Value*> IR_Generator::handle_expression(const Expression& express
         case ExpressionType::known_value:
             return handle_value(expression);
 
+        case ExpressionType::reference:
+        case ExpressionType::known_value_reference: {
+            auto local = local_values_.find(expression.reference_value());
+            if (local != local_values_.end())
+                return local->second;
+            [[fallthrough]];
+        }
+
         default:
             Log::error(expression.location) << "error during codegen: unhandled: " 
                    << expression << "\n";
@@ -589,6 +730,18 @@ llvm::Value* IR_Generator::handle_call(const Expression& call) {
 
     auto llvm_call = builder_->CreateCall(*function, arg_values);
 
+    // spelled out on the call as well so that the passes looking at calls alone see them
+    if (auto callee_function = llvm::dyn_cast<llvm::Function>(function->getCallee())) {
+        if (callee_function->doesNotThrow())
+            llvm_call->setDoesNotThrow();
+
+        if (callee_function->doesNotAccessMemory()) {
+            llvm_call->setDoesNotAccessMemory();
+        } else if (callee_function->onlyReadsMemory()) {
+            llvm_call->setOnlyReadsMemory();
+        }
+    }
+
     // if (callee->name_string() == "concat_MutString_MutString") {
     //     llvm_call->addParamAttr(0, llvm::Attribute::ByVal);
     //     llvm_call->addParamAttr(1, llvm::Attribute::ByVal);
@@ -5,6 +5,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
@@ -46,6 +47,9 @@ public:
         bool verify_functions = true;
         // if true, the module as a whole is verified in the end
         bool verify_module = true;
+        // if set, every other definition gets internal linkage so that llvm is free to inline
+        // them and delete the ones left unused
+        std::optional<std::string> entry_point = std::nullopt;
     };
 
     // ----- CONSTRUCTORS -----
@@ -61,6 +65,8 @@ public:
     // ----- RUNNING THE GENERATOR -----
     bool run(const Scope& scope);
     bool run(const Scope& scope, std::span<DefinitionHeader* const> additional_definitions);
+    // only generates the given definitions, anything else they call has to be declared first
+    bool run(std::span<DefinitionHeader* const> definitions);
 
     // ----- PUBLIC FIELDS -----
 
@@ -96,6 +102,12 @@ public:
         const FunctionType& maps_type, llvm::FunctionType* type, 
         llvm::Function::LinkageTypes linkage = llvm::Function::ExternalLinkage);
 
+    // attributes llvm can't see for itself: nounwind, noundef and nonnull on the string pointers
+    void add_function_attributes(llvm::Function& function);
+    // the memory effects of a pure function generated here, read off its body once it's done
+    void add_memory_attributes(llvm::Function& function, const FunctionType& maps_type);
+    llvm::Function::LinkageTypes definition_linkage(const std::string& name) const;
+
     bool block_has_terminated() const;
 
     // Runs llvm::verify_module (flips the result so that true means passed)
@@ -109,6 +121,11 @@ public:
 
     // ----- DEFINITION HANDLERS -----
     std::optional<llvm::FunctionCallee> handle_global_definition(const DefinitionHeader& definition);
+    // declares a global definition that lives in another module under the same name and 
+    // signature handle_global_definition would give it
+    // it gets no memory effects, since they depend on the body that isn't visible here
+    std::optional<llvm::FunctionCallee> declare_global_definition(
+        const DefinitionHeader& definition);
     std::optional<llvm::FunctionCallee> handle_function(const DefinitionHeader& definition);
 
     // ----- STATEMENT HANDLERS -----
@@ -122,6 +139,8 @@ public:
     bool handle_switch(const Statement& statement);
     bool handle_loop(const Statement& statement);
     bool handle_guard(const Statement& statement);
+    // local bindings are just the values they're bound to, since they can't be reassigned
+    bool handle_assignment(const Statement& statement);
 
     // ----- EXPRESSION HANDLERS -----
     std::optional<llvm::Value*> handle_expression(const Expression& expression);
@@ -145,6 +164,8 @@ public:
     
     bool has_failed_ = false;
 
+    std::unordered_map<const DefinitionHeader*, llvm::Value*> local_values_{};
+
     // ----- FRIEND FUNCTION -----
     // friend bool insert_builtins(IR::IR_Generator& generator);
 };
@@ -15,6 +15,8 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/CodeGen.h"
 
+#include "mapsc/profiler.hh"
+
 
 using namespace llvm;
 
@@ -34,7 +36,32 @@ bool init_llvm_target() {
     return true;
 }
 
-bool generate_object_file(const std::string& filename, Module& module_, std::ostream& errs) {
+namespace {
+
+CodeGenOptLevel codegen_optimization_level(Maps::LLVM_IR::OptimizationLevel level) {
+    using Maps::LLVM_IR::OptimizationLevel;
+
+    switch (level) {
+        case OptimizationLevel::O0:
+            return CodeGenOptLevel::None;
+        case OptimizationLevel::O1:
+            return CodeGenOptLevel::Less;
+        case OptimizationLevel::O2:
+        case OptimizationLevel::Os:
+            return CodeGenOptLevel::Default;
+        case OptimizationLevel::O3:
+            return CodeGenOptLevel::Aggressive;
+    }
+}
+
+} // anonymous namespace
+
+bool generate_object_file(const std::string& filename, Module& module_, std::ostream& errs,
+    Maps::LLVM_IR::OptimizationLevel optimization_level, 
+    const Maps::LLVM_IR::CodegenTarget& codegen_target) {
+
+    Maps::ProfileScope profile{"object emission", "llvm"};
+
     // check if we have a target
     auto target_triple = sys::getDefaultTargetTriple();
     std::string error;
@@ -45,11 +72,16 @@ bool generate_object_file(const std::string& filename, Module& module_, std::ost
         return false;
     }
     
-    auto cpu = "generic";
-    auto features = "";
-
     TargetOptions opt;
-    auto target_machine = target->createTargetMachine(target_triple, cpu, features, opt, Reloc::PIC_);
+    auto target_machine = target->createTargetMachine(target_triple, codegen_target.cpu, 
+        codegen_target.features, opt, Reloc::PIC_, std::nullopt, 
+        codegen_optimization_level(optimization_level));
+
+    module_.setDataLayout(target_machine->createDataLayout());
+    module_.setTargetTriple(target_triple);
+    Maps::LLVM_IR::record_target(module_, codegen_target);
+
+    Maps::LLVM_IR::optimize_module(module_, optimization_level, target_machine);
 
     // prepare the stream
     std::error_code error_code;
@@ -62,9 +94,6 @@ bool generate_object_file(const std::string& filename, Module& module_, std::ost
         return false;
     }
 
-    module_.setDataLayout(target_machine->createDataLayout());
-    module_.setTargetTriple(target_triple);
-
     // output the file
     pass.run(module_);
     output.flush();
@@ -4,10 +4,16 @@
 #include <ostream>
 #include <string>
 
+#include "mapsc/llvm_ir_gen/optimization.hh"
+#include "mapsc/llvm_ir_gen/target.hh"
+
 namespace llvm { class Module; }
 
 
 bool init_llvm_target();
-bool generate_object_file(const std::string& filename, llvm::Module& module_, std::ostream& errs);
+// runs the optimization pipeline for the level on the module before emitting it
+bool generate_object_file(const std::string& filename, llvm::Module& module_, std::ostream& errs,
+    Maps::LLVM_IR::OptimizationLevel optimization_level = Maps::LLVM_IR::OptimizationLevel::O0,
+    const Maps::LLVM_IR::CodegenTarget& codegen_target = {});
 
 #endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "object_cache.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+
+namespace Maps {
+namespace LLVM_IR {
+
+using Log = LogInContext<LogContext::ir_gen_init>;
+
+// bump if the way objects are stored or keyed changes
+constexpr std::string_view OBJECT_CACHE_FORMAT = "1";
+constexpr std::string_view OBJECT_FILE_EXTENSION = ".o";
+
+DiskObjectCache::DiskObjectCache(std::filesystem::path directory, uintmax_t max_size,
+    std::string salt)
+:directory_(std::move(directory)), max_size_(max_size), salt_(std::move(salt)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+
+    if (error || !std::filesystem::is_directory(directory_, error)) {
+        Log::error(NO_SOURCE_LOCATION) << "creating object cache directory " <<
+            directory_.string() << " failed" << Endl;
+        is_good = false;
+    }
+}
+
+std::unique_ptr<llvm::MemoryBuffer> DiskObjectCache::getObject(const llvm::Module* module_) {
+    ProfileScope profile{"object cache lookup", "llvm"};
+
+    std::string module_key = key(*module_);
+    auto path = object_path(module_key);
+
+    {
+        std::lock_guard lock{pending_mutex_};
+        pending_keys_.insert_or_assign(module_, module_key);
+    }
+
+    auto object = llvm::MemoryBuffer::getFile(path.string());
+    if (!object) {
+        Profiler::count(ProfilerCounter::object_cache_misses);
+        return nullptr;
+    }
+
+    Profiler::count(ProfilerCounter::object_cache_hits);
+    {
+        std::lock_guard lock{pending_mutex_};
+        pending_keys_.erase(module_);
+    }
+
+    // eviction goes by the modification times, so this makes it least recently used
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    return std::move(*object);
+}
+
+void DiskObjectCache::notifyObjectCompiled(const llvm::Module* module_,
+    llvm::MemoryBufferRef object) {
+
+    ProfileScope profile{"object cache store", "llvm"};
+
+    std::string module_key;
+    {
+        std::lock_guard lock{pending_mutex_};
+        auto it = pending_keys_.find(module_);
+        if (it != pending_keys_.end()) {
+            module_key = std::move(it->second);
+            pending_keys_.erase(it);
+        }
+    }
+
+    if (module_key.empty())
+        module_key = key(*module_);
+
+    // written into a temporary file first so that other processes using the same directory
+    // never see half of an object
+    int fd;
+    llvm::SmallString<128> temporary_path{};
+    if (llvm::sys::fs::createUniqueFile((directory_ / (module_key + "-%%%%%%.tmp")).string(),
+        fd, temporary_path)) {
+
+        Log::error(NO_SOURCE_LOCATION) << "creating a file in the object cache failed" << Endl;
+        return;
+    }
+
+    {
+        llvm::raw_fd_ostream stream{fd, /* shouldClose */ true};
+        stream << object.getBuffer();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path.str().str(), object_path(module_key), error);
+    if (error) {
+        Log::error(NO_SOURCE_LOCATION) << "storing an object in the object cache failed: " <<
+            error.message() << Endl;
+        std::filesystem::remove(temporary_path.str().str(), error);
+        return;
+    }
+
+    evict();
+}
+
+std::string DiskObjectCache::key(const llvm::Module& module_) const {
+    std::string text{};
+    llvm::raw_string_ostream stream{text};
+    stream << salt_ << '\n';
+    module_.print(stream, nullptr);
+    stream.flush();
+
+    return llvm::utohexstr(llvm::xxHash64(text), /* LowerCase */ true);
+}
+
+std::filesystem::path DiskObjectCache::object_path(std::string_view key) const {
+    return directory_ / (std::string{key} + std::string{OBJECT_FILE_EXTENSION});
+}
+
+void DiskObjectCache::evict() {
+    struct Entry {
+        std::filesystem::path path;
+        uintmax_t size;
+        std::filesystem::file_time_type last_used;
+    };
+
+    std::vector<Entry> entries{};
+    uintmax_t total_size = 0;
+    std::error_code error;
+
+    for (const auto& file: std::filesystem::directory_iterator{directory_, error}) {
+        if (!file.is_regular_file(error) || file.path().extension() != OBJECT_FILE_EXTENSION)
+            continue;
+
+        uintmax_t size = file.file_size(error);
+        if (error)
+            continue;
+
+        entries.push_back({file.path(), size, file.last_write_time(error)});
+        total_size += size;
+    }
+
+    if (total_size <= max_size_)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.last_used < rhs.last_used;
+    });
+
+    for (const Entry& entry: entries) {
+        if (total_size <= max_size_)
+            break;
+
+        // another process might have gotten to it first, which is fine too
+        std::filesystem::remove(entry.path, error);
+        if (!error)
+            total_size -= entry.size;
+    }
+}
+
+std::string object_cache_salt(std::string_view triple, std::string_view cpu,
+    std::string_view features, std::string_view codegen_options) {
+
+    std::string salt{"maps object cache "};
+    salt += OBJECT_CACHE_FORMAT;
+    salt += "\nllvm " LLVM_VERSION_STRING "\n";
+    for (std::string_view part: {triple, cpu, features, codegen_options}) {
+        salt += part;
+        salt += '\n';
+    }
+    return salt;
+}
+
+std::optional<std::filesystem::path> default_object_cache_directory() {
+    char* c_str;
+
+    if ((c_str = getenv("XDG_CACHE_HOME")))
+        return std::filesystem::path{c_str} / "mapsc" / "objects";
+
+    if ((c_str = getenv("HOME")))
+        return std::filesystem::path{c_str} / ".cache" / "mapsc" / "objects";
+
+    return std::nullopt;
+}
+
+} // namespace LLVM_IR
+} // namespace Maps
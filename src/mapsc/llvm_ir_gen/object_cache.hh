@@ -0,0 +1,73 @@
+#ifndef __OBJECT_CACHE_HH
+#define __OBJECT_CACHE_HH
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+
+namespace llvm {
+
+class MemoryBuffer;
+class MemoryBufferRef;
+class Module;
+
+} // namespace llvm
+
+namespace Maps {
+namespace LLVM_IR {
+
+constexpr uintmax_t DEFAULT_OBJECT_CACHE_SIZE = 64 * 1024 * 1024;
+
+// Keeps the object files the jit compiles in a directory, so that compiling the same module
+// again (e.g. running the same script twice) skips codegen
+// The objects are keyed on a hash of the module as it's handed to codegen, i.e. after
+// optimization, and the salt, which has to cover everything else that affects codegen
+// (the target, llvm version, codegen options). See object_cache_salt
+// Hits and misses are counted in the profiler
+class DiskObjectCache: public llvm::ObjectCache {
+public:
+    // if the directory can't be created, is_good is set to false
+    DiskObjectCache(std::filesystem::path directory, uintmax_t max_size, std::string salt);
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module_) override;
+    void notifyObjectCompiled(const llvm::Module* module_, llvm::MemoryBufferRef object) override;
+
+    std::string key(const llvm::Module& module_) const;
+    std::filesystem::path object_path(std::string_view key) const;
+
+    // Deletes the least recently used objects until the ones left fit in max_size
+    // Hits count as uses
+    void evict();
+
+    bool is_good = true;
+
+private:
+    std::filesystem::path directory_;
+    uintmax_t max_size_;
+    std::string salt_;
+
+    // getObject is always called before notifyObjectCompiled, so the module only needs to be
+    // hashed once
+    std::mutex pending_mutex_;
+    std::unordered_map<const llvm::Module*, std::string> pending_keys_;
+};
+
+// The part of the key that doesn't come from the module, from the target triple, cpu, features,
+// the codegen options that are in use and the llvm version
+std::string object_cache_salt(std::string_view triple, std::string_view cpu,
+    std::string_view features, std::string_view codegen_options);
+
+// $XDG_CACHE_HOME/mapsc/objects or $HOME/.cache/mapsc/objects
+std::optional<std::filesystem::path> default_object_cache_directory();
+
+} // namespace LLVM_IR
+} // namespace Maps
+
+#endif
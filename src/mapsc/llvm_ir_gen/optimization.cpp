@@ -0,0 +1,96 @@
+#include "optimization.hh"
+
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "mapsc/profiler.hh"
+
+namespace Maps {
+namespace LLVM_IR {
+
+std::optional<OptimizationLevel> parse_optimization_level(std::string_view level) {
+    if (level == "0")
+        return OptimizationLevel::O0;
+    if (level == "1")
+        return OptimizationLevel::O1;
+    if (level == "2")
+        return OptimizationLevel::O2;
+    if (level == "3")
+        return OptimizationLevel::O3;
+    if (level == "s")
+        return OptimizationLevel::Os;
+
+    return std::nullopt;
+}
+
+std::string_view optimization_level_name(OptimizationLevel level) {
+    switch (level) {
+        case OptimizationLevel::O0:
+            return "-O0";
+        case OptimizationLevel::O1:
+            return "-O1";
+        case OptimizationLevel::O2:
+            return "-O2";
+        case OptimizationLevel::O3:
+            return "-O3";
+        case OptimizationLevel::Os:
+            return "-Os";
+    }
+}
+
+namespace {
+
+llvm::OptimizationLevel to_llvm(OptimizationLevel level) {
+    switch (level) {
+        case OptimizationLevel::O0:
+            return llvm::OptimizationLevel::O0;
+        case OptimizationLevel::O1:
+            return llvm::OptimizationLevel::O1;
+        case OptimizationLevel::O2:
+            return llvm::OptimizationLevel::O2;
+        case OptimizationLevel::O3:
+            return llvm::OptimizationLevel::O3;
+        case OptimizationLevel::Os:
+            return llvm::OptimizationLevel::Os;
+    }
+}
+
+} // anonymous namespace
+
+void optimize_module(llvm::Module& module_, OptimizationLevel level, 
+    llvm::TargetMachine* target_machine) {
+
+    ProfileScope profile{"optimization", "llvm"};
+
+    if (target_machine)
+        module_.setDataLayout(target_machine->createDataLayout());
+
+    // the analysis managers have to be declared in this order so that they get destroyed 
+    // in the right order
+    llvm::LoopAnalysisManager loop_analyses{};
+    llvm::FunctionAnalysisManager function_analyses{};
+    llvm::CGSCCAnalysisManager cgscc_analyses{};
+    llvm::ModuleAnalysisManager module_analyses{};
+
+    llvm::PassBuilder pass_builder{target_machine};
+
+    pass_builder.registerModuleAnalyses(module_analyses);
+    pass_builder.registerCGSCCAnalyses(cgscc_analyses);
+    pass_builder.registerFunctionAnalyses(function_analyses);
+    pass_builder.registerLoopAnalyses(loop_analyses);
+    pass_builder.crossRegisterProxies(loop_analyses, function_analyses, cgscc_analyses, 
+        module_analyses);
+
+    llvm::ModulePassManager passes = level == OptimizationLevel::O0 ?
+        pass_builder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0) :
+        pass_builder.buildPerModuleDefaultPipeline(to_llvm(level));
+
+    passes.run(module_, module_analyses);
+}
+
+} // namespace LLVM_IR
+} // namespace Maps
@@ -0,0 +1,39 @@
+#ifndef __OPTIMIZATION_HH
+#define __OPTIMIZATION_HH
+
+#include <optional>
+#include <string_view>
+
+namespace llvm { 
+    
+class Module; 
+class TargetMachine;
+
+} // namespace llvm
+
+namespace Maps {
+namespace LLVM_IR {
+
+// -O levels for the mid-level pipeline that runs on the generated modules
+enum class OptimizationLevel {
+    O0,
+    O1,
+    O2,
+    O3,
+    Os,
+};
+
+// accepts the part after "-O", i.e. "0", "1", "2", "3" or "s"
+std::optional<OptimizationLevel> parse_optimization_level(std::string_view level);
+std::string_view optimization_level_name(OptimizationLevel level);
+
+// Runs the default new pass manager pipeline for the level on the module
+// If the target machine is given, the passes get its cost model and the module its data layout
+// O0 only runs the passes that have to run (always_inline etc.)
+void optimize_module(llvm::Module& module_, OptimizationLevel level, 
+    llvm::TargetMachine* target_machine = nullptr);
+
+} // namespace LLVM_IR
+} // namespace Maps
+
+#endif
@@ -0,0 +1,266 @@
+#include "parallel_ir_gen.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/dependency_tracker.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/scope.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+
+namespace Maps {
+namespace LLVM_IR {
+
+using Log = LogInContext<LogContext::ir_gen>;
+
+namespace {
+
+struct Partition {
+    // a range of consecutive definitions
+    size_t begin;
+    size_t end;
+
+    bool success = false;
+    // the partition's module, written out so that it can be read into the shared context
+    llvm::SmallVector<char, 0> bitcode{};
+    std::vector<LogRecord> log{};
+    std::string errors{};
+};
+
+// the indices of the other definitions each definition references, in definition order so
+// that the modules don't depend on where things happen to be allocated
+std::vector<std::vector<size_t>> collect_callees(std::span<DefinitionHeader* const> definitions) {
+    std::unordered_map<const DefinitionHeader*, size_t> indices{};
+    for (size_t i = 0; i < definitions.size(); i++)
+        indices.insert({definitions[i], i});
+
+    std::vector<std::vector<size_t>> callees(definitions.size());
+
+    for (size_t i = 0; i < definitions.size(); i++) {
+        for (const DefinitionHeader* reference: collect_references(**definitions[i]->body_)) {
+            auto it = indices.find(reference);
+            if (it != indices.end() && it->second != i)
+                callees[i].push_back(it->second);
+        }
+
+        std::sort(callees[i].begin(), callees[i].end());
+    }
+
+    return callees;
+}
+
+// Splits the definitions into partitions that only depend on the definitions themselves
+// A definition that something earlier in the same partition calls starts a new one, since it 
+// will have been declared there already
+std::vector<Partition> create_partitions(const std::vector<std::vector<size_t>>& callees) {
+    std::vector<Partition> partitions{};
+    // the start of the partition that last called each definition before it was defined
+    std::vector<size_t> called_from(callees.size(), callees.size());
+    size_t begin = 0;
+
+    for (size_t i = 0; i < callees.size(); i++) {
+        if (i > begin && (i - begin >= DEFINITIONS_PER_PARTITION || called_from[i] == begin)) {
+            partitions.push_back({.begin = begin, .end = i});
+            begin = i;
+        }
+
+        for (size_t callee: callees[i]) {
+            if (callee > i)
+                called_from[callee] = begin;
+        }
+    }
+
+    if (begin < callees.size())
+        partitions.push_back({.begin = begin, .end = callees.size()});
+
+    return partitions;
+}
+
+bool generate_partition(const CompilationState& state,
+    std::span<DefinitionHeader* const> definitions,
+    const std::vector<std::vector<size_t>>& callees, const IR_Generator::Options& options,
+    Partition& partition) {
+
+    llvm::LLVMContext context{};
+    llvm::Module module_{definitions[partition.begin]->name_string(), context};
+    llvm::raw_string_ostream error_stream{partition.errors};
+
+    // everything stays external until the partitions have been linked, otherwise the
+    // declarations in the other partitions wouldn't resolve to them
+    IR_Generator generator{&context, &module_, &state, &error_stream, {
+        .verify_functions = options.verify_functions, .verify_module = options.verify_module}};
+
+    if (!declare_builtins(generator)) {
+        Log::compiler_error(definitions[partition.begin]->location()) << 
+            "Inserting IR builtins failed" << Endl;
+        return false;
+    }
+
+    // the ones in this partition are generated before anything in it calls them
+    std::vector<size_t> external_callees{};
+    for (size_t i = partition.begin; i < partition.end; i++) {
+        for (size_t callee: callees[i]) {
+            if (callee < partition.begin || callee >= partition.end)
+                external_callees.push_back(callee);
+        }
+    }
+
+    std::sort(external_callees.begin(), external_callees.end());
+    external_callees.erase(std::unique(external_callees.begin(), external_callees.end()),
+        external_callees.end());
+
+    for (size_t callee: external_callees) {
+        if (!generator.declare_global_definition(*definitions[callee]))
+            return false;
+    }
+
+    if (!generator.run(definitions.subspan(partition.begin, partition.end - partition.begin)))
+        return false;
+
+    llvm::raw_svector_ostream stream{partition.bitcode};
+    llvm::WriteBitcodeToFile(module_, stream);
+    return true;
+}
+
+bool link_partition(llvm::Linker& linker, llvm::LLVMContext& context, const Partition& partition) {
+    llvm::MemoryBufferRef buffer{
+        llvm::StringRef{partition.bitcode.data(), partition.bitcode.size()}, "partition"};
+
+    auto partition_module = llvm::parseBitcodeFile(buffer, context);
+    if (!partition_module) {
+        Log::compiler_error(NO_SOURCE_LOCATION) << "Reading a partition back failed: " <<
+            llvm::toString(partition_module.takeError()) << Endl;
+        return false;
+    }
+
+    if (linker.linkInModule(std::move(*partition_module))) {
+        Log::compiler_error(NO_SOURCE_LOCATION) << "Linking a partition failed" << Endl;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool run_ir_gen_parallel(const CompilationState& state, llvm::Module& module_,
+    std::span<DefinitionHeader* const> definitions, unsigned int thread_count,
+    llvm::raw_ostream* error_stream, IR_Generator::Options options) {
+
+    ProfileScope profile{"parallel ir gen", "llvm"};
+
+    std::vector<DefinitionHeader*> generated{};
+    for (DefinitionHeader* definition: definitions) {
+        if (definition->body_)
+            generated.push_back(definition);
+    }
+
+    auto callees = collect_callees(generated);
+    auto partitions = create_partitions(callees);
+
+    // loaded before the workers start so that the bitcode is only generated once
+    auto builtins = load_builtins(module_.getContext(), state);
+    if (!builtins) {
+        Log::compiler_error(NO_SOURCE_LOCATION) << "Loading IR builtins failed" << Endl;
+        return false;
+    }
+
+    std::atomic<size_t> next_partition = 0;
+    // the ones after the first failed one wouldn't have been generated by a serial run, so
+    // their logs are dropped
+    std::atomic<size_t> first_failed = partitions.size();
+
+    auto work = [&]() {
+        for (size_t index = next_partition++; index < partitions.size();
+            index = next_partition++) {
+
+            if (index > first_failed)
+                break;
+
+            LogStream::Capture capture{};
+            Partition& partition = partitions.at(index);
+            partition.success = generate_partition(state, generated, callees, options,
+                partition);
+            partition.log = capture.take();
+
+            if (partition.success)
+                continue;
+
+            size_t failed = first_failed;
+            while (index < failed && !first_failed.compare_exchange_weak(failed, index));
+        }
+    };
+
+    thread_count = std::min<size_t>(thread_count, partitions.size());
+
+    std::vector<std::thread> workers{};
+    for (size_t worker_index = 1; worker_index < thread_count; worker_index++)
+        workers.emplace_back(work);
+
+    work();
+
+    for (auto& worker: workers)
+        worker.join();
+
+    for (size_t index = 0; index < partitions.size() && index <= first_failed; index++) {
+        LogStream::global.write_records(std::move(partitions.at(index).log));
+        *error_stream << partitions.at(index).errors;
+    }
+
+    if (first_failed < partitions.size())
+        return false;
+
+    // linked in definition order, so which thread got to what doesn't show in the result
+    llvm::Linker linker{module_};
+    for (const Partition& partition: partitions) {
+        if (!link_partition(linker, module_.getContext(), partition))
+            return false;
+    }
+
+    IR_Generator generator{&module_.getContext(), &module_, &state, error_stream, options};
+
+    for (DefinitionHeader* definition: generated) {
+        llvm::Function* function = module_.getFunction(definition->name_string());
+        if (function && !function->isDeclaration())
+            function->setLinkage(generator.definition_linkage(definition->name_string()));
+    }
+
+    // the partitions were verified on their own, so the whole module isn't verified again
+    if (!link_builtins(generator, *builtins)) {
+        Log::compiler_error(NO_SOURCE_LOCATION) << "Linking IR builtins failed" << Endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool run_ir_gen_parallel(const CompilationState& state, llvm::Module& module_, const Scope& scope,
+    llvm::raw_ostream* error_stream, IR_Generator::Options options) {
+
+    return run_ir_gen_parallel(state, module_, scope.identifiers_in_order_,
+        state.compiler_options_.thread_count, error_stream, options);
+}
+
+} // namespace LLVM_IR
+} // namespace Maps
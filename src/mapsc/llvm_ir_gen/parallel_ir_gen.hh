@@ -0,0 +1,47 @@
+#ifndef __PARALLEL_IR_GEN_HH
+#define __PARALLEL_IR_GEN_HH
+
+#include <cstddef>
+#include <span>
+
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+
+namespace llvm {
+
+class Module;
+class raw_ostream;
+
+} // namespace llvm
+
+namespace Maps {
+
+class DefinitionHeader;
+class CompilationState;
+
+namespace LLVM_IR {
+
+// big enough that setting up the modules and linking them doesn't dominate, small enough to 
+// leave work for the other threads
+constexpr size_t DEFINITIONS_PER_PARTITION = 32;
+
+// Generates ir for the definitions into module_ on thread_count threads, for batch compilation
+// The definitions are split into partitions of up to DEFINITIONS_PER_PARTITION consecutive ones,
+// each generated in a context and module of its own with declarations of the definitions it 
+// calls from other partitions. The partitions don't depend on the thread count and are linked 
+// into module_ in order, so neither does the result. Builtins are linked in once at the end, 
+// options.entry_point works like it does for IR_Generator and the partitions are verified 
+// according to the other options.
+// Errors are logged in definition order and only up to the first failed partition, same as if
+// everything had been done on the calling thread
+bool run_ir_gen_parallel(const CompilationState& state, llvm::Module& module_,
+    std::span<DefinitionHeader* const> definitions, unsigned int thread_count,
+    llvm::raw_ostream* error_stream, IR_Generator::Options options = {});
+
+// runs on state.compiler_options_.thread_count threads
+bool run_ir_gen_parallel(const CompilationState& state, llvm::Module& module_, const Scope& scope,
+    llvm::raw_ostream* error_stream, IR_Generator::Options options = {});
+
+} // namespace LLVM_IR
+} // namespace Maps
+
+#endif
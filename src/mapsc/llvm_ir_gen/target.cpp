@@ -0,0 +1,76 @@
+#include "target.hh"
+
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/logging.hh"
+
+namespace Maps {
+namespace LLVM_IR {
+
+using Log = LogInContext<LogContext::ir_gen_init>;
+
+// detectHost fills in sys::getHostCPUName and sys::getHostCPUFeatures, and papers over the 
+// differences in their signatures between llvm versions
+std::optional<CodegenTarget> host_target() {
+    auto host = llvm::orc::JITTargetMachineBuilder::detectHost();
+
+    if (!host) {
+        Log::error(NO_SOURCE_LOCATION) << "detecting the host cpu failed: " << 
+            llvm::toString(host.takeError()) << Endl;
+        return std::nullopt;
+    }
+
+    return CodegenTarget{host->getCPU(), host->getFeatures().getString()};
+}
+
+bool apply_target_option(CodegenTarget& target, std::string_view key, std::string_view value) {
+    if (key == "-march" || key == "-mcpu") {
+        if (value != "native") {
+            target.cpu = value;
+            // the cpu brings its own features
+            if (key == "-march")
+                target.features = "";
+            return true;
+        }
+
+        auto host = host_target();
+        if (!host)
+            return false;
+
+        target.cpu = host->cpu;
+        if (key == "-march")
+            target.features = host->features;
+        return true;
+    }
+
+    if (key == "-mattr") {
+        if (value.empty())
+            return true;
+
+        if (!target.features.empty())
+            target.features += ",";
+        target.features += value;
+        return true;
+    }
+
+    return false;
+}
+
+void record_target(llvm::Module& module_, const CodegenTarget& target) {
+    for (llvm::Function& function: module_) {
+        if (function.isDeclaration())
+            continue;
+
+        function.addFnAttr("target-cpu", target.cpu);
+
+        if (!target.features.empty())
+            function.addFnAttr("target-features", target.features);
+    }
+}
+
+} // namespace LLVM_IR
+} // namespace Maps
@@ -0,0 +1,38 @@
+#ifndef __TARGET_HH
+#define __TARGET_HH
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace llvm { class Module; }
+
+namespace Maps {
+namespace LLVM_IR {
+
+// The cpu and subtarget features code gets generated for
+// features is a comma separated list in the +feature,-feature format the TargetMachine takes
+struct CodegenTarget {
+    std::string cpu = "generic";
+    std::string features = "";
+
+    bool operator==(const CodegenTarget&) const = default;
+};
+
+// asks llvm what the machine we're running on is
+std::optional<CodegenTarget> host_target();
+
+// Handles -march=, -mcpu= and -mattr= given as key and value, with "native" meaning the host
+// -march sets both the cpu and its features, -mcpu only the cpu, and -mattr adds features to 
+// whatever the target has already
+// Returns false if the key isn't one of them, or if the host couldn't be detected
+bool apply_target_option(CodegenTarget& target, std::string_view key, std::string_view value);
+
+// sets the target-cpu and target-features attributes on every function defined in the module 
+// so that the optimization passes and codegen agree on what they can use
+void record_target(llvm::Module& module_, const CodegenTarget& target);
+
+} // namespace LLVM_IR
+} // namespace Maps
+
+#endif
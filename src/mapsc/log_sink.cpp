@@ -0,0 +1,202 @@
+#include "log_sink.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <utility>
+
+#include "mapsc/source_location.hh"
+
+namespace Maps {
+
+namespace {
+
+template<typename T>
+void write_raw(std::ostream& ostream, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    ostream.write(bytes, sizeof(T));
+}
+
+template<typename T>
+bool read_raw(std::istream& istream, T& value) {
+    char bytes[sizeof(T)];
+    if (!istream.read(bytes, sizeof(T)))
+        return false;
+
+    std::memcpy(&value, bytes, sizeof(T));
+    return true;
+}
+
+} // anonymous namespace
+
+LogSink::LogSink(std::ostream* ostream, LogFormat format, bool print_context_prefixes,
+    uint64_t first_sequence)
+:ostream_(ostream), format_(format), print_context_prefixes_(print_context_prefixes),
+ next_sequence_(first_sequence) {
+    if (format_ == LogFormat::binary)
+        write_binary_header(*ostream_);
+
+    thread_ = std::thread{&LogSink::run, this};
+}
+
+LogSink::~LogSink() {
+    stop();
+}
+
+void LogSink::submit(std::vector<LogRecord>&& records) {
+    {
+        std::lock_guard lock{mutex_};
+        std::move(records.begin(), records.end(), std::back_inserter(queue_));
+    }
+    has_records_.notify_one();
+}
+
+void LogSink::stop() {
+    {
+        std::lock_guard lock{mutex_};
+        if (stopping_)
+            return;
+
+        stopping_ = true;
+    }
+    has_records_.notify_one();
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void LogSink::run() {
+    std::vector<LogRecord> records{};
+
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock lock{mutex_};
+            has_records_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            std::swap(records, queue_);
+            stopping = stopping_;
+        }
+
+        write(records, stopping);
+        records.clear();
+
+        if (stopping)
+            return;
+    }
+}
+
+void LogSink::write(std::vector<LogRecord>& records, bool stopping) {
+    for (LogRecord& record: records) {
+        if (record.loglevel > LogLevel::error) {
+            reorder_buffer_.emplace(record.sequence, std::move(record));
+            continue;
+        }
+
+        write_record(record);
+        reorder_buffer_.emplace(record.sequence, std::nullopt);
+    }
+
+    auto it = reorder_buffer_.begin();
+    for (; it != reorder_buffer_.end() && (stopping || it->first <= next_sequence_);
+        it = reorder_buffer_.erase(it)) {
+
+        if (it->second)
+            write_record(*it->second);
+
+        next_sequence_ = std::max(next_sequence_, it->first + 1);
+    }
+
+    ostream_->flush();
+}
+
+void LogSink::write_record(const LogRecord& record) {
+    if (format_ == LogFormat::binary) {
+        write_binary_record(*ostream_, record);
+    } else {
+        write_text_record(*ostream_, record, print_context_prefixes_);
+    }
+}
+
+void write_text_record(std::ostream& ostream, const LogRecord& record, 
+    bool print_context_prefix) {
+
+    SourceLocation{record.line, record.column, record.source_id}.log_self_to_with_padding(
+        ostream, LogStream::Options::LINE_PADDING, LogStream::Options::COL_PADDING) << ' ' << 
+            std::setw(LogStream::Options::LOGLEVEL_PREFIX_PADDING) << 
+            loglevel_prefix(record.loglevel);
+
+    if (print_context_prefix)
+        ostream << context_prefix(record.context);
+
+    ostream << record.message;
+}
+
+void write_binary_header(std::ostream& ostream) {
+    ostream.write(BINARY_LOG_MAGIC.data(), BINARY_LOG_MAGIC.size());
+}
+
+void write_binary_record(std::ostream& ostream, const LogRecord& record) {
+    write_raw<uint64_t>(ostream, record.sequence);
+    write_raw<uint8_t>(ostream, static_cast<uint8_t>(record.context));
+    write_raw<uint8_t>(ostream, static_cast<uint8_t>(record.loglevel));
+    write_raw<int32_t>(ostream, record.line);
+    write_raw<int32_t>(ostream, record.column);
+    write_raw<int32_t>(ostream, record.source_id);
+    write_raw<uint32_t>(ostream, record.message.size());
+    ostream.write(record.message.data(), record.message.size());
+}
+
+bool read_binary_header(std::istream& istream) {
+    std::string magic(BINARY_LOG_MAGIC.size(), '\0');
+    if (!istream.read(magic.data(), magic.size()))
+        return false;
+
+    return magic == BINARY_LOG_MAGIC;
+}
+
+std::optional<LogRecord> read_binary_record(std::istream& istream) {
+    LogRecord record{};
+    uint8_t context, loglevel;
+    int32_t line, column, source_id;
+    uint32_t length;
+
+    if (!read_raw(istream, record.sequence) || 
+        !read_raw(istream, context) || !read_raw(istream, loglevel) ||
+        !read_raw(istream, line) || !read_raw(istream, column) || !read_raw(istream, source_id) ||
+        !read_raw(istream, length))
+        return std::nullopt;
+
+    if (context >= LOG_CONTEXT_COUNT || loglevel > static_cast<uint8_t>(LogLevel::debug_extra))
+        return std::nullopt;
+
+    record.context = static_cast<LogContext>(context);
+    record.loglevel = static_cast<LogLevel>(loglevel);
+    record.line = line;
+    record.column = column;
+    record.source_id = source_id;
+
+    record.message.resize(length);
+    if (!istream.read(record.message.data(), length))
+        return std::nullopt;
+
+    return record;
+}
+
+bool decode_binary_log(std::istream& istream, std::ostream& ostream, 
+    bool print_context_prefixes) {
+    if (!read_binary_header(istream))
+        return false;
+
+    while (istream.peek() != std::istream::traits_type::eof()) {
+        auto record = read_binary_record(istream);
+        if (!record)
+            return false;
+
+        write_text_record(ostream, *record, print_context_prefixes);
+    }
+
+    return true;
+}
+
+} // namespace Maps
@@ -0,0 +1,81 @@
+#ifndef __LOG_SINK_HH
+#define __LOG_SINK_HH
+
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "mapsc/logging.hh"
+
+namespace Maps {
+
+// Background thread that writes out batches of log records handed to it by LogStream
+// Records are written in sequence order. The ones that arrive while an earlier one is still in 
+// some thread's batch wait in a reorder buffer until it turns up, or until the sink is stopped.
+// Errors are the exception, they're written as soon as they arrive so that a thread sitting on 
+// its batch can't hold them back
+class LogSink {
+public:
+    // first_sequence is the sequence number of the first record it's going to get
+    LogSink(std::ostream* ostream, LogFormat format, bool print_context_prefixes = false,
+        uint64_t first_sequence = 0);
+    ~LogSink();
+
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    void submit(std::vector<LogRecord>&& records);
+    // writes out everything submitted so far and joins the thread
+    void stop();
+
+private:
+    void run();
+    // writes out the records that follow on from the ones written so far, or all of them if 
+    // nothing more is coming
+    void write(std::vector<LogRecord>& records, bool stopping);
+    void write_record(const LogRecord& record);
+
+    std::ostream* ostream_;
+    LogFormat format_;
+    bool print_context_prefixes_;
+
+    // only touched by the sink thread
+    // errors that were written ahead of their turn are kept as nullopt to fill their place
+    std::map<uint64_t, std::optional<LogRecord>> reorder_buffer_{};
+    uint64_t next_sequence_;
+
+    std::mutex mutex_;
+    std::condition_variable has_records_;
+    std::vector<LogRecord> queue_{};
+    bool stopping_ = false;
+
+    std::thread thread_;
+};
+
+// Binary format: the magic bytes followed by records of
+//   u64 sequence | u8 context | u8 loglevel | i32 line | i32 column | i32 source_id | 
+//   u32 message length | message bytes
+// in host byte order
+constexpr std::string_view BINARY_LOG_MAGIC = "MAPSLOG1";
+
+void write_text_record(std::ostream& ostream, const LogRecord& record, 
+    bool print_context_prefix = false);
+void write_binary_header(std::ostream& ostream);
+void write_binary_record(std::ostream& ostream, const LogRecord& record);
+
+bool read_binary_header(std::istream& istream);
+std::optional<LogRecord> read_binary_record(std::istream& istream);
+
+// Converts a binary log into the text format, returns false if the input was malformed
+bool decode_binary_log(std::istream& istream, std::ostream& ostream, 
+    bool print_context_prefixes = false);
+
+} // namespace Maps
+
+#endif
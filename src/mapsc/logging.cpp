@@ -3,16 +3,19 @@
 #include <iomanip>
 #include <cassert>
 #include <optional>
+#include <utility>
 
 #include "mapsc/source_location.hh"
+#include "mapsc/log_sink.hh"
 
 namespace Maps {
 
 LogStream LogStream::global{};
+thread_local LogStream::ThreadState LogStream::thread_state_{};
 
 namespace {
 
-bool log_check_flag = false;
+std::atomic<bool> log_check_flag = false;
 
 constexpr std::string_view prefix(LogContext context) {
     switch (context) {
@@ -45,15 +48,15 @@ constexpr std::string_view prefix(LogContext context) {
         case LogContext::dsir_parser:
             return "in dsir parser: ";
         case LogContext::definition_creation:
-            return "during definition creation";
+            return "during definition creation: ";
         case LogContext::transform_stage:
-            return "in transform stage";
+            return "in transform stage: ";
         case LogContext::type_checks:
-            return "in type checks";
+            return "in type checks: ";
         case LogContext::type_casts:
-            return "in type cast";
+            return "in type cast: ";
         case LogContext::eval:
-            return "during compile time evaluation";
+            return "during compile time evaluation: ";
     }
 }
 
@@ -76,6 +79,30 @@ constexpr std::string_view prefix(LogLevel loglevel) {
 
 } // anonymous namespace
 
+std::string_view loglevel_prefix(LogLevel loglevel) {
+    return prefix(loglevel);
+}
+
+std::string_view context_prefix(LogContext context) {
+    return prefix(context);
+}
+
+LogStream::LogStream() = default;
+LogStream::LogStream(Options options): options_(options) {}
+
+LogStream::~LogStream() {
+    stop_async();
+}
+
+// thread_state_ is being destroyed, so this can't go through flush
+LogStream::ThreadState::~ThreadState() {
+    if (pending_stream)
+        pending_stream->complete_message(*this);
+
+    if (batch_stream)
+        batch_stream->submit_batch(*this);
+}
+
 LogStream::Options::Lock::~Lock() {
     options_->set_loglevel(DEFAULT_LOGLEVEL);
     options_->locked_ = false;
@@ -123,9 +150,7 @@ inline uint line_col_padding(const SourceLocation& location) {
 }
 
 bool logs_since_last_check() {
-    bool value = log_check_flag;
-    log_check_flag = false;
-    return value;
+    return log_check_flag.exchange(false);
 }
 
 std::optional<std::unique_ptr<LogStream::Options::Lock>> LogStream::lock() {
@@ -155,22 +180,158 @@ std::optional<std::unique_ptr<LogStream::Options::Lock>> LogStream::set_loglevel
 }
 
 LogStream& LogStream::begin(LogContext logcontext, LogLevel loglevel, const SourceLocation& location) {
-    is_open_ = options_.get_loglevel(logcontext) >= loglevel;
+    ThreadState& state = thread_state_;
+
+    if (state.pending_stream)
+        state.pending_stream->complete_message(state);
+
+    state.is_open = is_enabled(logcontext, loglevel);
 
-    if (!is_open_)
+    if (!state.is_open)
         return *this;
 
     log_check_flag = true;
 
+    if (async_ || state.capture) {
+        state.pending_stream = this;
+        // captured records get their sequence numbers from write_records, taking them here 
+        // would leave gaps that the sink would wait on
+        state.pending = {state.capture ? 0 : next_sequence_++, logcontext, loglevel, 
+            location.line, location.column, location.source_id, ""};
+        return *this;
+    }
+
     location.log_self_to_with_padding(*options_.inner_stream, options_.LINE_PADDING, 
         options_.COL_PADDING) << ' ' << std::setw(options_.LOGLEVEL_PREFIX_PADDING) << prefix(loglevel);
                 
-    // if (global_options.print_context_prefixes)
-    //     *global_options.ostream << context_prefix;
+    if (options_.print_context_prefixes)
+        *options_.inner_stream << prefix(logcontext);
 
     return *this;
 }
 
-    
+void LogStream::complete_message(ThreadState& state) {
+    state.pending.message = state.message.str();
+    state.message.str("");
+    state.pending_stream = nullptr;
+
+    if (state.capture) {
+        state.capture->push_back(std::move(state.pending));
+        return;
+    }
+
+    // a batch only goes to one stream
+    if (state.batch_stream != this) {
+        if (state.batch_stream)
+            state.batch_stream->submit_batch(state);
+
+        state.batch_stream = this;
+    }
+
+    state.batch.push_back(std::move(state.pending));
+
+    // errors shouldn't wait for the batch to fill up
+    if (state.batch.size() >= BATCH_SIZE || state.batch.back().loglevel <= LogLevel::error)
+        submit_batch(state);
+}
+
+void LogStream::submit_batch(ThreadState& state) {
+    if (state.batch.empty())
+        return;
+
+    {
+        std::shared_lock lock{sink_mutex_};
+
+        if (sink_) {
+            sink_->submit(std::move(state.batch));
+        } else {
+            // the sink has been stopped already, just write them out
+            for (const LogRecord& record: state.batch)
+                write_text_record(*options_.inner_stream, record, options_.print_context_prefixes);
+        }
+    }
+
+    state.batch.clear();
+    state.batch_stream = nullptr;
+}
+
+void LogStream::flush() {
+    ThreadState& state = thread_state_;
+
+    if (state.pending_stream == this)
+        complete_message(state);
+
+    submit_batch(state);
+}
+
+void LogStream::write_records(std::vector<LogRecord> records) {
+    std::shared_lock lock{sink_mutex_};
+
+    if (!sink_) {
+        for (const LogRecord& record: records)
+            write_text_record(*options_.inner_stream, record, options_.print_context_prefixes);
+        return;
+    }
+
+    for (LogRecord& record: records)
+        record.sequence = next_sequence_++;
+
+    sink_->submit(std::move(records));
+}
+
+LogStream::Capture::Capture(LogStream& stream)
+:stream_(&stream), previous_(thread_state_.capture) {
+    ThreadState& state = thread_state_;
+    if (state.pending_stream)
+        state.pending_stream->complete_message(state);
+
+    state.capture = &records_;
+}
+
+LogStream::Capture::~Capture() {
+    ThreadState& state = thread_state_;
+    if (state.pending_stream)
+        state.pending_stream->complete_message(state);
+
+    state.capture = previous_;
+}
+
+std::vector<LogRecord> LogStream::Capture::take() {
+    ThreadState& state = thread_state_;
+    if (state.pending_stream == stream_)
+        stream_->complete_message(state);
+
+    return std::move(records_);
+}
+
+bool LogStream::start_async() {
+    std::unique_lock lock{sink_mutex_};
+
+    if (sink_)
+        return true;
+
+    // nothing takes sequence numbers before async_ is set, so this is where the sink starts
+    sink_ = std::make_unique<LogSink>(options_.inner_stream, options_.format, 
+        options_.print_context_prefixes, next_sequence_);
+    async_ = true;
+    return true;
+}
+
+void LogStream::stop_async() {
+    if (!async_)
+        return;
+
+    flush();
+
+    // threads that submit while this waits for the sink get the lock after it's gone and 
+    // write their records out themselves
+    std::unique_lock lock{sink_mutex_};
+    if (!sink_)
+        return;
+
+    async_ = false;
+    sink_->stop();
+    sink_.reset();
+}
 
 } //namespace Maps
\ No newline at end of file
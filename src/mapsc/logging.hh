@@ -2,11 +2,19 @@
 #define __LOGGING_HH
 
 #include <memory>
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
 #include <string_view>
 #include <iostream>
 #include <optional>
+#include <shared_mutex>
+#include <sstream>
+#include <vector>
 
 #include "common/array_helpers.hh"
 
@@ -54,7 +62,58 @@ constexpr LogLevels set_all(LogLevel log_level) {
     return log_levels;
 }
 
+// Compile time ceiling for the loglevels, set with the MAPS_MAX_LOGLEVEL cmake option
+// Calls to levels above the ceiling compile to a no-op stream
+#ifndef MAPS_MAX_LOGLEVEL
+#define MAPS_MAX_LOGLEVEL debug_extra
+#endif
+
+constexpr LogLevel MAX_LOGLEVEL = LogLevel::MAPS_MAX_LOGLEVEL;
+
+// Per-context ceilings, set with the MAPS_CONTEXT_MAX_LOGLEVELS cmake option as a list of
+// context=level pairs, which cmake turns into {LogContext::context, LogLevel::level} entries
+#ifndef MAPS_CONTEXT_MAX_LOGLEVELS
+#define MAPS_CONTEXT_MAX_LOGLEVELS
+#endif
+
+struct ContextLogLevel {
+    LogContext context;
+    LogLevel loglevel;
+};
+
+constexpr LogLevels create_max_loglevels(std::initializer_list<ContextLogLevel> overrides) {
+    LogLevels log_levels = set_all(MAX_LOGLEVEL);
+    for (auto [context, loglevel]: overrides)
+        log_levels[static_cast<size_t>(context)] = loglevel;
+    return log_levels;
+}
+
+constexpr LogLevels MAX_LOGLEVELS = create_max_loglevels({MAPS_CONTEXT_MAX_LOGLEVELS});
+
+constexpr LogLevel max_loglevel(LogContext context) {
+    return std::min(MAX_LOGLEVEL, MAX_LOGLEVELS[static_cast<size_t>(context)]);
+}
+
 class LogStream;
+class LogSink;
+
+enum class LogFormat {
+    text,
+    // see log_sink.hh for the layout
+    binary,
+};
+
+// A complete log message, used when logging asynchronously
+// The location is stored as plain ints so that this header doesn't need source_location.hh
+struct LogRecord {
+    uint64_t sequence;
+    LogContext context;
+    LogLevel loglevel;
+    int line;
+    int column;
+    int source_id;
+    std::string message;
+};
 
 template<typename Stream, typename T>
 concept LogsSelf = requires (Stream stream, T t) { t.log_self_to(stream); };
@@ -103,6 +162,12 @@ public:
         LogLevels loglevels_ = set_all(DEFAULT_LOGLEVEL);
         InnerStream* inner_stream = &std::cout;
         bool print_context_prefixes = false;
+
+        // these are read by start_async
+        bool asynchronous = false;
+        LogFormat format = LogFormat::text;
+        // if not empty, the caller should open this and point inner_stream to it
+        std::string log_file_path = "";
         
         [[nodiscard]] std::optional<std::unique_ptr<Lock>> get_lock();
 
@@ -113,51 +178,127 @@ public:
         bool locked_ = false;
     };
 
+    // Collects the calling thread's messages instead of writing them out, so that work done
+    // in parallel can be logged in a deterministic order afterwards with write_records
+    class Capture {
+    public:
+        Capture(LogStream& stream = global);
+        ~Capture();
+        Capture(const Capture&) = delete;
+        Capture& operator=(const Capture&) = delete;
+
+        std::vector<LogRecord> take();
+
+    private:
+        LogStream* stream_;
+        std::vector<LogRecord> records_{};
+        std::vector<LogRecord>* previous_;
+    };
+
     static LogStream global;
 
-    LogStream() = default;
-    LogStream(Options options): options_(options) {}
+    LogStream();
+    LogStream(Options options);
+    ~LogStream();
 
     template<typename T>
         requires LogsSelf<InnerStream, T>
     LogStream& operator<<(const T& logs_self) {
-        if (!is_open_)
+        if (!thread_state_.is_open)
             return *this;
 
-        logs_self.log_self_to(*options_.inner_stream);
+        logs_self.log_self_to(output_stream());
         return *this;
     }
 
     template<typename T>
         requires Loggable<InnerStream, T>
     LogStream& operator<<(const T& loggable) {
-        if (!is_open_)
+        if (!thread_state_.is_open)
             return *this;
 
-        *options_.inner_stream << loggable.log_representation();
+        output_stream() << loggable.log_representation();
         return *this;
     }
 
     template<typename T>
         requires Printable<InnerStream, T>
     LogStream& operator<<(T t) {
-        if (!is_open_)
+        if (!thread_state_.is_open)
             return *this;
 
-        *options_.inner_stream << t;
+        output_stream() << t;
         return *this;
     }
 
     LogStream& begin(LogContext logcontext, LogLevel loglevel, const SourceLocation& location);
 
+    bool is_enabled(LogContext logcontext, LogLevel loglevel) const {
+        return options_.get_loglevel(logcontext) >= loglevel;
+    }
+
+    // Starts a background thread that writes the messages to options.inner_stream in 
+    // options.format. Each thread buffers its messages and hands them over in batches 
+    bool start_async();
+    // Flushes the calling thread and waits for the sink to write everything out
+    // Other threads' batches are handed over when they exit or call flush, after the sink has 
+    // stopped they're written out directly
+    void stop_async();
+    bool is_async() const { return async_; }
+
+    // hands the calling thread's buffered messages to the sink
+    void flush();
+
+    // writes out records collected by a Capture as if they were logged just now
+    void write_records(std::vector<LogRecord> records);
+
     [[nodiscard]] std::optional<std::unique_ptr<Options::Lock>> lock();
     [[nodiscard]] std::optional<std::unique_ptr<Options::Lock>> set_loglevel(LogLevel level);
     [[nodiscard]] std::optional<std::unique_ptr<Options::Lock>> set_loglevel(LogContext context, LogLevel loglevel);
 
 private:
+    // Whether the current message is open is per-thread so that threads logging at different
+    // levels don't race. When logging asynchronously the message text goes into the buffer
+    struct ThreadState {
+        ~ThreadState();
+
+        bool is_open = true;
+
+        LogStream* pending_stream = nullptr;
+        LogRecord pending{};
+        std::ostringstream message{};
+        std::vector<LogRecord> batch{};
+        // the stream the batch belongs to
+        LogStream* batch_stream = nullptr;
+        // set while a Capture is active on this thread
+        std::vector<LogRecord>* capture = nullptr;
+    };
+
+    static constexpr size_t BATCH_SIZE = 64;
+    static thread_local ThreadState thread_state_;
+
+    InnerStream& output_stream() {
+        return thread_state_.pending_stream ? thread_state_.message : *options_.inner_stream;
+    }
+
+    void complete_message(ThreadState& state);
+    void submit_batch(ThreadState& state);
+
     Options options_ = {};
-    
-    bool is_open_ = true;
+    // held shared while handing records to the sink and exclusively while replacing it
+    std::shared_mutex sink_mutex_;
+    std::unique_ptr<LogSink> sink_;
+    std::atomic<bool> async_ = false;
+    std::atomic<uint64_t> next_sequence_ = 0;
+};
+
+// Returned by LogInContext for levels above the compile time ceiling
+// NOTE: the arguments are still evaluated if they have side effects, use the forms of the log
+// calls that take the message as a lambda where that matters
+class NullLogStream {
+public:
+    template<typename T>
+    constexpr const NullLogStream& operator<<(const T&) const { return *this; }
 };
 
 constexpr char Endl = '\n';
@@ -168,30 +309,77 @@ static_assert(Printable<LogStream::InnerStream, typeof(Endl)>);
 template <LogContext context>
 class LogInContext {
 public:
-    static LogStream& compiler_error(const SourceLocation& location) {
-        return LogStream::global.begin(context, LogLevel::compiler_error, location);
+    template<LogLevel loglevel>
+    static constexpr bool is_enabled = loglevel <= max_loglevel(context);
+
+    static decltype(auto) compiler_error(const SourceLocation& location) {
+        return begin<LogLevel::compiler_error>(location);
     }
-    static LogStream& error(const SourceLocation& location) {
-        return LogStream::global.begin(context, LogLevel::error, location);
+    static decltype(auto) error(const SourceLocation& location) {
+        return begin<LogLevel::error>(location);
     }
-    static LogStream& warning(const SourceLocation& location) {
-        return LogStream::global.begin(context, LogLevel::warning, location);
+    static decltype(auto) warning(const SourceLocation& location) {
+        return begin<LogLevel::warning>(location);
     }
-    static LogStream& info(const SourceLocation& location) {
-        return LogStream::global.begin(context, LogLevel::info, location);
+    static decltype(auto) info(const SourceLocation& location) {
+        return begin<LogLevel::info>(location);
     }
-    static LogStream& debug(const SourceLocation& location) {
-        return LogStream::global.begin(context, LogLevel::debug, location);
+    static decltype(auto) debug(const SourceLocation& location) {
+        return begin<LogLevel::debug>(location);
     }
-    static LogStream& debug_extra(const SourceLocation& location) {
-        return LogStream::global.begin(context, LogLevel::debug_extra, location);
+    static decltype(auto) debug_extra(const SourceLocation& location) {
+        return begin<LogLevel::debug_extra>(location);
+    }
+
+    // These only call message with the stream if the message is going to be logged, e.g.
+    //     Log::debug_extra(location, [&](auto& log) { log << "Token " << token << Endl; });
+    // Above the compile time ceiling the whole call compiles to nothing, so this is the one
+    // to use on hot paths
+    static void compiler_error(const SourceLocation& location, auto&& message) {
+        log<LogLevel::compiler_error>(location, message);
+    }
+    static void error(const SourceLocation& location, auto&& message) {
+        log<LogLevel::error>(location, message);
+    }
+    static void warning(const SourceLocation& location, auto&& message) {
+        log<LogLevel::warning>(location, message);
+    }
+    static void info(const SourceLocation& location, auto&& message) {
+        log<LogLevel::info>(location, message);
+    }
+    static void debug(const SourceLocation& location, auto&& message) {
+        log<LogLevel::debug>(location, message);
+    }
+    static void debug_extra(const SourceLocation& location, auto&& message) {
+        log<LogLevel::debug_extra>(location, message);
     }
 
     LogInContext() = delete;
+
+private:
+    template<LogLevel loglevel>
+    static decltype(auto) begin(const SourceLocation& location) {
+        if constexpr (is_enabled<loglevel>) {
+            return LogStream::global.begin(context, loglevel, location);
+        } else {
+            return NullLogStream{};
+        }
+    }
+
+    template<LogLevel loglevel>
+    static void log(const SourceLocation& location, auto& message) {
+        if constexpr (is_enabled<loglevel>) {
+            if (LogStream::global.is_enabled(context, loglevel))
+                message(LogStream::global.begin(context, loglevel, location));
+        }
+    }
 };
 
 using LogNoContext = LogInContext<LogContext::no_context>;
 
+std::string_view loglevel_prefix(LogLevel loglevel);
+std::string_view context_prefix(LogContext context);
+
 } // namespace Maps
 
 #endif
\ No newline at end of file
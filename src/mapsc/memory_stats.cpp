@@ -0,0 +1,76 @@
+#include "memory_stats.hh"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace Maps {
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) {
+    count += other.count;
+    node_bytes += other.node_bytes;
+    payload_bytes += other.payload_bytes;
+    return *this;
+}
+
+void MemoryStats::add(std::string_view kind, size_t node_bytes, size_t payload_bytes) {
+    auto it = kinds_.find(kind);
+    if (it == kinds_.end())
+        it = kinds_.insert({std::string{kind}, MemoryUsage{}}).first;
+
+    it->second += MemoryUsage{1, node_bytes, payload_bytes};
+}
+
+MemoryStats& MemoryStats::operator+=(const MemoryStats& other) {
+    for (const auto& [kind, usage]: other.kinds_)
+        kinds_[kind] += usage;
+
+    overhead_bytes_ += other.overhead_bytes_;
+    return *this;
+}
+
+std::optional<MemoryUsage> MemoryStats::get(std::string_view kind) const {
+    auto it = kinds_.find(kind);
+    if (it == kinds_.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+size_t MemoryStats::node_count() const {
+    size_t count = 0;
+    for (const auto& [_, usage]: kinds_)
+        count += usage.count;
+
+    return count;
+}
+
+size_t MemoryStats::total_bytes() const {
+    size_t bytes = overhead_bytes_;
+    for (const auto& [_, usage]: kinds_)
+        bytes += usage.total_bytes();
+
+    return bytes;
+}
+
+void MemoryStats::write_report(std::ostream& ostream) const {
+    std::vector<std::pair<std::string_view, MemoryUsage>> sorted{kinds_.begin(), kinds_.end()};
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.total_bytes() > rhs.second.total_bytes();
+    });
+
+    ostream << std::left << std::setw(40) << "kind" << std::right << std::setw(10) << "count" <<
+        std::setw(14) << "node bytes" << std::setw(14) << "payload bytes" << '\n';
+
+    for (const auto& [kind, usage]: sorted) {
+        ostream << std::left << std::setw(40) << kind << std::right << 
+            std::setw(10) << usage.count << std::setw(14) << usage.node_bytes << 
+            std::setw(14) << usage.payload_bytes << '\n';
+    }
+
+    ostream << std::left << std::setw(40) << "store overhead" << std::right << std::setw(38) << 
+        overhead_bytes_ << '\n';
+    ostream << std::left << std::setw(40) << "total" << std::right << std::setw(38) << 
+        total_bytes() << '\n';
+}
+
+} // namespace Maps
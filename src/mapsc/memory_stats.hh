@@ -0,0 +1,93 @@
+#ifndef __MEMORY_STATS_HH
+#define __MEMORY_STATS_HH
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Maps {
+
+// heap memory owned by a string, 0 if it fits in the small string buffer
+inline size_t heap_bytes(const std::string& string) {
+    auto data = string.data();
+    auto self = reinterpret_cast<const char*>(&string);
+
+    if (!std::less<const char*>{}(data, self) && std::less<const char*>{}(data, self + sizeof(string)))
+        return 0;
+
+    return string.capacity() + 1;
+}
+
+template <typename T>
+size_t heap_bytes(const std::vector<T>& vector) {
+    return vector.capacity() * sizeof(T);
+}
+
+template <typename T>
+size_t heap_bytes(const std::optional<T>& optional) {
+    return optional ? heap_bytes(*optional) : 0;
+}
+
+// std::map nodes in both libstdc++ and libc++ are three pointers and a color on top of the value
+template <typename Key, typename Value, typename Compare>
+size_t heap_bytes(const std::map<Key, Value, Compare>& map) {
+    constexpr size_t NODE_OVERHEAD = 4 * sizeof(void*);
+    size_t bytes = map.size() * (sizeof(typename std::map<Key, Value, Compare>::value_type) +
+        NODE_OVERHEAD);
+
+    if constexpr (std::is_same_v<Key, std::string>) {
+        for (const auto& [key, _]: map)
+            bytes += heap_bytes(key);
+    }
+
+    return bytes;
+}
+
+struct MemoryUsage {
+    size_t count = 0;
+    // sizeof the nodes themselves
+    size_t node_bytes = 0;
+    // heap memory owned by the nodes, such as term vectors and strings
+    size_t payload_bytes = 0;
+
+    size_t total_bytes() const { return node_bytes + payload_bytes; }
+
+    MemoryUsage& operator+=(const MemoryUsage& other);
+    bool operator==(const MemoryUsage&) const = default;
+};
+
+// Live memory of the compiler data structures broken down by node kind
+// Kinds are strings like "expression:call" so that the stores can name them however they like
+class MemoryStats {
+public:
+    void add(std::string_view kind, size_t node_bytes, size_t payload_bytes = 0);
+    // memory used by the stores themselves rather than any single node
+    void add_overhead(size_t bytes) { overhead_bytes_ += bytes; }
+
+    MemoryStats& operator+=(const MemoryStats& other);
+
+    std::optional<MemoryUsage> get(std::string_view kind) const;
+    const std::map<std::string, MemoryUsage, std::less<>>& kinds() const { return kinds_; }
+
+    size_t node_count() const;
+    size_t overhead_bytes() const { return overhead_bytes_; }
+    size_t total_bytes() const;
+
+    // largest kinds first
+    void write_report(std::ostream& ostream) const;
+
+private:
+    std::map<std::string, MemoryUsage, std::less<>> kinds_ = {};
+    size_t overhead_bytes_ = 0;
+};
+
+} // namespace Maps
+
+#endif
@@ -40,7 +40,8 @@ Chunk ParserLayer1::parse_top_level_chunk() {
         default:
             auto statement = parse_statement();
             if (statement->statement_type != StatementType::empty && !statement->is_definition() &&
-                (pragma_store_->check_flag_value("top-level evaluation", statement->location) || 
+                (pragma_store_->check_flag_value(
+                    PragmaFlagId::top_level_evaluation_context, statement->location) || 
                     force_top_level_eval_)) {            
                 std::get<Block>(std::get<Statement*>(
                     (*result_.top_level_definition)->body())->value)
@@ -45,7 +45,7 @@ Layer1Result ParserLayer1::run_eval(std::istream& source_is) {
     force_top_level_eval_ = false;
 
     if (*result_.top_level_definition)
-        simplify(*(*result_.top_level_definition));
+        simplify(*ast_store_, *(*result_.top_level_definition));
 
     if (!result_.top_level_definition) {
         Log::debug(NO_SOURCE_LOCATION) << "Layer1 eval didn't produce a top level definition" << Endl;
@@ -58,6 +58,11 @@ Layer1Result ParserLayer1::run_eval(std::istream& source_is) {
         
     } else if (std::holds_alternative<Undefined>((*result_.top_level_definition)->get_value())) {
         result_.top_level_definition = nullopt;
+
+    } else if (auto statement = std::get_if<Statement*>(&(*result_.top_level_definition)->body());
+        statement && (*statement)->statement_type == StatementType::empty) {
+        // nothing to evaluate
+        result_.top_level_definition = nullopt;
     }
 
     return result_;
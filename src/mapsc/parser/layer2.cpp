@@ -1,19 +1,136 @@
 #include "layer2.hh"
 #include "layer2/implementation.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+
+#include "common/std_visit_helper.hh"
+
 #include "mapsc/logging.hh"
+#include "mapsc/compilation_state.hh"
 #include "mapsc/ast/expression.hh"
 
 namespace Maps {
 
 using Log = LogInContext<LogContext::layer2>;
 
-bool run_layer2(CompilationState& state, Expression* expression) {    
+namespace {
+
+void push_sub_expressions(const Expression* expression, std::vector<Expression*>& stack) {
+    auto push = [&stack](Expression* sub_expression) {
+        if (sub_expression)
+            stack.push_back(sub_expression);
+    };
+
+    std::visit(overloaded {
+        [&push](Expression* sub_expression) { push(sub_expression); },
+        [&push](const TermedExpressionValue& termed) {
+            for (Expression* term: termed.terms)
+                push(term);
+        },
+        [&push](const CallExpressionValue& call) {
+            for (Expression* arg: std::get<1>(call))
+                push(arg);
+        },
+        [&push](const TernaryExpressionValue& ternary) {
+            push(ternary.condition);
+            push(ternary.success);
+            push(ternary.failure);
+        },
+        [&push](const TypeArgument& argument) { push(std::get<0>(argument)); },
+        [&push](const TypeConstruct& construct) {
+            push(std::get<0>(construct));
+            for (Expression* argument: std::get<1>(construct))
+                push(argument);
+        },
+        [](const auto&) {}
+    }, expression->value);
+}
+
+} // anonymous namespace
+
+std::vector<std::vector<Expression*>> group_layer2_expressions(
+    const std::vector<Expression*>& expressions) {
+
+    // union-find where the root is always the group member that comes first
+    std::vector<size_t> parents(expressions.size());
+    std::iota(parents.begin(), parents.end(), 0);
+
+    auto find = [&parents](size_t index) {
+        while (parents[index] != index) {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    };
+
+    auto unite = [&parents, &find](size_t lhs, size_t rhs) {
+        size_t lhs_root = find(lhs);
+        size_t rhs_root = find(rhs);
+        parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+    };
+
+    // the first listed expression whose tree reached each node
+    std::unordered_map<const Expression*, size_t> owners{};
+
+    for (size_t index = 0; index < expressions.size(); index++) {
+        auto [it, inserted] = owners.insert({expressions[index], index});
+        if (!inserted)
+            unite(it->second, index);
+    }
+
+    std::vector<Expression*> stack{};
+
+    for (size_t index = 0; index < expressions.size(); index++) {
+        push_sub_expressions(expressions[index], stack);
+
+        while (!stack.empty()) {
+            Expression* sub_expression = stack.back();
+            stack.pop_back();
+
+            // listed expressions are walked on their own turn and shared nodes only once
+            auto [it, inserted] = owners.insert({sub_expression, index});
+            if (!inserted) {
+                unite(it->second, index);
+                continue;
+            }
+
+            push_sub_expressions(sub_expression, stack);
+        }
+    }
+
+    std::vector<std::vector<Expression*>> groups{};
+    std::vector<size_t> group_indices(expressions.size());
+
+    for (size_t index = 0; index < expressions.size(); index++) {
+        size_t root = find(index);
+
+        if (root == index) {
+            group_indices[index] = groups.size();
+            groups.push_back({});
+        }
+
+        groups.at(group_indices[root]).push_back(expressions[index]);
+    }
+
+    return groups;
+}
+
+bool run_layer2(CompilationState& state, Expression* expression) {
     Log::debug_extra(expression->location) << "Running layer2 on " << *expression << Endl;
     return TermedExpressionParser{&state, expression}.run();
 }
 
 bool run_layer2(CompilationState& state, std::vector<Expression*>& unparsed_termed_expressions) {
+    if (state.compiler_options_.thread_count > 1 && unparsed_termed_expressions.size() > 1)
+        return run_layer2_parallel(state, unparsed_termed_expressions,
+            state.compiler_options_.thread_count);
+
     for (Expression* expression: unparsed_termed_expressions) {
         if (!run_layer2(state, expression))
             return false;
@@ -21,4 +138,80 @@ bool run_layer2(CompilationState& state, std::vector<Expression*>& unparsed_term
     return true;
 }
 
+bool run_layer2_parallel(CompilationState& state,
+    std::vector<Expression*>& unparsed_termed_expressions, unsigned int thread_count) {
+
+    auto groups = group_layer2_expressions(unparsed_termed_expressions);
+    thread_count = std::min<size_t>(thread_count, groups.size());
+
+    if (thread_count <= 1) {
+        for (Expression* expression: unparsed_termed_expressions) {
+            if (!run_layer2(state, expression))
+                return false;
+        }
+        return true;
+    }
+
+    struct GroupResult {
+        bool success = true;
+        std::vector<LogRecord> log{};
+    };
+
+    std::vector<GroupResult> results(groups.size());
+    std::atomic<size_t> next_group = 0;
+    // groups after the first failed one wouldn't have been parsed by the serial version,
+    // so they can be skipped and their logs dropped
+    std::atomic<size_t> first_failed = groups.size();
+
+    std::vector<std::shared_ptr<AST_Store>> worker_stores(thread_count);
+
+    auto work = [&](size_t worker_index) {
+        // each worker gets a store of its own, see AST_Store::merge
+        CompilationState worker_state = state;
+        worker_state.ast_store_ = std::make_shared<AST_Store>();
+        worker_stores.at(worker_index) = worker_state.ast_store_;
+
+        for (size_t index = next_group++; index < groups.size(); index = next_group++) {
+            if (index > first_failed)
+                break;
+
+            LogStream::Capture capture{};
+            GroupResult& result = results.at(index);
+
+            for (Expression* expression: groups.at(index)) {
+                if (!run_layer2(worker_state, expression)) {
+                    result.success = false;
+                    break;
+                }
+            }
+
+            result.log = capture.take();
+
+            if (result.success)
+                continue;
+
+            size_t failed = first_failed;
+            while (index < failed && !first_failed.compare_exchange_weak(failed, index));
+        }
+    };
+
+    std::vector<std::thread> workers{};
+    for (size_t worker_index = 1; worker_index < thread_count; worker_index++)
+        workers.emplace_back(work, worker_index);
+
+    work(0);
+
+    for (auto& worker: workers)
+        worker.join();
+
+    for (auto& worker_store: worker_stores)
+        state.ast_store_->merge(std::move(*worker_store));
+
+    // logs are written in source order as if everything was parsed on this thread
+    for (size_t index = 0; index < groups.size() && index <= first_failed; index++)
+        LogStream::global.write_records(std::move(results.at(index).log));
+
+    return first_failed == groups.size();
+}
+
 } // namespace Maps
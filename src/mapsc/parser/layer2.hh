@@ -15,8 +15,20 @@ struct Expression;
 class CompilationState;
 
 bool run_layer2(CompilationState& state, Expression* unparsed_termed_expression);
+// runs in parallel if state.compiler_options_.thread_count > 1
 bool run_layer2(CompilationState& state, std::vector<Expression*>& unparsed_termed_expressions);
 
+// Parses the expressions on thread_count threads. Expressions nested in each other or sharing 
+// terms are parsed by the same thread in source order, since layer2 parses nested termed 
+// expressions while parsing their owner. Errors are logged in source order and only up to the 
+// first failed expression, same as the serial version
+bool run_layer2_parallel(CompilationState& state, 
+    std::vector<Expression*>& unparsed_termed_expressions, unsigned int thread_count);
+
+// groups of expressions that have to be parsed by the same thread, in source order
+std::vector<std::vector<Expression*>> group_layer2_expressions(
+    const std::vector<Expression*>& expressions);
+
 } // namespace Maps
 
 #endif
\ No newline at end of file
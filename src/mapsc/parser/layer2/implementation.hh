@@ -1,6 +1,7 @@
 #ifndef __PARSER_LAYER_2_IMPLEMENTATION_HH
 #define __PARSER_LAYER_2_IMPLEMENTATION_HH
 
+#include <cstddef>
 #include <optional>
 #include <string>
 #include <vector>
@@ -46,6 +47,9 @@ private:
     // pops an expression from the parse stack, returns nullopt if parse stack empty
     std::optional<Expression*> pop_term();
 
+    // index into the chain action table, expression type of the next term or the end marker
+    size_t peek_term_kind() const;
+
     void fail();
     bool has_failed() const { return !success_; }
 
@@ -85,12 +89,14 @@ private:
     void partial_binop_call_both_state();
 
     void partial_binop_call_standoff_state();
+    // parses the rest of a binary operator chain in a loop, see CHAIN_ACTIONS in layer2.cpp
     void post_binary_operator_state();
-    void compare_precedence_state();
-    void compare_precedence_to_partial_binop_call_left_state();
 
     // reductions
     void reduce_binop_call();
+    // reduces operator levels above base_level that bind at least as tightly as precedence
+    void reduce_operator_chain(size_t base_level, Operator::Precedence precedence);
+    void push_chain_operator(size_t base_level, Operator::Precedence precedence);
     void reduce_partial_binop_call_left();
     void reduce_minus_sign_to_unary_minus_call();
     void reduce_to_partial_binop_call_left();
@@ -1,7 +1,9 @@
 #include "implementation.hh"
 
+#include <array>
 #include <cassert>
 #include <compare>
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <variant>
@@ -123,7 +125,9 @@ Operator::Precedence TermedExpressionParser::peek_precedence() const {
 
 void TermedExpressionParser::shift() {
     parse_stack_.push_back(get_term());
-    Log::debug_extra(current_term()->location) << "Shift in term " << *current_term() << Endl;
+    Log::debug_extra(current_term()->location, [this](auto& log) {
+        log << "Shift in term " << *current_term() << Endl;
+    });
 }
 
 std::optional<Expression*> TermedExpressionParser::pop_term() {
@@ -834,6 +838,7 @@ void TermedExpressionParser::minus_sign_state() {
             switch (peek()->expression_type) {
                 case ExpressionType::binary_operator_reference:
                     reduce_minus_sign_to_unary_minus_call();
+                    precedence_stack_.push_back(peek_precedence());
                     shift();
                     return post_binary_operator_state();
 
@@ -847,6 +852,7 @@ void TermedExpressionParser::minus_sign_state() {
                 case ExpressionType::minus_sign:
                     reduce_minus_sign_to_unary_minus_call();
                     parse_stack_.push_back(binary_minus_ref(get_term()->location));
+                    precedence_stack_.push_back(get_operator_precedence(*current_term()));
                     return post_binary_operator_state();
 
                 case TYPE_DECLARATION_TERM:
@@ -920,6 +926,7 @@ void TermedExpressionParser::partial_binop_call_right_state() {
     switch (peek()->expression_type) {
         case ExpressionType::binary_operator_reference:
             convert_to_partial_call(*current_term()); // treat it as a value
+            precedence_stack_.push_back(peek_precedence());
             shift();
             return post_binary_operator_state();
 
@@ -951,6 +958,7 @@ void TermedExpressionParser::partial_binop_call_right_state() {
     parse_stack_.push_back(args.at(0));
     parse_stack_.push_back(create_operator_reference(*ast_store_, dynamic_cast<const Operator*>(callee), 
         location));
+    precedence_stack_.push_back(get_operator_precedence(*current_term()));
     return post_binary_operator_state();
 }
 
@@ -994,220 +1002,266 @@ void TermedExpressionParser::partial_binop_call_standoff_state() {
     assert(false && "not implemented");
 }
 
-void TermedExpressionParser::post_binary_operator_state() {
-    Log::debug_extra(current_term()->location) << "Post-binary operator state" << Endl;
-
-    if (at_expression_end())
-        return reduce_to_partial_binop_call_right();
-
-    switch (peek()->expression_type) {
+namespace {
+
+// The binary operator chain is parsed by a single loop instead of mutually recursive states
+// so that long operator chains don't eat up the native stack
+enum class ChainState: uint8_t {
+    expect_operand, // stack: ... LHS OP
+    expect_operator // stack: ... LHS OP RHS
+};
+
+enum class ChainAction: uint8_t {
+    sub_expression,
+    shift_value,
+    shift_known_value_reference,
+    shift_reference,
+    shift_call,
+    shift_unary_minus,
+    shift_partially_applied_minus,
+    shift_type_reference,
+    shift_operator,
+    shift_binary_minus,
+    apply_partially_applied_minus,
+    apply_partial_binop_call_left,
+    partial_binop_call_right,
+    finish,
+    bad_term,
+    not_implemented
+};
+
+constexpr size_t CHAIN_STATE_COUNT = 2;
+// one column for each expression type and one for the end of the expression
+constexpr size_t CHAIN_TERM_KIND_COUNT = static_cast<size_t>(ExpressionType::deleted) + 2;
+constexpr size_t CHAIN_EXPRESSION_END = CHAIN_TERM_KIND_COUNT - 1;
+
+using ChainActionTable = 
+    std::array<std::array<ChainAction, CHAIN_TERM_KIND_COUNT>, CHAIN_STATE_COUNT>;
+
+constexpr ChainAction operand_action(ExpressionType expression_type) {
+    switch (expression_type) {
         case ExpressionType::layer2_expression:
-            handle_termed_sub_expression(peek());
-            return post_binary_operator_state();
-
-        case ExpressionType::binary_operator_reference:
-        case ExpressionType::prefix_operator_reference:
-        case ExpressionType::postfix_operator_reference:
-        // case ExpressionType::lambda:
-        case ExpressionType::ternary_expression:
-            assert(false && "not implemented");
-
+            return ChainAction::sub_expression;
+        
+        case GUARANTEED_VALUE:
+            return ChainAction::shift_value;
+        case ExpressionType::known_value_reference:
+            return ChainAction::shift_known_value_reference;
         case ExpressionType::reference:
-            shift();
-            // if the reference is to a function, go ahead and try to apply it first
-            if (current_term()->reference_value()->get_type()->arity() > 0)
-                call_expression_state();
-
-            return compare_precedence_state();
+            return ChainAction::shift_reference;
 
         case ExpressionType::partial_binop_call_left:
         case ExpressionType::partial_binop_call_right:
-        case ExpressionType::call: {
-            shift();
-            
-            // if we have a complete call, we can treat it as a value
-            // if the call is partial, try to complete it first
-            // NOTE: partial call_state could also return a partial call, in which case
-            //       we can try to apply the operator onto that
-            if (is_partial_call(*current_term())) {
-                partial_call_state();
-            }
-            
-            return compare_precedence_state();
-        }
+        case ExpressionType::call:
+            return ChainAction::shift_call;
 
         case ExpressionType::minus_sign:
-            parse_stack_.push_back(unary_minus_ref(get_term()->location));
-            prefix_operator_state();
-
-            if (has_failed())
-                return;
-
-            return compare_precedence_state();
-
+            return ChainAction::shift_unary_minus;
         case ExpressionType::partially_applied_minus:
-            shift();
+            return ChainAction::shift_partially_applied_minus;
+        case ExpressionType::type_reference:
+            return ChainAction::shift_type_reference;
 
-            if (!convert_to_unary_minus_call(*compilation_state_, *current_term())) {
-                Log::error(current_term()->location) << "Converting to unary minus failed" << Endl;
-                return fail(); 
-            }
+        case NOT_ALLOWED_IN_LAYER2:
+            return ChainAction::bad_term;
 
-            return compare_precedence_state();
+        default:
+            return ChainAction::not_implemented;
+    }
+}
 
-        case ExpressionType::partial_binop_call_both:
-        case ExpressionType::partial_call:
-            assert(false && "not implemented");
-            
-        case ExpressionType::known_value_reference:
-            substitute_known_value_reference(peek());
-            // intentional fall-through
-        case GUARANTEED_VALUE:
-            shift();
-            return compare_precedence_state();
+constexpr ChainAction operator_action(ExpressionType expression_type) {
+    switch (expression_type) {
+        case ExpressionType::layer2_expression:
+            return ChainAction::sub_expression;
 
-        case TYPE_DECLARATION_TERM:
-            if (peek()->expression_type == ExpressionType::type_reference) {
-                shift();
-                type_reference_state();
-                return compare_precedence_state();
-            }
+        case ExpressionType::binary_operator_reference:
+            return ChainAction::shift_operator;
+        case ExpressionType::minus_sign:
+            return ChainAction::shift_binary_minus;
 
-            assert(false && "not implemented");
+        case ExpressionType::partially_applied_minus:
+            return ChainAction::apply_partially_applied_minus;
+        case ExpressionType::partial_binop_call_left:
+            return ChainAction::apply_partial_binop_call_left;
+        case ExpressionType::partial_binop_call_both:
+            return ChainAction::not_implemented;
 
-        case NOT_ALLOWED_IN_LAYER2:
-            assert(false && "bad term in TermedExpressionParser::post_binary_operator_state");
-            break;
+        // anything else ends the chain and is left for the caller
+        default:
+            return ChainAction::finish;
     }
 }
 
-// stack state: REDUCED_TREE OP1 VAL | input state: OP2(?)
-// so, we compare the precedences of the operators
-// if OP1 wins, we can reduce left, if OP2 wins we must wait (how?)
-void TermedExpressionParser::compare_precedence_state() {
-    Log::debug_extra(current_term()->location) << "Compare precedence state" << Endl;
+constexpr ChainActionTable create_chain_action_table() {
+    ChainActionTable table{};
 
-    if (at_expression_end()) {
-        reduce_binop_call();
-        precedence_stack_.pop_back();
-        return;
+    for (size_t term_kind = 0; term_kind < CHAIN_EXPRESSION_END; term_kind++) {
+        auto expression_type = static_cast<ExpressionType>(term_kind);
+
+        table[static_cast<size_t>(ChainState::expect_operand)][term_kind] = 
+            operand_action(expression_type);
+        table[static_cast<size_t>(ChainState::expect_operator)][term_kind] = 
+            operator_action(expression_type);
     }
 
-    switch (peek()->expression_type) {
-        case ExpressionType::layer2_expression:
-            handle_termed_sub_expression(peek());
-            return compare_precedence_state();
+    // a missing rhs makes the chain into a partial binop call i.e. "a + b *"
+    table[static_cast<size_t>(ChainState::expect_operand)][CHAIN_EXPRESSION_END] = 
+        ChainAction::partial_binop_call_right;
+    table[static_cast<size_t>(ChainState::expect_operator)][CHAIN_EXPRESSION_END] = 
+        ChainAction::finish;
 
-        case ExpressionType::partially_applied_minus:
-            if (!convert_to_partial_binop_call_left(*compilation_state_, *peek())) {
-                Log::error(peek()->location) << 
-                    "Converting minus to partial binop call failed" << Endl;
-                return fail();
-            }
+    return table;
+}
 
-            // intentional fall-through
-        case ExpressionType::partial_binop_call_left:
-            return compare_precedence_to_partial_binop_call_left_state();
+constexpr ChainActionTable CHAIN_ACTIONS = create_chain_action_table();
 
-        case ExpressionType::partial_binop_call_both:
-            assert(false && "not implemented");
+} // anonymous namespace
 
-        case ExpressionType::binary_operator_reference:
-            break;
+size_t TermedExpressionParser::peek_term_kind() const {
+    if (at_expression_end())
+        return CHAIN_EXPRESSION_END;
 
-        case ExpressionType::minus_sign:
-            convert_to_operator_reference(*peek(),
-                compilation_state_->special_definitions_.binary_minus);
-            break;
+    return static_cast<size_t>(peek()->expression_type);
+}
 
-        default:
-            reduce_binop_call();
-            precedence_stack_.pop_back();
+// reduces the chain until the top operator binds looser than the given precedence
+// !!!: assuming left-associativity
+void TermedExpressionParser::reduce_operator_chain(size_t base_level, 
+    Operator::Precedence precedence) {
+
+    while (precedence_stack_.size() > base_level && precedence_stack_.back() >= precedence) {
+        reduce_binop_call();
+        precedence_stack_.pop_back();
+
+        if (has_failed())
             return;
     }
+}
 
-    // precedence goes down => one or more "closing parenthesis" required
-    auto next_precedence = peek_precedence();
+void TermedExpressionParser::push_chain_operator(size_t base_level, 
+    Operator::Precedence precedence) {
 
-    if (precedence_stack_.back() > next_precedence) {
-        reduce_binop_call();
-        precedence_stack_.pop_back();
-        
-        // if there's an "intermediate level" or operators, we need to handle those before returning
-        if (precedence_stack_.back() < next_precedence) {
-            precedence_stack_.push_back(next_precedence);
-            shift();
-            return post_binary_operator_state();
-        }
-        
-        // otherwise simply return 
+    reduce_operator_chain(base_level, precedence);
+    if (has_failed())
         return;
-    }
 
-    assert(peek()->expression_type == ExpressionType::binary_operator_reference
-        && "compare_precedence_state called with not an operator ref next");
+    precedence_stack_.push_back(precedence);
+    shift();
+}
 
-    if (precedence_stack_.back() == next_precedence) { // !!!: assuming left-associativity
-        // if the precedence stays the same, just reduce and carry on
-        reduce_binop_call();
-        shift();
-        return post_binary_operator_state();
-    }
+// stack state: ... LHS OP1 | input state: operand, possibly followed by OP2 RHS ...
+// Entered with the precedence of OP1 on top of the precedence stack. Each operator's precedence
+// is looked up once as it's shifted and kept on the precedence stack for the comparisons.
+// Runs until the end of the expression or a term that can't continue the chain, and leaves 
+// the chain reduced into a single expression on the parse stack
+void TermedExpressionParser::post_binary_operator_state() {
+    Log::debug_extra(current_term()->location) << "Post-binary operator state" << Endl;
 
-    // if the precedence goes up, push it into the stack and run post_binary_op_state with 
-    // the new precedence stack
-    // once it returns, there should be a nice reduced rhs on the parse_stack_
-    if (precedence_stack_.back() < next_precedence) {
-        unsigned int previous_precedence = precedence_stack_.back();
-        precedence_stack_.push_back(next_precedence);
-        shift();
-        post_binary_operator_state();
-        assert(precedence_stack_.back() == previous_precedence 
-            && "post_binary_operator_state didn't return to the same precedence level");
-            
-        reduce_binop_call();
+    assert(!precedence_stack_.empty() && 
+        "post_binary_operator_state entered without the precedence of the first operator");
 
-        if (at_expression_end()) {
-            // ??? should we look at the precedence stack here? 
-            return;
-        }
+    // levels below this belong to whoever started the chain
+    size_t base_level = precedence_stack_.size() - 1;
+    auto state = ChainState::expect_operand;
 
-        assert(peek_precedence() >= precedence_stack_.back() 
-            && "post_binary_operator_state didn't run until the end or a lover/equal precedence \
-that the caller put on the precedence stack");
-        
-        // continue parsing
-        shift();
-        return post_binary_operator_state(); /// how about the shifts here
-    }
-}
+    while (!has_failed()) {
+        switch (CHAIN_ACTIONS[static_cast<size_t>(state)][peek_term_kind()]) {
+            case ChainAction::sub_expression:
+                handle_termed_sub_expression(peek());
+                continue;
 
-void TermedExpressionParser::compare_precedence_to_partial_binop_call_left_state() {
-    Log::debug_extra(current_term()->location) << 
-        "Compare precedence to partial binop call left state" << Endl;
+            case ChainAction::shift_known_value_reference:
+                substitute_known_value_reference(peek());
+                // intentional fall-through
+            case ChainAction::shift_value:
+                shift();
+                break;
 
-    if (at_expression_end()) {
-        assert(false && "compare_precedence_to_partial_binop... called incorrectly");
-        return fail();
-    }
+            case ChainAction::shift_reference:
+                shift();
+                // if the reference is to a function, go ahead and try to apply it first
+                if (current_term()->reference_value()->get_type()->arity() > 0)
+                    call_expression_state();
+                break;
 
-    auto next_precedence = peek_precedence();
-    auto prev_precedence = precedence_stack_.back();
+            case ChainAction::shift_call:
+                shift();
+                // if we have a complete call, we can treat it as a value
+                // if the call is partial, try to complete it first
+                // NOTE: partial call_state could also return a partial call, in which case
+                //       we can try to apply the operator onto that
+                if (is_partial_call(*current_term()))
+                    partial_call_state();
+                break;
+
+            case ChainAction::shift_unary_minus:
+                parse_stack_.push_back(unary_minus_ref(get_term()->location));
+                prefix_operator_state();
+                break;
+
+            case ChainAction::shift_partially_applied_minus:
+                shift();
 
-    if (next_precedence < prev_precedence) {
-        reduce_binop_call();
-        if (has_failed())
-            return;
+                if (!convert_to_unary_minus_call(*compilation_state_, *current_term())) {
+                    Log::error(current_term()->location) << "Converting to unary minus failed" << Endl;
+                    return fail(); 
+                }
+                break;
 
-        shift();
-        precedence_stack_.pop_back();
-        return reduce_partial_binop_call_left();
-    }
+            case ChainAction::shift_type_reference:
+                shift();
+                type_reference_state();
+                break;
+
+            case ChainAction::shift_binary_minus:
+                convert_to_operator_reference(*peek(),
+                    compilation_state_->special_definitions_.binary_minus);
+                // intentional fall-through
+            case ChainAction::shift_operator:
+                push_chain_operator(base_level, get_operator_precedence(*peek()));
+                state = ChainState::expect_operand;
+                continue;
+
+            case ChainAction::apply_partially_applied_minus:
+                if (!convert_to_partial_binop_call_left(*compilation_state_, *peek())) {
+                    Log::error(peek()->location) << 
+                        "Converting minus to partial binop call failed" << Endl;
+                    return fail();
+                }
+                // intentional fall-through
+            case ChainAction::apply_partial_binop_call_left: {
+                // the section takes whatever binds tighter than it as its lhs
+                reduce_operator_chain(base_level, get_operator_precedence(*peek()) + 1);
+                if (has_failed())
+                    return;
 
-    shift();
-    reduce_partial_binop_call_left();
-    precedence_stack_.pop_back();
-    return reduce_binop_call();
+                shift();
+                reduce_partial_binop_call_left();
+                continue;
+            }
+
+            case ChainAction::partial_binop_call_right:
+                return reduce_to_partial_binop_call_right();
+
+            case ChainAction::finish:
+                return reduce_operator_chain(base_level, Operator::MIN_PRECEDENCE);
+
+            case ChainAction::bad_term:
+                Log::compiler_error(peek()->location) << 
+                    "Unexpected " << *peek() << " in an operator chain" << Endl;
+                assert(false && "bad term in TermedExpressionParser::post_binary_operator_state");
+                return fail();
+
+            case ChainAction::not_implemented:
+                Log::compiler_error(peek()->location) << 
+                    "Parsing " << *peek() << " in an operator chain is not implemented" << Endl;
+                assert(false && "not implemented");
+                return fail();
+        }
+
+        state = ChainState::expect_operator;
+    }
 }
 
 // Pops 3 values from the parse stack, reduces them into a binop apply expression and pushes it on top
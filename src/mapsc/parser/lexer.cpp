@@ -8,6 +8,7 @@
 #include <string>
 
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
 #include "mapsc/words.hh"
 
 
@@ -23,8 +24,11 @@ Lexer::Lexer(std::istream* source_is, SourceFileID source_id)
 
 Token Lexer::get_token() {
     Token token = get_token_();
+    Profiler::count(ProfilerCounter::tokens_lexed);
 
-    Log::debug_extra(prev_token_.location) << "TOKEN: " << prev_token_ << Endl;
+    Log::debug_extra(prev_token_.location, [this](auto& log) {
+        log << "TOKEN: " << prev_token_ << Endl;
+    });
     
     // a bit of a hack to keep the outputs in sync
     prev_token_ = token;
@@ -0,0 +1,354 @@
+#include "pass_manager.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <variant>
+
+#include "common/std_visit_helper.hh"
+
+#include "mapsc/logging.hh"
+#include "mapsc/compilation_state.hh"
+
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/statement.hh"
+
+namespace Maps {
+
+using Log = LogInContext<LogContext::transform_stage>;
+
+namespace {
+
+using NodeRef = std::variant<Expression*, Statement*>;
+
+constexpr size_t NO_PARENT = std::numeric_limits<size_t>::max();
+
+struct WorkNode {
+    NodeRef node;
+    size_t parent;
+};
+
+// nested definition bodies and call targets are left out, they get their own runs
+void for_each_child(const NodeRef& node, auto callback) {
+    auto push = [&callback](auto child) {
+        if (child)
+            callback(NodeRef{child});
+    };
+
+    std::visit(overloaded {
+        [&push](Expression* expression) {
+            std::visit(overloaded {
+                [&push](const CallExpressionValue& call) {
+                    for (Expression* arg: std::get<1>(call))
+                        push(arg);
+                },
+                [&push](const TermedExpressionValue& termed) {
+                    for (Expression* term: termed.terms)
+                        push(term);
+                },
+                [&push](const TernaryExpressionValue& ternary) {
+                    push(ternary.condition);
+                    push(ternary.success);
+                    push(ternary.failure);
+                },
+                [](const auto&) {}
+            }, expression->value);
+        },
+        [&push](Statement* statement) {
+            std::visit(overloaded {
+                [&push](Expression* expression) { push(expression); },
+                [&push](const Assignment& assignment) { push(assignment.identifier_or_reference); },
+                [&push](const Block& block) {
+                    for (Statement* sub_statement: block)
+                        push(sub_statement);
+                },
+                [&push](const ConditionalValue& conditional) {
+                    push(conditional.condition);
+                    push(conditional.body);
+                    if (conditional.else_branch)
+                        push(*conditional.else_branch);
+                },
+                [&push](const LoopStatementValue& loop) {
+                    if (loop.initializer)
+                        push(*loop.initializer);
+                    push(loop.condition);
+                    push(loop.body);
+                },
+                [&push](const SwitchStatementValue& switch_value) {
+                    push(switch_value.key);
+                    for (auto [case_value, case_body]: switch_value.cases) {
+                        push(case_value);
+                        push(case_body);
+                    }
+                },
+                [](const auto&) {}
+            }, statement->value);
+        }
+    }, node);
+}
+
+// appends the subtree under root to nodes in post-order, with an explicit stack since
+// generated expressions can nest deeply
+void collect_post_order(NodeRef root, size_t parent, std::vector<WorkNode>& nodes,
+    std::deque<size_t>& worklist) {
+
+    // node index and whether its children have been pushed already
+    std::vector<std::pair<size_t, bool>> stack{};
+
+    nodes.push_back({root, parent});
+    stack.push_back({nodes.size() - 1, false});
+
+    while (!stack.empty()) {
+        auto& [index, expanded] = stack.back();
+
+        if (expanded) {
+            worklist.push_back(index);
+            stack.pop_back();
+            continue;
+        }
+
+        expanded = true;
+        size_t node_index = index;
+        size_t first_child = nodes.size();
+
+        for_each_child(nodes[node_index].node, [&nodes, node_index](NodeRef child) {
+            nodes.push_back({child, node_index});
+        });
+
+        // pushed in reverse so that the children come out in source order
+        for (size_t child = nodes.size(); child > first_child; child--)
+            stack.push_back({child - 1, false});
+    }
+}
+
+std::optional<NodeRef> body_root(DefinitionBody& definition) {
+    return std::visit(overloaded {
+        [](Expression* expression) -> std::optional<NodeRef> { return NodeRef{expression}; },
+        [](Statement* statement) -> std::optional<NodeRef> { return NodeRef{statement}; },
+        [](auto) -> std::optional<NodeRef> { return std::nullopt; }
+    }, definition.body());
+}
+
+} // anonymous namespace
+
+void PassManager::add_pass(TransformPass pass) {
+    passes_.push_back(std::move(pass));
+    stats_.push_back({});
+}
+
+bool PassManager::set_enabled(std::string_view name, bool enabled) {
+    for (auto& pass: passes_) {
+        if (pass.name != name)
+            continue;
+
+        pass.enabled = enabled;
+        return true;
+    }
+
+    return false;
+}
+
+bool PassManager::is_enabled(std::string_view name) const {
+    for (const auto& pass: passes_) {
+        if (pass.name == name)
+            return pass.enabled;
+    }
+
+    return false;
+}
+
+bool PassManager::apply_overrides(const std::vector<std::pair<std::string, bool>>& overrides) {
+    bool success = true;
+
+    for (const auto& [name, enabled]: overrides) {
+        if (set_enabled(name, enabled))
+            continue;
+
+        Log::error(NO_SOURCE_LOCATION) << "Unknown transform pass \"" << name << "\"" << Endl;
+        success = false;
+    }
+
+    return success;
+}
+
+std::vector<std::vector<size_t>> PassManager::traversals() const {
+    std::vector<std::vector<size_t>> traversals{};
+
+    for (size_t index = 0; index < passes_.size(); index++) {
+        if (!passes_[index].enabled)
+            continue;
+
+        if (traversals.empty() || !passes_[index].fusable)
+            traversals.push_back({});
+
+        traversals.back().push_back(index);
+    }
+
+    return traversals;
+}
+
+bool PassManager::run(CompilationState& state, DefinitionBody& definition) {
+    for (const auto& traversal: traversals()) {
+        if (!run_traversal(state, definition, traversal))
+            return false;
+    }
+
+    return true;
+}
+
+template<typename Node>
+PassResult PassManager::apply(size_t pass_index,
+    const std::function<PassResult(CompilationState&, Node&)>& transform,
+    CompilationState& state, Node& node) {
+
+    PassStats& stats = stats_[pass_index];
+    PassResult result;
+
+    // the clock is only read if the time is going to end up in a profile
+    if (Profiler::global.is_enabled()) {
+        auto start = Profiler::Clock::now();
+        result = transform(state, node);
+        stats.duration += Profiler::Clock::now() - start;
+    } else {
+        result = transform(state, node);
+    }
+
+    stats.visits++;
+    if (result == PassResult::changed)
+        stats.changes++;
+
+    return result;
+}
+
+bool PassManager::run_traversal(CompilationState& state, DefinitionBody& definition,
+    const std::vector<size_t>& traversal) {
+
+    bool has_node_transforms = std::any_of(traversal.begin(), traversal.end(),
+        [this](size_t index) {
+            return passes_[index].expression_transform || passes_[index].statement_transform;
+        });
+
+    for (size_t round = 0; round < MAX_DEFINITION_ROUNDS; round++) {
+        auto root = body_root(definition);
+
+        if (has_node_transforms && root) {
+            std::vector<WorkNode> nodes{};
+            std::deque<size_t> worklist{};
+            collect_post_order(*root, NO_PARENT, nodes, worklist);
+
+            std::vector<bool> queued(nodes.size(), true);
+            size_t revisit_budget = MAX_REVISIT_FACTOR * nodes.size();
+
+            while (!worklist.empty()) {
+                size_t index = worklist.front();
+                worklist.pop_front();
+                queued[index] = false;
+
+                // simplify splices and drops nodes that might still have entries queued
+                bool deleted = std::visit(overloaded {
+                    [](Expression* expression) {
+                        return expression->expression_type == ExpressionType::deleted;
+                    },
+                    [](Statement* statement) {
+                        return statement->statement_type == StatementType::deleted;
+                    }
+                }, nodes[index].node);
+                if (deleted)
+                    continue;
+
+                bool changed = false;
+
+                for (size_t pass_index: traversal) {
+                    const TransformPass& pass = passes_[pass_index];
+
+                    PassResult result = std::visit(overloaded {
+                        [&](Expression* expression) {
+                            return pass.expression_transform ?
+                                apply(pass_index, pass.expression_transform, state, *expression) :
+                                PassResult::unchanged;
+                        },
+                        [&](Statement* statement) {
+                            return pass.statement_transform ?
+                                apply(pass_index, pass.statement_transform, state, *statement) :
+                                PassResult::unchanged;
+                        }
+                    }, nodes[index].node);
+
+                    if (result == PassResult::failed) {
+                        Log::error(definition.location()) << "Transform pass " << pass.name <<
+                            " failed on " << definition << Endl;
+                        return false;
+                    }
+
+                    changed = changed || result == PassResult::changed;
+                }
+
+                if (!changed)
+                    continue;
+
+                if (revisit_budget == 0) {
+                    Log::warning(definition.location()) <<
+                        "Transform passes kept changing " << definition << ", giving up" << Endl;
+                    break;
+                }
+                revisit_budget--;
+
+                // the node might have new children that haven't been through the passes yet,
+                // so its subtree goes back to the front of the worklist as new entries, to be
+                // done before anything above it
+                std::deque<size_t> revisits{};
+                collect_post_order(nodes[index].node, nodes[index].parent, nodes, revisits);
+                worklist.insert(worklist.begin(), revisits.begin(), revisits.end());
+                queued.resize(nodes.size(), true);
+
+                size_t parent = nodes[index].parent;
+                if (parent != NO_PARENT && !queued[parent]) {
+                    worklist.push_back(parent);
+                    queued[parent] = true;
+                }
+            }
+        }
+
+        bool definition_changed = false;
+
+        for (size_t pass_index: traversal) {
+            const TransformPass& pass = passes_[pass_index];
+            if (!pass.definition_transform)
+                continue;
+
+            PassResult result = apply(pass_index, pass.definition_transform, state, definition);
+
+            if (result == PassResult::failed) {
+                Log::error(definition.location()) << "Transform pass " << pass.name <<
+                    " failed on " << definition << Endl;
+                return false;
+            }
+
+            definition_changed = definition_changed || result == PassResult::changed;
+        }
+
+        if (!definition_changed || !has_node_transforms)
+            return true;
+    }
+
+    return true;
+}
+
+void PassManager::flush_stats() {
+    for (size_t index = 0; index < passes_.size(); index++) {
+        PassStats& stats = stats_[index];
+        if (stats.visits == 0)
+            continue;
+
+        if (Profiler::global.is_enabled())
+            Profiler::global.record_pass(passes_[index].name, stats.duration, stats.visits,
+                stats.changes);
+
+        stats = {};
+    }
+}
+
+} // namespace Maps
@@ -0,0 +1,94 @@
+#ifndef __PASS_MANAGER_HH
+#define __PASS_MANAGER_HH
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "mapsc/profiler.hh"
+
+namespace Maps {
+
+class CompilationState;
+class DefinitionBody;
+struct Expression;
+struct Statement;
+
+enum class PassResult {
+    unchanged,
+    changed,
+    failed
+};
+
+// A transform that can look at expressions, statements and the definition itself
+// Any of the transforms can be left empty
+struct TransformPass {
+    std::string name;
+
+    std::function<PassResult(CompilationState&, Expression&)> expression_transform = {};
+    std::function<PassResult(CompilationState&, Statement&)> statement_transform = {};
+    // called once the whole body has been through the expression and statement transforms
+    std::function<PassResult(CompilationState&, DefinitionBody&)> definition_transform = {};
+
+    // false if the pass needs every earlier pass to be done with the whole definition before
+    // it sees any of it, e.g. because it checks the types an earlier definition transform sets
+    bool fusable = true;
+    bool enabled = true;
+};
+
+// Runs the transform passes over definitions
+// Consecutive fusable passes share a single post-order traversal: each node goes through all
+// of them in turn, and nodes a pass changes are put back on the worklist along with their
+// parent so that the passes get to see the new shape
+class PassManager {
+public:
+    struct PassStats {
+        // only measured while the profiler is enabled
+        Profiler::Clock::duration duration{};
+        uint64_t visits = 0;
+        uint64_t changes = 0;
+    };
+
+    // revisits after a change are capped at this many times the size of the definition
+    static constexpr size_t MAX_REVISIT_FACTOR = 8;
+    // rounds of node transforms after definition transforms change the body
+    static constexpr size_t MAX_DEFINITION_ROUNDS = 4;
+
+    void add_pass(TransformPass pass);
+
+    // returns false if there's no pass with that name
+    bool set_enabled(std::string_view name, bool enabled);
+    bool is_enabled(std::string_view name) const;
+
+    // applies overrides like the ones in CompilationState::Options, logs unknown pass names
+    bool apply_overrides(const std::vector<std::pair<std::string, bool>>& overrides);
+
+    const std::vector<TransformPass>& passes() const { return passes_; }
+    // the enabled passes grouped into the traversals they'll run in
+    std::vector<std::vector<size_t>> traversals() const;
+
+    [[nodiscard]] bool run(CompilationState& state, DefinitionBody& definition);
+
+    const PassStats& stats(size_t pass_index) const { return stats_.at(pass_index); }
+    // adds the stats collected so far to the profiler's pass totals and clears them
+    void flush_stats();
+
+private:
+    [[nodiscard]] bool run_traversal(CompilationState& state, DefinitionBody& definition,
+        const std::vector<size_t>& traversal);
+
+    template<typename Node>
+    PassResult apply(size_t pass_index,
+        const std::function<PassResult(CompilationState&, Node&)>& transform,
+        CompilationState& state, Node& node);
+
+    std::vector<TransformPass> passes_{};
+    std::vector<PassStats> stats_{};
+};
+
+} // namespace Maps
+
+#endif
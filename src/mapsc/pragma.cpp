@@ -1,5 +1,6 @@
 #include "pragma.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <utility>
 
@@ -11,48 +12,97 @@ namespace Maps {
 
 using Log = LogInContext<LogContext::compiler_init>;
 
-PragmaStore::PragmaStore() {
+std::optional<PragmaFlagId> find_pragma_flag(std::string_view name) {
     for (const PragmaFlag& flag: flags) {
-        // gotta insert the default at the start, because the begin is never read
-        declarations_.insert({flag.name, {{SourceLocation{0,0}, flag.default_value}}});
+        if (flag.name == name)
+            return flag.id;
     }
+
+    return std::nullopt;
 }
 
-bool PragmaStore::set_flag(const std::string& flag_name, bool value, const SourceLocation& location) {
-    auto flag_declarations_it = declarations_.find(flag_name);
+bool PragmaStore::set_flag(std::string_view flag_name, PragmaValue value, 
+    const SourceLocation& location) {
+    
+    auto flag = find_pragma_flag(flag_name);
     
-    if (flag_declarations_it == declarations_.end()) {
+    if (!flag) {
         Log::error(location) << "tried to set unkown pragma: " << flag_name << Endl;
         return false;
     }
 
-    flag_declarations_it->second.insert({location, value});
-    Log::debug(location) << "set pragma: " << (value ? "enable " : "disable ") << flag_name << Endl;
+    return set_flag(*flag, value, location);
+}
+
+bool PragmaStore::set_flag(PragmaFlagId flag, PragmaValue value, const SourceLocation& location) {
+    const PragmaFlag& flag_info = flags.at(static_cast<size_t>(flag));
+
+    if (value.index() != flag_info.default_value.index()) {
+        Log::error(location) << "wrong type of value for pragma: " << flag_info.name << Endl;
+        return false;
+    }
+
+    auto& flag_declarations = declarations_.at(static_cast<size_t>(flag));
+
+    if (flag_declarations.empty() || flag_declarations.back().location < location) {
+        flag_declarations.push_back({location, value});
+    } else {
+        auto it = std::upper_bound(flag_declarations.begin(), flag_declarations.end(), location,
+            [](const SourceLocation& lhs, const Declaration& rhs) { return lhs < rhs.location; });
+        flag_declarations.insert(it, {location, value});
+    }
+
+    if (const bool* bool_value = std::get_if<bool>(&value)) {
+        Log::debug(location) << "set pragma: " << (*bool_value ? "enable " : "disable ") << 
+            flag_info.name << Endl;
+    } else {
+        Log::debug(location) << "set pragma: " << flag_info.name << " = " << 
+            std::get<maps_Int>(value) << Endl;
+    }
     return true;
 }
 
-// NOTE: if these were ever somehow to become a bottleneck they could be cached
-bool PragmaStore::check_flag_value(const std::string& flag_name, const SourceLocation& location) const {
-    auto flag_declarations_it = declarations_.find(flag_name);
-    assert(flag_declarations_it != declarations_.end() && "tried to read an unknown pragma");
-    
-    auto flag_declarations = flag_declarations_it->second;
+PragmaValue PragmaStore::get_value(PragmaFlagId flag, const SourceLocation& location) const {
+    const auto& flag_declarations = declarations_.at(static_cast<size_t>(flag));
+
+    // get the last declaration that is above the location in the source file  
+    auto it = std::upper_bound(flag_declarations.begin(), flag_declarations.end(), location,
+        [](const SourceLocation& lhs, const Declaration& rhs) { return lhs < rhs.location; });
+
+    if (it == flag_declarations.begin())
+        return flags.at(static_cast<size_t>(flag)).default_value;
+
+    return std::prev(it)->value;
+}
+
+bool PragmaStore::check_flag_value(PragmaFlagId flag, const SourceLocation& location) const {
+    auto value = get_value(flag, location);
+    assert(std::holds_alternative<bool>(value) && "check_flag_value called on a non-bool pragma");
+    return std::get<bool>(value);
+}
+
+PragmaFlagSet PragmaStore::flags_at(const SourceLocation& location) const {
+    PragmaFlagSet flag_set{};
+
+    for (const PragmaFlag& flag: flags) {
+        auto value = get_value(flag.id, location);
+        if (const bool* bool_value = std::get_if<bool>(&value))
+            flag_set.set(static_cast<size_t>(flag.id), *bool_value);
+    }
 
-    // get the last value that is above the location in the source file  
-    // never hitting the begin() is ok, since that just contains the default value (set in the constructor)
-    auto it = flag_declarations.lower_bound(location);
-    assert(it != flag_declarations.end() && "somehow check_flag_value failed to produce a value");
-    return it->second;
+    return flag_set;
 }
 
 bool PragmaStore::empty() const { 
-    // default flags are always there
-    return declarations_.size() == flags.size(); 
+    return size() == 0;
 }
 
 size_t PragmaStore::size() const { 
-    // default flags are always there
-    return declarations_.size() - flags.size(); 
+    size_t size = 0;
+    for (const auto& flag_declarations: declarations_)
+        size += flag_declarations.size();
+
+    return size; 
 }
 
-} // namespace Pragmas
\ No newline at end of file
+} // namespace Pragmas
@@ -3,57 +3,85 @@
 
 #include <cstddef>
 #include <array>
-#include <functional>
-#include <map>
-#include <string>
+#include <bitset>
+#include <optional>
 #include <string_view>
+#include <variant>
+#include <vector>
+
+#include "common/maps_datatypes.h"
 
 #include "mapsc/source_location.hh"
 
 namespace Maps {
 
-// all pragmas are bool for now
+constexpr auto PRAGMA_FLAGS_START_LINE = __LINE__;
+enum class PragmaFlagId {
+    top_level_evaluation_context    = 0,
+    mutable_global_variables        = 1,
+};
+constexpr auto PRAGMA_FLAG_COUNT = __LINE__ - PRAGMA_FLAGS_START_LINE - 3;
+
+// flags are mostly bool, but the values can be other things as well (e.g. optimization hints)
+using PragmaValue = std::variant<bool, maps_Int>;
+
 struct PragmaFlag {
+    PragmaFlagId id;
     std::string_view name;
-    bool default_value;
+    PragmaValue default_value;
 };
 
 namespace Flags {
 
-constexpr PragmaFlag top_level_evaluation_context{"top-level evaluation", false};
-constexpr PragmaFlag mutable_global_variables{"mutable global variables", false};
+constexpr PragmaFlag top_level_evaluation_context{
+    PragmaFlagId::top_level_evaluation_context, "top-level evaluation", false};
+constexpr PragmaFlag mutable_global_variables{
+    PragmaFlagId::mutable_global_variables, "mutable global variables", false};
 
 }
 
-constexpr std::array flags{
+// indexed by PragmaFlagId
+constexpr std::array<PragmaFlag, PRAGMA_FLAG_COUNT> flags{
     Flags::top_level_evaluation_context,
     Flags::mutable_global_variables
 };
 
+// the bool flags in effect at some location, indexed by PragmaFlagId
+using PragmaFlagSet = std::bitset<PRAGMA_FLAG_COUNT>;
+
+std::optional<PragmaFlagId> find_pragma_flag(std::string_view name);
+
 // the idea is that we have to be able to determine retroactively whether something 
 // was affected by a pragma. We can do this by storing the declarations by SourceLocation
-// when we look for pragmas affecting a certain AST::Node, we search the multimap and look for the
+// when we look for pragmas affecting a certain AST::Node, we binary search for the
 // previous relevant pragma
-// If these were to become a bottleneck we should cache them 
+// The declarations for each flag are kept sorted on insertion (layer1 produces them in order,
+// so that is just a push_back), so the store is always a valid interval index
 class PragmaStore {
   public:
-    PragmaStore();
+    struct Declaration {
+        SourceLocation location;
+        PragmaValue value;
+    };
+
+    PragmaStore() = default;
+    
+    // returns false if the flag doesn't exist or the value is of the wrong type
+    bool set_flag(std::string_view flag_name, PragmaValue value, const SourceLocation& location);
+    bool set_flag(PragmaFlagId flag, PragmaValue value, const SourceLocation& location);
     
-    // returns false if the flag doesn't exist
-    bool set_flag(const std::string& flag_name, bool value, const SourceLocation& location);
-    bool check_flag_value(const std::string& flag_name, const SourceLocation& location) const;
+    PragmaValue get_value(PragmaFlagId flag, const SourceLocation& location) const;
+    // only for bool flags
+    bool check_flag_value(PragmaFlagId flag, const SourceLocation& location) const;
+    // values of all bool flags at once, meant to be cached per definition
+    PragmaFlagSet flags_at(const SourceLocation& location) const;
 
     bool empty() const;
     size_t size() const;
   private:
-    std::map<
-        std::string_view,
-        // The locations are stored in reverse order so that we can easily find the
-        // current value of the flag using std::map::lower_bound
-        std::map<SourceLocation, bool, std::greater<SourceLocation>>
-    > declarations_;
+    std::array<std::vector<Declaration>, PRAGMA_FLAG_COUNT> declarations_;
 };
 
 } // namespace Pragma
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,496 @@
+#include "cse.hh"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "common/std_visit_helper.hh"
+
+#include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+
+#include "mapsc/types/type.hh"
+#include "mapsc/types/type_defs.hh"
+#include "mapsc/types/function_type.hh"
+
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/statement.hh"
+
+#include "mapsc/procedures/inline.hh"
+
+namespace Maps {
+
+using Log = LogInContext<LogContext::transform_stage>;
+
+namespace {
+
+size_t combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+bool same_definition(const DefinitionHeader* lhs, const DefinitionHeader* rhs) {
+    return lhs == rhs || same_builtin(*lhs, *rhs);
+}
+
+size_t definition_hash(const DefinitionHeader* definition) {
+    return std::hash<std::string_view>{}(definition->name_view());
+}
+
+size_t value_hash(const ExpressionValue& value) {
+    return std::visit(overloaded {
+        [](maps_Int value) { return std::hash<maps_Int>{}(value); },
+        [](maps_Float value) { return std::hash<maps_Float>{}(value); },
+        [](bool value) { return std::hash<bool>{}(value); },
+        [](const std::string& value) { return std::hash<std::string>{}(value); },
+        [](const DefinitionHeader* value) { return definition_hash(value); },
+        [](const auto&) { return size_t{0}; }
+    }, value);
+}
+
+bool is_pure_operand(const Expression& expression);
+
+// calls that evaluate to the same thing wherever they are in a definition
+bool is_cse_candidate(const Expression& expression) {
+    if (expression.expression_type != ExpressionType::call)
+        return false;
+
+    const auto& [callee, args] = expression.call_value();
+    if (args.empty() || !callee->get_type()->is_pure_function())
+        return false;
+
+    // MutStrings have to be a new string each time
+    if (*expression.type == MutString || expression.type->is_voidish())
+        return false;
+
+    return std::all_of(args.begin(), args.end(),
+        [](const Expression* arg) { return is_pure_operand(*arg); });
+}
+
+bool is_pure_operand(const Expression& expression) {
+    switch (expression.expression_type) {
+        case ExpressionType::known_value:
+            return *expression.type != MutString;
+
+        case ExpressionType::reference:
+        case ExpressionType::known_value_reference:
+            return true;
+
+        case ExpressionType::call:
+            return is_cse_candidate(expression);
+
+        default:
+            return false;
+    }
+}
+
+size_t node_count(const Expression& expression) {
+    size_t count = 0;
+    std::vector<const Expression*> to_visit{&expression};
+
+    while (!to_visit.empty()) {
+        const Expression* current = to_visit.back();
+        to_visit.pop_back();
+        count++;
+
+        if (current->expression_type == ExpressionType::call) {
+            const auto& args = std::get<1>(current->call_value());
+            to_visit.insert(to_visit.end(), args.begin(), args.end());
+        }
+    }
+
+    return count;
+}
+
+// pushes the operands structural_hash and structurally_equal descend into
+void push_operands(const Expression& expression, std::vector<const Expression*>& to_visit) {
+    switch (expression.expression_type) {
+        case ExpressionType::call:
+        case ExpressionType::partial_call: {
+            const auto& args = std::get<1>(expression.call_value());
+            to_visit.insert(to_visit.end(), args.begin(), args.end());
+            return;
+        }
+
+        case ExpressionType::ternary_expression: {
+            const auto& [condition, success, failure] = expression.ternary_value();
+            to_visit.insert(to_visit.end(), {condition, success, failure});
+            return;
+        }
+
+        default:
+            return;
+    }
+}
+
+// the hash of the node itself, the operand count keeps the sequences of different shapes apart
+size_t node_hash(const Expression& expression) {
+    size_t hash = std::hash<int>{}(static_cast<int>(expression.expression_type));
+    hash = combine(hash, std::hash<std::string_view>{}(expression.type->name()));
+
+    switch (expression.expression_type) {
+        case ExpressionType::call:
+        case ExpressionType::partial_call: {
+            const auto& [callee, args] = expression.call_value();
+            return combine(combine(hash, definition_hash(callee)), args.size());
+        }
+
+        case ExpressionType::ternary_expression:
+            return hash;
+
+        default:
+            return combine(hash, value_hash(expression.value));
+    }
+}
+
+// compares the nodes themselves, not their operands
+bool nodes_equal(const Expression& lhs, const Expression& rhs) {
+    if (lhs.expression_type != rhs.expression_type || *lhs.type != *rhs.type)
+        return false;
+
+    switch (lhs.expression_type) {
+        case ExpressionType::call:
+        case ExpressionType::partial_call: {
+            const auto& [lhs_callee, lhs_args] = lhs.call_value();
+            const auto& [rhs_callee, rhs_args] = rhs.call_value();
+
+            return same_definition(lhs_callee, rhs_callee) && lhs_args.size() == rhs_args.size();
+        }
+
+        case ExpressionType::ternary_expression:
+            return true;
+
+        case ExpressionType::reference:
+        case ExpressionType::known_value_reference:
+            return same_definition(lhs.reference_value(), rhs.reference_value());
+
+        // MutStrings are only ever equal to themselves
+        case ExpressionType::known_value:
+            if (std::holds_alternative<maps_MutString>(lhs.value))
+                return &lhs == &rhs;
+            return lhs.value == rhs.value;
+
+        default:
+            return &lhs == &rhs;
+    }
+}
+
+class CommonSubexpressionEliminator {
+public:
+    CommonSubexpressionEliminator(CompilationState& state, DefinitionBody& definition)
+    :ast_store_(*state.ast_store_), definition_(definition) {}
+
+    void run_statement(Statement& statement);
+    // wraps the expression in a return statement if there's anything to hoist out of it
+    void run_expression_body();
+
+    CSE_Stats stats_{};
+
+private:
+    struct Occurrence {
+        Expression* expression;
+        size_t statement_index;
+    };
+
+    void run_block(Block& block);
+    bool hoist_one(Block& block);
+    void collect_candidates(Expression* root, size_t statement_index,
+        std::vector<Occurrence>& candidates) const;
+    std::optional<Expression*> statement_root(const Statement& statement) const;
+
+    AST_Store& ast_store_;
+    DefinitionBody& definition_;
+    std::unordered_set<const Statement*> bindings_{};
+};
+
+std::optional<Expression*> CommonSubexpressionEliminator::statement_root(
+    const Statement& statement) const {
+
+    switch (statement.statement_type) {
+        case StatementType::expression_statement:
+        case StatementType::return_:
+            return std::get<Expression*>(statement.value);
+
+        case StatementType::conditional:
+            return statement.get_value<ConditionalValue>().condition;
+
+        case StatementType::assignment: {
+            auto body = statement.get_value<Assignment>().body;
+            if (auto expression = std::get_if<Expression*>(&body->body()))
+                return *expression;
+            return std::nullopt;
+        }
+
+        default:
+            return std::nullopt;
+    }
+}
+
+void CommonSubexpressionEliminator::collect_candidates(Expression* root, size_t statement_index,
+    std::vector<Occurrence>& candidates) const {
+
+    std::vector<Expression*> to_visit{root};
+
+    while (!to_visit.empty()) {
+        Expression* expression = to_visit.back();
+        to_visit.pop_back();
+
+        switch (expression->expression_type) {
+            case ExpressionType::call: {
+                if (is_cse_candidate(*expression))
+                    candidates.push_back({expression, statement_index});
+
+                const auto& args = std::get<1>(expression->call_value());
+                to_visit.insert(to_visit.end(), args.rbegin(), args.rend());
+                break;
+            }
+
+            // the branches only get evaluated sometimes
+            case ExpressionType::ternary_expression:
+                to_visit.push_back(expression->ternary_value().condition);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+bool CommonSubexpressionEliminator::hoist_one(Block& block) {
+    std::vector<Occurrence> candidates{};
+
+    for (size_t i = 0; i < block.size(); i++) {
+        if (auto root = statement_root(*block[i]))
+            collect_candidates(*root, i, candidates);
+    }
+
+    // group the candidates by structure, in the order they were first seen
+    std::unordered_map<size_t, std::vector<size_t>> groups_by_hash{};
+    std::vector<std::vector<Occurrence>> groups{};
+
+    for (const Occurrence& candidate: candidates) {
+        auto& bucket = groups_by_hash[structural_hash(*candidate.expression)];
+
+        auto group = std::find_if(bucket.begin(), bucket.end(), [&](size_t group_index) {
+            return structurally_equal(*groups[group_index].front().expression,
+                *candidate.expression);
+        });
+
+        if (group != bucket.end()) {
+            groups[*group].push_back(candidate);
+            continue;
+        }
+
+        bucket.push_back(groups.size());
+        groups.push_back({candidate});
+    }
+
+    // the biggest repeated call first, the calls nested in it go away with it
+    const std::vector<Occurrence>* best = nullptr;
+    size_t best_size = 0;
+
+    for (const auto& group: groups) {
+        if (group.size() < 2)
+            continue;
+
+        size_t size = node_count(*group.front().expression);
+        if (size > best_size) {
+            best = &group;
+            best_size = size;
+        }
+    }
+
+    if (!best)
+        return false;
+
+    const Expression& first = *best->front().expression;
+    SourceLocation location = first.location;
+
+    // the binding takes over the arguments of the first call, the rest are deleted
+    Expression* value = ast_store_.allocate_expression(Expression{first});
+    auto [header, body] = create_let_definition(ast_store_,
+        MAPS_INTERNALS_PREFIX + "cse_" + std::to_string(stats_.bindings_created), value, location);
+    header->is_top_level_ = false;
+
+    Log::debug_extra(location) << "Hoisting " << *value << " repeated " << best->size() <<
+        " times into " << *header << Endl;
+
+    size_t first_use = block.size();
+
+    for (size_t i = 0; const Occurrence& occurrence: *best) {
+        Expression& expression = *occurrence.expression;
+        first_use = std::min(first_use, occurrence.statement_index);
+
+        if (i++ > 0) {
+            for (auto arg: std::get<1>(expression.call_value()))
+                ast_store_.delete_expression_recursive(arg);
+        }
+
+        auto declared_type = expression.declared_type;
+        expression = Expression{ExpressionType::reference, header, value->type,
+            expression.location};
+        expression.declared_type = declared_type;
+    }
+
+    Statement* binding = create_assignment_statement(ast_store_,
+        create_reference(ast_store_, header, location), body, location);
+    bindings_.insert(binding);
+    block.insert(block.begin() + first_use, binding);
+
+    stats_.bindings_created++;
+    stats_.calls_eliminated += best->size() - 1;
+    return true;
+}
+
+void CommonSubexpressionEliminator::run_block(Block& block) {
+    // the values user assignments give might change between two calls that look the same
+    bool has_assignments = std::any_of(block.begin(), block.end(), [this](const Statement* statement) {
+        return statement->statement_type == StatementType::assignment &&
+            !bindings_.contains(statement);
+    });
+
+    if (!has_assignments) {
+        while (hoist_one(block));
+    }
+
+    for (Statement* statement: block) {
+        if (!bindings_.contains(statement))
+            run_statement(*statement);
+    }
+}
+
+void CommonSubexpressionEliminator::run_statement(Statement& statement) {
+    switch (statement.statement_type) {
+        case StatementType::block:
+            return run_block(statement.get_value<Block>());
+
+        case StatementType::expression_statement:
+        case StatementType::return_: {
+            Block block{&statement};
+            while (hoist_one(block));
+
+            if (block.size() == 1)
+                return;
+
+            // the bindings need a block to go into
+            Statement* moved = ast_store_.allocate_statement(Statement{statement});
+            block.back() = moved;
+            statement.statement_type = StatementType::block;
+            statement.value = block;
+            return;
+        }
+
+        case StatementType::conditional: {
+            auto& conditional = statement.get_value<ConditionalValue>();
+            run_statement(*conditional.body);
+            if (conditional.else_branch)
+                run_statement(**conditional.else_branch);
+            return;
+        }
+
+        case StatementType::loop:
+            return run_statement(*statement.get_value<LoopStatementValue>().body);
+
+        default:
+            return;
+    }
+}
+
+void CommonSubexpressionEliminator::run_expression_body() {
+    Expression* expression = std::get<Expression*>(definition_.body());
+
+    Statement* statement = create_return_statement(ast_store_, expression, expression->location);
+    run_statement(*statement);
+
+    if (statement->statement_type != StatementType::block) {
+        ast_store_.delete_statement(statement);
+        return;
+    }
+
+    definition_.body() = statement;
+}
+
+} // anonymous namespace
+
+// both walk the expressions with explicit stacks, since generated expressions can nest deeply
+
+size_t structural_hash(const Expression& expression) {
+    size_t hash = 0;
+    std::vector<const Expression*> to_visit{&expression};
+
+    while (!to_visit.empty()) {
+        const Expression* current = to_visit.back();
+        to_visit.pop_back();
+
+        hash = combine(hash, node_hash(*current));
+        push_operands(*current, to_visit);
+    }
+
+    return hash;
+}
+
+bool structurally_equal(const Expression& lhs, const Expression& rhs) {
+    // nodes_equal checks that the operand counts match, so the stacks stay in step
+    std::vector<const Expression*> lhs_to_visit{&lhs};
+    std::vector<const Expression*> rhs_to_visit{&rhs};
+
+    while (!lhs_to_visit.empty()) {
+        const Expression* lhs_current = lhs_to_visit.back();
+        const Expression* rhs_current = rhs_to_visit.back();
+        lhs_to_visit.pop_back();
+        rhs_to_visit.pop_back();
+
+        if (!nodes_equal(*lhs_current, *rhs_current))
+            return false;
+
+        push_operands(*lhs_current, lhs_to_visit);
+        push_operands(*rhs_current, rhs_to_visit);
+    }
+
+    return true;
+}
+
+CSE_Stats eliminate_common_subexpressions(CompilationState& state, DefinitionBody& definition) {
+    if (!definition.get_type()->is_function())
+        return {};
+
+    CommonSubexpressionEliminator eliminator{state, definition};
+
+    std::visit(overloaded {
+        [&](Expression*) {
+            // the inliner only takes expression bodies, and inlining saves more than the
+            // bindings would
+            auto cost = inline_cost(definition);
+            if (cost && *cost <= state.compiler_options_.inline_budget)
+                return;
+
+            eliminator.run_expression_body();
+        },
+        [&eliminator](Statement* statement) { eliminator.run_statement(*statement); },
+        [](auto) {}
+    }, definition.body());
+
+    const CSE_Stats& stats = eliminator.stats_;
+    if (stats.calls_eliminated > 0) {
+        Log::debug_extra(definition.location()) << "Eliminated " << stats.calls_eliminated <<
+            " repeated calls from " << definition << " with " << stats.bindings_created <<
+            " bindings" << Endl;
+
+        Profiler::count(ProfilerCounter::calls_eliminated, stats.calls_eliminated);
+    }
+
+    return stats;
+}
+
+} // namespace Maps
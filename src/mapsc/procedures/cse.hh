@@ -0,0 +1,34 @@
+#ifndef __CSE_HH
+#define __CSE_HH
+
+#include <cstddef>
+
+namespace Maps {
+
+struct Expression;
+class CompilationState;
+class DefinitionBody;
+
+// A hash over the shape of an expression: node kinds, types, values, callees and arguments
+// Expressions that are structurally_equal hash the same
+size_t structural_hash(const Expression& expression);
+bool structurally_equal(const Expression& lhs, const Expression& rhs);
+
+struct CSE_Stats {
+    size_t bindings_created = 0;
+    size_t calls_eliminated = 0;
+};
+
+// Hoists pure calls that are repeated within a block into local bindings ahead of the first
+// statement using them, and replaces the calls with references to the bindings
+// Only calls that are evaluated every time their statement is are considered, i.e. not ones in
+// ternary branches, and blocks with assignments of their own are left alone since the
+// arguments might change between the calls
+// Value definitions are left alone since the REPL wrapper expects them to be expressions, and
+// so are expression bodies that fit in the inline budget, since the bindings need a block and
+// the inliner only takes expressions
+CSE_Stats eliminate_common_subexpressions(CompilationState& state, DefinitionBody& definition);
+
+} // namespace Maps
+
+#endif
@@ -0,0 +1,374 @@
+#include "evaluate.hh"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <functional>
+
+#include "common/std_visit_helper.hh"
+
+#include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+
+#include "mapsc/types/type.hh"
+#include "mapsc/types/type_defs.hh"
+#include "mapsc/types/function_type.hh"
+
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/statement.hh"
+#include "mapsc/ast/value.hh"
+
+using std::optional, std::nullopt;
+
+namespace Maps {
+
+using Log = LogInContext<LogContext::eval>;
+
+namespace {
+
+// deep enough for any sane generated code, shallow enough to not run out of stack
+constexpr size_t MAX_EVALUATION_DEPTH = 256;
+
+using BuiltinFolder = optional<KnownValue>(*)(std::span<const KnownValue>);
+
+maps_Int wrapping(maps_UInt value) {
+    return static_cast<maps_Int>(value);
+}
+
+template<typename T>
+optional<T> get_arg(std::span<const KnownValue> args, size_t index) {
+    if (index >= args.size() || !std::holds_alternative<T>(args[index]))
+        return nullopt;
+
+    return std::get<T>(args[index]);
+}
+
+// Int arithmetic wraps around like the generated code does
+optional<KnownValue> fold_unary_minus_Int(std::span<const KnownValue> args) {
+    auto value = get_arg<maps_Int>(args, 0);
+    if (!value)
+        return nullopt;
+
+    return wrapping(-static_cast<maps_UInt>(*value));
+}
+
+template<typename Operation>
+optional<KnownValue> fold_Int_binop(std::span<const KnownValue> args) {
+    auto lhs = get_arg<maps_Int>(args, 0);
+    auto rhs = get_arg<maps_Int>(args, 1);
+    if (!lhs || !rhs)
+        return nullopt;
+
+    return wrapping(Operation{}(static_cast<maps_UInt>(*lhs), static_cast<maps_UInt>(*rhs)));
+}
+
+// the runtime casts that produce plain values, the ones producing MutStrings have to allocate
+// a new string each time they run so they are left alone
+optional<KnownValue> fold_cast(const Type* target_type, std::span<const KnownValue> args) {
+    if (args.size() != 1 || std::holds_alternative<maps_MutString>(args.front()))
+        return nullopt;
+
+    if (*target_type == MutString)
+        return nullopt;
+
+    const Type* source_type = deduce_type(args.front());
+    Expression value{ExpressionType::known_value,
+        std::visit([](auto value)->ExpressionValue { return {value}; }, args.front()),
+        source_type, NO_SOURCE_LOCATION};
+
+    if (!source_type->cast_to(target_type, value))
+        return nullopt;
+
+    return value.known_value_value();
+}
+
+optional<KnownValue> fold_cast_to_Float(std::span<const KnownValue> args) {
+    return fold_cast(&Float, args);
+}
+
+optional<KnownValue> fold_cast_to_String(std::span<const KnownValue> args) {
+    return fold_cast(&String, args);
+}
+
+constexpr std::array<std::pair<const DefinitionHeader*, BuiltinFolder>, 8> BUILTIN_FOLDERS{{
+    {&unary_minus_Int_, fold_unary_minus_Int},
+    {&plus_Int_, fold_Int_binop<std::plus<maps_UInt>>},
+    {&minus_Int_, fold_Int_binop<std::minus<maps_UInt>>},
+    {&mult_Int_, fold_Int_binop<std::multiplies<maps_UInt>>},
+    {&to_Float_Int, fold_cast_to_Float},
+    {&to_String_Int, fold_cast_to_String},
+    {&to_String_Float, fold_cast_to_String},
+    {&to_String_Boolean, fold_cast_to_String},
+}};
+
+optional<BuiltinFolder> find_builtin_folder(const DefinitionHeader& callee) {
+    for (auto [builtin, folder]: BUILTIN_FOLDERS) {
+        if (same_builtin(*builtin, callee))
+            return folder;
+    }
+
+    return nullopt;
+}
+
+optional<KnownValue> evaluate(const Expression& expression, ConstantFoldCache* cache,
+    size_t depth);
+
+optional<KnownValue> evaluate_call(const Expression& expression, ConstantFoldCache* cache,
+    size_t depth) {
+
+    const auto& [callee, args] = expression.call_value();
+
+    auto folder = find_builtin_folder(*callee);
+    if (!folder || !callee->get_type()->is_function())
+        return nullopt;
+
+    auto param_types = dynamic_cast<const FunctionType*>(callee->get_type())->param_types();
+    if (param_types.size() != args.size())
+        return nullopt;
+
+    std::vector<KnownValue> arg_values{};
+    arg_values.reserve(args.size());
+
+    for (size_t i = 0; i < args.size(); i++) {
+        auto value = evaluate(*args[i], cache, depth + 1);
+
+        // NumberLiterals and such that haven't settled on a type yet don't count
+        if (!value || *deduce_type(*value) != *param_types[i])
+            return nullopt;
+
+        arg_values.push_back(std::move(*value));
+    }
+
+    if (cache) {
+        if (auto cached = cache->find(callee, arg_values))
+            return cached;
+    }
+
+    auto result = (*folder)(arg_values);
+
+    if (result && cache)
+        cache->insert(callee, arg_values, *result);
+
+    return result;
+}
+
+optional<bool> evaluate_condition(const Expression& condition, ConstantFoldCache* cache,
+    size_t depth) {
+
+    auto value = evaluate(condition, cache, depth + 1);
+    if (!value || !std::holds_alternative<bool>(*value))
+        return nullopt;
+
+    return std::get<bool>(*value);
+}
+
+optional<KnownValue> evaluate(const Expression& expression, ConstantFoldCache* cache,
+    size_t depth) {
+
+    if (depth > MAX_EVALUATION_DEPTH)
+        return nullopt;
+
+    switch (expression.expression_type) {
+        case ExpressionType::known_value:
+            return expression.known_value_value();
+
+        case ExpressionType::known_value_reference: {
+            auto definition = expression.reference_value();
+            if (!definition->body_)
+                return nullopt;
+
+            auto body = (*definition->body_)->get_value();
+            if (!std::holds_alternative<Expression*>(body))
+                return nullopt;
+
+            return evaluate(*std::get<Expression*>(body), cache, depth + 1);
+        }
+
+        case ExpressionType::call:
+            return evaluate_call(expression, cache, depth);
+
+        case ExpressionType::ternary_expression: {
+            const auto& [condition, success, failure] = expression.ternary_value();
+
+            auto condition_value = evaluate_condition(*condition, cache, depth);
+            if (!condition_value)
+                return nullopt;
+
+            return evaluate(*condition_value ? *success : *failure, cache, depth + 1);
+        }
+
+        default:
+            return nullopt;
+    }
+}
+
+} // anonymous namespace
+
+std::optional<ConstantFoldCache::Key> ConstantFoldCache::create_key(
+    const DefinitionHeader* callee, std::span<const KnownValue> args) {
+
+    Key key{callee, {}};
+    key.second.reserve(args.size());
+
+    for (const KnownValue& arg: args) {
+        auto key_value = std::visit(overloaded {
+            [](maps_Int value) -> optional<KeyValue> { return value; },
+            [](maps_Float value) -> optional<KeyValue> {
+                return std::bit_cast<uint64_t>(value); },
+            [](bool value) -> optional<KeyValue> { return value; },
+            [](const std::string& value) -> optional<KeyValue> { return value; },
+            [](const maps_MutString&) -> optional<KeyValue> { return nullopt; }
+        }, arg);
+
+        if (!key_value)
+            return nullopt;
+
+        key.second.push_back(std::move(*key_value));
+    }
+
+    return key;
+}
+
+std::optional<KnownValue> ConstantFoldCache::find(const DefinitionHeader* callee,
+    std::span<const KnownValue> args) const {
+
+    auto key = create_key(callee, args);
+    if (!key)
+        return nullopt;
+
+    std::lock_guard lock{mutex_};
+    auto it = results_.find(*key);
+    if (it == results_.end())
+        return nullopt;
+
+    hits_++;
+    return it->second;
+}
+
+void ConstantFoldCache::insert(const DefinitionHeader* callee, std::span<const KnownValue> args,
+    const KnownValue& result) {
+
+    auto key = create_key(callee, args);
+    if (!key)
+        return;
+
+    std::lock_guard lock{mutex_};
+    results_.insert({std::move(*key), result});
+}
+
+size_t ConstantFoldCache::size() const {
+    std::lock_guard lock{mutex_};
+    return results_.size();
+}
+
+uint64_t ConstantFoldCache::hits() const {
+    std::lock_guard lock{mutex_};
+    return hits_;
+}
+
+std::optional<KnownValue> evaluate(const Expression& expression, ConstantFoldCache* cache) {
+    return evaluate(expression, cache, 0);
+}
+
+std::optional<KnownValue> evaluate(const DefinitionBody& definition) {
+    return std::visit(overloaded{
+        [](Expression* expression)->std::optional<KnownValue> {
+            Log::debug_extra(expression->location) << "Evaluating " << *expression << Endl;
+
+            auto value = evaluate(*expression, nullptr, 0);
+
+            if (!value) {
+                Log::compiler_error(expression->location) << "Compile-time evaluating " <<
+                    *expression << " failed" << Endl;
+                return nullopt;
+            }
+
+            Log::debug_extra(expression->location) <<
+                "Evaluated to " << value_to_string(*value) << Endl;
+            return value;
+        },
+        [&definition](auto)->std::optional<KnownValue> {
+            Log::compiler_error(definition.location()) <<
+                "Compile time evaluating definitions with body type " <<
+                definition.node_type_string() << " not implemented" << Endl;
+            return nullopt;
+        }
+    }, definition.get_value());
+}
+
+bool fold_constants(CompilationState& state, Expression& expression) {
+    switch (expression.expression_type) {
+        case ExpressionType::call: {
+            auto value = evaluate_call(expression, state.constant_folds_.get(), 0);
+            if (!value)
+                return false;
+
+            const Type* callee_type = std::get<0>(expression.call_value())->get_type();
+            assert(callee_type->is_function() && "folded a call to a non-function");
+
+            Log::debug_extra(expression.location) << "Folded " << expression << " into " <<
+                value_to_string(*value) << Endl;
+
+            expression.expression_type = ExpressionType::known_value;
+            expression.value = std::visit([](auto value)->ExpressionValue { return {value}; },
+                *value);
+            expression.type = dynamic_cast<const FunctionType*>(callee_type)->return_type();
+
+            Profiler::count(ProfilerCounter::constants_folded);
+            return true;
+        }
+
+        case ExpressionType::ternary_expression: {
+            const auto& [condition, success, failure] = expression.ternary_value();
+
+            auto condition_value = evaluate_condition(*condition, state.constant_folds_.get(), 0);
+            if (!condition_value)
+                return false;
+
+            Log::debug_extra(expression.location) << "Folded ternary " << expression << Endl;
+
+            Expression branch = *condition_value ? *success : *failure;
+            expression = branch;
+
+            Profiler::count(ProfilerCounter::constants_folded);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool fold_constants(CompilationState& state, Statement& statement) {
+    if (statement.statement_type != StatementType::conditional)
+        return false;
+
+    const auto& conditional = statement.get_value<ConditionalValue>();
+
+    auto condition_value = evaluate_condition(*conditional.condition,
+        state.constant_folds_.get(), 0);
+    if (!condition_value)
+        return false;
+
+    Log::debug_extra(statement.location) << "Folded conditional " << statement << Endl;
+
+    if (*condition_value) {
+        Statement branch = *conditional.body;
+        statement = branch;
+    } else if (conditional.else_branch) {
+        Statement branch = **conditional.else_branch;
+        statement = branch;
+    } else {
+        statement = Statement{StatementType::empty, EmptyStatementValue{}, statement.type,
+            statement.location};
+    }
+
+    Profiler::count(ProfilerCounter::constants_folded);
+    return true;
+}
+
+} // namespace Maps
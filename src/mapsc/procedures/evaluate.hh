@@ -1,62 +1,69 @@
 #ifndef __EVALUATE_HH
 #define __EVALUATE_HH
 
+#include <cstdint>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <string>
+#include <utility>
 #include <variant>
+#include <vector>
 
-#include "common/std_visit_helper.hh"
-
-#include "mapsc/logging.hh"
+#include "common/maps_datatypes.h"
 
 #include "mapsc/ast/expression.hh"
-#include "mapsc/ast/value.hh"
-
-#include "mapsc/ast/definition.hh"
 
 namespace Maps {
 
-inline std::optional<KnownValue> evaluate(const DefinitionBody& definition) {
-    using std::nullopt;
-    using Log = LogInContext<LogContext::eval>;
-
-    return std::visit(overloaded{
-        [](Expression* expression)->std::optional<KnownValue> {
-            switch (expression->expression_type) {
-                case ExpressionType::known_value_reference: {
-                    assert(expression->reference_value()->body_ && 
-                        "evaluate called on a definition without a body");
-                    return evaluate(**expression->reference_value()->body_);
-                }
-
-                case ExpressionType::known_value: {
-                    Log::debug_extra(expression->location) << "Evaluating " << *expression << Endl;
-                    auto value = expression->known_value_value();
-
-                    if (!value) {
-                        Log::error(expression->location) << 
-                            "Evaluating " << *expression << " failed" << Endl;
-                        return nullopt;
-                    }
-
-                    Log::debug_extra(expression->location) << 
-                        "Evaluated to " << value_to_string(*value) << Endl;
-                    return value;
-                }
-                default:
-                    Log::compiler_error(expression->location) << "Compile-time evaluating " << 
-                        expression->expression_type_string() << " not implemented" << Endl;
-                    return nullopt;
-            }
-        },
-        [definition](auto)->std::optional<KnownValue> {
-            Log::compiler_error(definition.location()) << 
-                "Compile time evaluating definitions with body type " << 
-                definition.node_type_string() << " not implemented" << Endl;
-            return nullopt;
-        }
-    }, definition.get_value());
-}
+class CompilationState;
+class DefinitionBody;
+class DefinitionHeader;
+struct Statement;
+
+// Results of compile-time evaluated calls by callee and arguments
+// Shared between the copies of a compilation state, so it's safe to use from several threads
+class ConstantFoldCache {
+public:
+    std::optional<KnownValue> find(const DefinitionHeader* callee,
+        std::span<const KnownValue> args) const;
+    void insert(const DefinitionHeader* callee, std::span<const KnownValue> args,
+        const KnownValue& result);
+
+    size_t size() const;
+    uint64_t hits() const;
+
+private:
+    // floats are keyed by their bits so that NaNs don't compare equal to everything
+    using KeyValue = std::variant<maps_Int, uint64_t, bool, std::string>;
+    using Key = std::pair<const DefinitionHeader*, std::vector<KeyValue>>;
+
+    // MutStrings can't be keys, calls taking them aren't folded anyway
+    static std::optional<Key> create_key(const DefinitionHeader* callee,
+        std::span<const KnownValue> args);
+
+    mutable std::mutex mutex_;
+    std::map<Key, KnownValue> results_;
+    mutable uint64_t hits_ = 0;
+};
+
+// Evaluates an expression at compile time if it only depends on known values, pure builtin
+// calls and ternaries with known conditions. Nothing is logged if it can't be done
+// Calls are looked up from and added to the cache if one is given
+std::optional<KnownValue> evaluate(const Expression& expression,
+    ConstantFoldCache* cache = nullptr);
+
+std::optional<KnownValue> evaluate(const DefinitionBody& definition);
+
+// Replaces pure builtin calls whose arguments are known values with the result, and ternaries
+// with known conditions with the branch they take. Meant to be run bottom-up so that nested
+// calls get folded first. Returns true if the expression changed
+bool fold_constants(CompilationState& state, Expression& expression);
+
+// Replaces conditionals with known conditions with the branch they take
+bool fold_constants(CompilationState& state, Statement& statement);
 
 } // namespace Maps
 
-#endif
\ No newline at end of file
+#endif
@@ -1,5 +1,6 @@
 #include "inline.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <optional>
 #include <string>
@@ -8,10 +9,14 @@
 
 #include "mapsc/source_location.hh"
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/compilation_state.hh"
 
 #include "mapsc/types/type.hh"
 
+#include "mapsc/ast/ast_store.hh"
 #include "mapsc/ast/expression.hh"
+#include "mapsc/ast/statement.hh"
 #include "mapsc/ast/definition.hh"
 #include "mapsc/ast/definition_body.hh"
 
@@ -20,19 +25,465 @@ namespace Maps {
 
 using Log = LogInContext<LogContext::inline_>;
 
-bool inline_and_substitute(DefinitionBody& definition) {
-    return std::visit(overloaded{
-        [](auto) { return true; }
-    }, definition.body());
+namespace {
+
+std::optional<size_t> parameter_index(const Expression& expression,
+    std::span<DefinitionHeader* const> parameters) {
+
+    if (expression.expression_type != ExpressionType::reference &&
+        expression.expression_type != ExpressionType::known_value_reference)
+        return std::nullopt;
+
+    auto it = std::find(parameters.begin(), parameters.end(), expression.reference_value());
+    if (it == parameters.end())
+        return std::nullopt;
+
+    return it - parameters.begin();
 }
 
-bool inline_call(Expression& expression) {
-    assert(expression.expression_type == ExpressionType::call && 
-        "inline_call called with not a call");
+// The expression walks here use explicit stacks, since generated expressions can nest deeply
+
+// counts the nodes and how many times each parameter is used
+// nullopt if there's something in there that can't be copied into another definition
+std::optional<size_t> expression_cost(const Expression& root,
+    std::span<DefinitionHeader* const> parameters, std::vector<size_t>& parameter_uses) {
+
+    size_t cost = 0;
+    std::vector<const Expression*> to_visit{&root};
+
+    while (!to_visit.empty()) {
+        const Expression& expression = *to_visit.back();
+        to_visit.pop_back();
+        cost++;
+
+        switch (expression.expression_type) {
+            case ExpressionType::known_value:
+                break;
+
+            case ExpressionType::reference:
+            case ExpressionType::known_value_reference: {
+                if (auto index = parameter_index(expression, parameters)) {
+                    parameter_uses.at(*index)++;
+                    break;
+                }
+
+                // the parameters of an enclosing function don't exist at the call site
+                auto definition_type = expression.reference_value()->definition_type_;
+                if (definition_type == DefinitionType::parameter ||
+                    definition_type == DefinitionType::discarded_parameter)
+                    return std::nullopt;
+
+                break;
+            }
+
+            case ExpressionType::call: {
+                const auto& args = std::get<1>(expression.call_value());
+                to_visit.insert(to_visit.end(), args.begin(), args.end());
+                break;
+            }
+
+            case ExpressionType::ternary_expression: {
+                const auto& [condition, success, failure] = expression.ternary_value();
+                to_visit.insert(to_visit.end(), {condition, success, failure});
+                break;
+            }
+
+            default:
+                return std::nullopt;
+        }
+    }
 
-    assert(false && "not updated");
-    auto [callee, args] = expression.call_value();
-    // return inline_call(expression, *callee);
+    return cost;
+}
+
+std::optional<size_t> expression_cost(const Expression& expression) {
+    std::vector<size_t> parameter_uses{};
+    return expression_cost(expression, {}, parameter_uses);
+}
+
+bool calls(const Expression& root, const DefinitionHeader* callee) {
+    std::vector<const Expression*> to_visit{&root};
+
+    while (!to_visit.empty()) {
+        const Expression& expression = *to_visit.back();
+        to_visit.pop_back();
+
+        switch (expression.expression_type) {
+            case ExpressionType::call: {
+                const auto& [call_callee, args] = expression.call_value();
+                if (call_callee == callee)
+                    return true;
+
+                to_visit.insert(to_visit.end(), args.begin(), args.end());
+                break;
+            }
+
+            case ExpressionType::ternary_expression: {
+                const auto& [condition, success, failure] = expression.ternary_value();
+                to_visit.insert(to_visit.end(), {condition, success, failure});
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    return false;
+}
+
+// follows "let f = \x -> ..." from f to the lambda that has the parameters
+std::optional<const DefinitionBody*> function_body(const DefinitionHeader& callee) {
+    const DefinitionHeader* definition = &callee;
+
+    for (size_t i = 0; i < MAX_INLINE_DEPTH; i++) {
+        if (!definition->body_)
+            return std::nullopt;
+
+        const DefinitionBody* body = *definition->body_;
+        if (!body->parameters().empty())
+            return body;
+
+        auto expression = std::get_if<Expression*>(&body->body());
+        if (!expression)
+            return std::nullopt;
+
+        bool is_function_reference = 
+            ((*expression)->expression_type == ExpressionType::reference || 
+                (*expression)->expression_type == ExpressionType::known_value_reference) &&
+            (*expression)->reference_value()->get_type()->is_function();
+
+        if (!is_function_reference)
+            return body;
+
+        definition = (*expression)->reference_value();
+    }
+
+    return std::nullopt;
+}
+
+// copies the callee body with the arguments in place of the parameters
+// the arguments are copied too since later transforms modify nodes in place
+Expression* substitute(AST_Store& ast_store, const Expression& expression,
+    std::span<DefinitionHeader* const> parameters, std::span<Expression* const> args) {
+
+    struct Copy {
+        // where the copy goes, still pointing at the original until then
+        Expression** slot;
+        const Expression* original;
+        // empty within the arguments, they're copied as they are
+        std::span<DefinitionHeader* const> parameters;
+        // an argument takes the declared type of the parameter reference if it has none
+        std::optional<const Type*> declared_type = std::nullopt;
+    };
+
+    Expression* root = nullptr;
+    std::vector<Copy> to_copy{{&root, &expression, parameters}};
+
+    while (!to_copy.empty()) {
+        Copy current = to_copy.back();
+        to_copy.pop_back();
+
+        if (auto index = parameter_index(*current.original, current.parameters)) {
+            to_copy.push_back({current.slot, args[*index], {}, 
+                current.original->declared_type});
+            continue;
+        }
+
+        Expression* copy = ast_store.allocate_expression(Expression{*current.original});
+        if (!copy->declared_type)
+            copy->declared_type = current.declared_type;
+        *current.slot = copy;
+
+        switch (copy->expression_type) {
+            case ExpressionType::call:
+                for (auto& arg: std::get<1>(copy->call_value()))
+                    to_copy.push_back({&arg, arg, current.parameters});
+                break;
+
+            case ExpressionType::ternary_expression: {
+                auto& [condition, success, failure] = copy->ternary_value();
+                for (Expression** sub_expression: {&condition, &success, &failure})
+                    to_copy.push_back({sub_expression, *sub_expression, current.parameters});
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    return root;
+}
+
+bool is_external(const DefinitionHeader& callee) {
+    switch (callee.definition_type_) {
+        case DefinitionType::external:
+        case DefinitionType::builtin:
+        case DefinitionType::external_builtin:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void record_decision(const Expression& call, const DefinitionHeader& callee,
+    InlineDecision decision, size_t cost) {
+
+    if (decision == InlineDecision::inlined)
+        Profiler::count(ProfilerCounter::calls_inlined);
+
+    if (!Profiler::global.is_enabled() || is_external(callee))
+        return;
+
+    Profiler::global.record_inline_site({callee.name_string(), call.location.line, 
+        call.location.column, inline_decision_name(decision), cost});
+}
+
+InlineDecision decide(const Expression& call, size_t budget,
+    std::span<const DefinitionHeader* const> inlining_stack, size_t& cost,
+    const DefinitionBody*& function) {
+
+    const auto& [callee, args] = call.call_value();
+
+    if (!callee->get_type()->is_function() || is_external(*callee))
+        return InlineDecision::not_inlinable;
+
+    if (callee->get_type()->is_impure())
+        return InlineDecision::impure;
+
+    auto body = function_body(*callee);
+    if (!body)
+        return InlineDecision::not_inlinable;
+
+    function = *body;
+    const auto& parameters = function->parameters();
+
+    auto on_stack = [inlining_stack](const DefinitionHeader* definition) {
+        return std::find(inlining_stack.begin(), inlining_stack.end(), definition) != 
+            inlining_stack.end();
+    };
+
+    if (on_stack(callee) || on_stack(function->header_))
+        return InlineDecision::recursive;
+
+    if (inlining_stack.size() > MAX_INLINE_DEPTH)
+        return InlineDecision::too_deep;
+
+    auto expression = std::get_if<Expression*>(&function->body());
+    if (!expression || parameters.size() != args.size())
+        return InlineDecision::not_inlinable;
+
+    if (calls(**expression, callee) || calls(**expression, function->header_))
+        return InlineDecision::recursive;
+
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i]->expression_type == ExpressionType::missing_arg)
+            return InlineDecision::not_inlinable;
+
+        // the arguments have been cast to the parameter types when the call was created,
+        // anything else would change what the body means
+        const Type* parameter_type = parameters[i]->get_type();
+        if (parameter_type->is_unknown() || *args[i]->type != *parameter_type)
+            return InlineDecision::not_inlinable;
+    }
+
+    std::vector<size_t> parameter_uses(parameters.size(), 0);
+    auto body_cost = expression_cost(**expression, parameters, parameter_uses);
+    if (!body_cost)
+        return InlineDecision::not_inlinable;
+
+    cost = *body_cost;
+
+    // arguments used more than once get evaluated more than once
+    for (size_t i = 0; i < args.size(); i++) {
+        if (parameter_uses[i] <= 1)
+            continue;
+
+        auto arg_cost = expression_cost(*args[i]);
+        if (!arg_cost)
+            return InlineDecision::not_inlinable;
+
+        cost += (parameter_uses[i] - 1) * *arg_cost;
+    }
+
+    return cost <= budget ? InlineDecision::inlined : InlineDecision::over_budget;
+}
+
+size_t inline_calls(CompilationState& state, Expression& root, size_t budget,
+    std::vector<const DefinitionHeader*>& inlining_stack) {
+
+    struct Visit {
+        // nullptr marks where the callee pushed onto the inlining stack goes out of scope
+        Expression* expression;
+        // calls are visited again after their arguments
+        bool args_done = false;
+    };
+
+    size_t inlined = 0;
+    std::vector<Visit> to_visit{{&root}};
+
+    while (!to_visit.empty()) {
+        auto [expression, args_done] = to_visit.back();
+        to_visit.pop_back();
+
+        if (!expression) {
+            inlining_stack.pop_back();
+            continue;
+        }
+
+        if (!args_done) {
+            switch (expression->expression_type) {
+                case ExpressionType::call: {
+                    to_visit.push_back({expression, true});
+                    const auto& args = std::get<1>(expression->call_value());
+                    for (auto arg = args.rbegin(); arg != args.rend(); arg++)
+                        to_visit.push_back({*arg});
+                    break;
+                }
+
+                case ExpressionType::ternary_expression: {
+                    const auto& [condition, success, failure] = expression->ternary_value();
+                    for (auto sub_expression: {failure, success, condition})
+                        to_visit.push_back({sub_expression});
+                    break;
+                }
+
+                default:
+                    break;
+            }
+            continue;
+        }
+
+        const DefinitionHeader* callee = std::get<0>(expression->call_value());
+        if (try_inline_call(state, *expression, budget, inlining_stack) != InlineDecision::inlined)
+            continue;
+
+        // the inlined body might have calls of its own
+        inlined++;
+        inlining_stack.push_back(callee);
+        to_visit.push_back({nullptr});
+        to_visit.push_back({expression});
+    }
+
+    return inlined;
+}
+
+size_t inline_calls(CompilationState& state, Statement& statement, size_t budget,
+    std::vector<const DefinitionHeader*>& inlining_stack) {
+
+    switch (statement.statement_type) {
+        case StatementType::expression_statement:
+        case StatementType::return_:
+            return inline_calls(state, *std::get<Expression*>(statement.value), budget, 
+                inlining_stack);
+
+        case StatementType::block: {
+            size_t inlined = 0;
+            for (auto sub_statement: statement.get_value<Block>())
+                inlined += inline_calls(state, *sub_statement, budget, inlining_stack);
+            return inlined;
+        }
+
+        case StatementType::conditional: {
+            auto& [condition, body, else_branch] = statement.get_value<ConditionalValue>();
+            size_t inlined = inline_calls(state, *condition, budget, inlining_stack) +
+                inline_calls(state, *body, budget, inlining_stack);
+
+            if (else_branch)
+                inlined += inline_calls(state, **else_branch, budget, inlining_stack);
+            return inlined;
+        }
+
+        case StatementType::loop: {
+            auto& [condition, body, initializer] = statement.get_value<LoopStatementValue>();
+            size_t inlined = 0;
+
+            if (initializer)
+                inlined += inline_calls(state, **initializer, budget, inlining_stack);
+            if (condition)
+                inlined += inline_calls(state, *condition, budget, inlining_stack);
+            return inlined + inline_calls(state, *body, budget, inlining_stack);
+        }
+
+        default:
+            return 0;
+    }
+}
+
+} // anonymous namespace
+
+std::string_view inline_decision_name(InlineDecision decision) {
+    switch (decision) {
+        case InlineDecision::inlined:
+            return "inlined";
+        case InlineDecision::impure:
+            return "impure";
+        case InlineDecision::recursive:
+            return "recursive";
+        case InlineDecision::too_deep:
+            return "too deep";
+        case InlineDecision::over_budget:
+            return "over budget";
+        case InlineDecision::not_inlinable:
+            return "not inlinable";
+    }
+}
+
+std::optional<size_t> inline_cost(const DefinitionBody& definition) {
+    auto expression = std::get_if<Expression*>(&definition.body());
+    if (!expression)
+        return std::nullopt;
+
+    std::vector<size_t> parameter_uses(definition.parameters().size(), 0);
+    return expression_cost(**expression, definition.parameters(), parameter_uses);
+}
+
+InlineDecision try_inline_call(CompilationState& state, Expression& call, size_t budget,
+    std::span<const DefinitionHeader* const> inlining_stack) {
+
+    assert(call.expression_type == ExpressionType::call && 
+        "try_inline_call called with not a call");
+
+    const auto& [callee, args] = call.call_value();
+
+    size_t cost = 0;
+    const DefinitionBody* function = nullptr;
+    InlineDecision decision = decide(call, budget, inlining_stack, cost, function);
+    record_decision(call, *callee, decision, cost);
+
+    if (decision != InlineDecision::inlined) {
+        Log::debug_extra(call.location) << "Not inlining " << call << ": " << 
+            inline_decision_name(decision) << Endl;
+        return decision;
+    }
+
+    Log::debug_extra(call.location) << "Inlining " << call << " (" << cost << " nodes)" << Endl;
+
+    Expression* inlined = substitute(*state.ast_store_, 
+        *std::get<Expression*>(function->body()), function->parameters(), args);
+
+    // the body of a lambda carries the function type, the call has the return type
+    inlined->type = call.type;
+    if (call.declared_type)
+        inlined->declared_type = call.declared_type;
+    inlined->location = call.location;
+
+    call = *inlined;
+    return InlineDecision::inlined;
+}
+
+size_t inline_calls(CompilationState& state, DefinitionBody& definition) {
+    size_t budget = state.compiler_options_.inline_budget;
+    std::vector<const DefinitionHeader*> inlining_stack{definition.header_};
+
+    return std::visit(overloaded{
+        [&](Expression* expression) { 
+            return inline_calls(state, *expression, budget, inlining_stack); },
+        [&](Statement* statement) { 
+            return inline_calls(state, *statement, budget, inlining_stack); },
+        [](auto) -> size_t { return 0; }
+    }, definition.body());
 }
 
 bool inline_call(Expression& expression, const DefinitionBody& definition) {
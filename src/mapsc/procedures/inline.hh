@@ -1,16 +1,48 @@
 #ifndef __INLINE_HH
 #define __INLINE_HH
 
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+
 namespace Maps {
 
 struct Expression;
+class CompilationState;
 class DefinitionBody;
-    
-bool inline_and_substitute(DefinitionBody& definition);
+class DefinitionHeader;
+
+enum class InlineDecision {
+    inlined,
+    impure,
+    recursive,
+    too_deep,
+    over_budget,
+    not_inlinable,
+};
+
+std::string_view inline_decision_name(InlineDecision decision);
+
+// inlining within inlined bodies stops at this depth
+constexpr size_t MAX_INLINE_DEPTH = 8;
+
+// The number of nodes in the body of a function, nullopt if it can't be inlined at all, e.g.
+// because the body is a statement or refers to parameters of some enclosing function
+std::optional<size_t> inline_cost(const DefinitionBody& definition);
+
+// Inlines the calls to pure functions whose inline cost, plus the cost of arguments that get
+// duplicated, fits in the inline budget. Calls within the inlined bodies get the same treatment
+// up to MAX_INLINE_DEPTH. Returns the number of calls inlined
+size_t inline_calls(CompilationState& state, DefinitionBody& definition);
+
+// Decides on a single call and inlines it if it can. The stack holds the definitions being
+// inlined into, a call to any of them is left alone
+InlineDecision try_inline_call(CompilationState& state, Expression& call, size_t budget,
+    std::span<const DefinitionHeader* const> inlining_stack);
 
 // these run a typecheck, so be sure not to call them from typechecks to avoid infinite recursion
 [[nodiscard]] bool inline_call(Expression& call, const DefinitionBody& definition);
-[[nodiscard]] bool inline_call(Expression& call); 
 
 [[nodiscard]] bool substitute_value_reference(Expression& reference, const DefinitionBody& definition);
 [[nodiscard]] bool substitute_value_reference(Expression& reference);
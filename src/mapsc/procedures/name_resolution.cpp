@@ -5,12 +5,14 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include "mapsc/ast/definition.hh"
 #include "mapsc/ast/expression.hh"
 #include "mapsc/ast/reference.hh"
 #include "mapsc/ast/scope.hh"
+#include "mapsc/ast/value.hh"
 #include "mapsc/compilation_state.hh"
 #include "mapsc/logging.hh"
 
@@ -22,5 +24,99 @@ using std::optional, std::nullopt;
 
 namespace Maps {
 
+using Log = LogInContext<LogContext::name_resolution>;
+
+namespace {
+
+bool apply_identifier_lookup(Expression& expression, const NameLookup& lookup) {
+    Log::debug_extra(expression.location, [&expression](auto& log) {
+        log << "Resolving " << expression << Endl;
+    });
+
+    if (auto definition = std::get_if<const DefinitionHeader*>(&lookup)) {
+        Log::debug_extra(expression.location, [definition](auto& log) {
+            log << "Found definition " << **definition << Endl;
+        });
+
+        convert_to_reference(expression, *definition);
+
+        if (expression.expression_type == ExpressionType::known_value_reference)
+            if (!convert_by_value_substitution(expression))
+                return false;
+
+        return true;
+    }
+
+    // Try to find a value
+    auto value = std::get_if<const BuiltinValue*>(&lookup);
+
+    if (!value) {
+        Log::error(expression.location) << "Unknown identifier: " << expression.string_value() << Endl;
+        return false;
+    }
+
+    Log::debug_extra(expression.location, [value](auto& log) {
+        log << "Found known value " << *value << Endl;
+    });
+
+    convert_to_known_value(expression, **value);
+    return true;
+}
+
+bool apply_operator_lookup(Expression& expression, const NameLookup& lookup) {
+    auto definition = std::get_if<const DefinitionHeader*>(&lookup);
+
+    if (!definition) {
+        Log::error(expression.location) << "Unknown operator: " << expression.string_value() << Endl;
+        return false;
+    }
+
+    if (!(*definition)->is_operator()) {
+        Log::compiler_error(expression.location) << 
+            "resolve_operator called with non-operator: " << **definition;
+        return false;
+    }
+
+    convert_to_operator_reference(expression, dynamic_cast<const Operator*>(*definition));
+    return true;
+}
+
+bool apply_type_identifier_lookup(Expression& expression, const NameLookup& lookup) {
+    Log::debug_extra(expression.location) << "Attempting to resolve " << expression << Endl;
+    
+    auto type = std::get_if<const Type*>(&lookup);
+    if (!type) {
+        Log::error(expression.location) << 
+            "Unkown type identifier: " << expression.string_value() << Endl;
+        return false;
+    }
+    Log::debug_extra(expression.location) << "Found type " << **type << Endl;
+    
+    expression.expression_type = ExpressionType::type_reference;
+    expression.value = *type;
+    return true;
+}
+
+} // anonymous namespace
+
+bool apply_name_lookup(Expression& expression, const NameLookup& lookup) {
+    switch (expression.expression_type) {
+        case ExpressionType::identifier:
+            return apply_identifier_lookup(expression, lookup);
+
+        case ExpressionType::operator_identifier:
+            return apply_operator_lookup(expression, lookup);
+
+        case ExpressionType::type_identifier:
+            return apply_type_identifier_lookup(expression, lookup);
+
+        default:
+            Log::error(expression.location) <<
+                "Unexpected expression type in unresolved_identifiers_and_operators";
+            assert(false 
+                && "Unexpected expression type in unresolved_identifiers_and_operators");
+            return false;
+    }
+}
 
 } // namespace Maps
\ No newline at end of file
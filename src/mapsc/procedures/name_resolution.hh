@@ -1,11 +1,15 @@
 #ifndef __NAME_RESOLUTION_HH
 #define __NAME_RESOLUTION_HH
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <initializer_list>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
+#include <variant>
 #include <vector>
 
 #include "mapsc/ast/definition.hh"
@@ -16,6 +20,7 @@
 #include "mapsc/ast/builtin.hh"
 #include "mapsc/compilation_state.hh"
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
 
 #include "mapsc/source_location.hh"
 #include "mapsc/types/type_store.hh"
@@ -45,78 +50,123 @@ std::optional<const BuiltinValue*> lookup_value(std::string_view name,
     return builtin_values.get_identifier(name);
 }
 
+// What a name was found to refer to
+// Looking names up doesn't touch the expressions, so lookups can run on many threads and the 
+// results be applied afterwards
+using NameLookup = std::variant<
+    std::monostate,             // not found
+    const DefinitionHeader*,
+    const BuiltinValue*,
+    const Type*
+>;
+
 template<typename BuiltinScopes>
-bool resolve_identifier(const Scope& scope, Expression& expression, BuiltinScopes builtins) {
-    using Log = LogInContext<LogContext::name_resolution>;
+NameLookup lookup_identifier(const Scope& scope, std::string_view name, BuiltinScopes builtins) {
+    auto& [builtin_externals, builtin_values] = builtins;
 
-    Log::debug_extra(expression.location) << "Resolving " << expression << Endl;
+    if (auto definition = lookup_definition(scope, name, builtin_externals))
+        return *definition;
 
-    auto& [builtin_externals, builtin_values] = builtins;
-    auto definition = lookup_definition(scope, expression.string_value(), builtin_externals);
+    if (auto value = lookup_value(name, builtin_values))
+        return *value;
 
-    if (definition) {
-        Log::debug_extra(expression.location) << "Found definition " << **definition << Endl;
+    return std::monostate{};
+}
 
-        convert_to_reference(expression, *definition);
+template<typename BuiltinScopes>
+NameLookup lookup_name(const CompilationState& state, const Scope& scope, 
+    const Expression& expression, BuiltinScopes builtins) {
 
-        if (expression.expression_type == ExpressionType::known_value_reference)
-            if (!convert_by_value_substitution(expression))
-                return false;
+    auto& [builtin_externals, _] = builtins;
 
-        return true;
-    }
+    switch (expression.expression_type) {
+        case ExpressionType::identifier:
+            return lookup_identifier(scope, expression.string_value(), builtins);
+
+        case ExpressionType::operator_identifier:
+            if (auto definition = lookup_definition(scope, expression.string_value(), builtin_externals))
+                return *definition;
 
-    // Try to find a value
-    auto value = lookup_value(expression.string_value(), builtin_values);
+            return std::monostate{};
 
-    if (!value) {
-        Log::error(expression.location) << "Unknown identifier: " << expression.string_value() << Endl;
-        return false;
+        case ExpressionType::type_identifier:
+            if (auto type = state.types_->get(expression.string_value()))
+                return *type;
+
+            return std::monostate{};
+
+        default:
+            return std::monostate{};
     }
+}
 
-    Log::debug_extra(expression.location) << "Found known value " << *value << Endl;
+// Converts the expression into what the lookup found, logs an error if it wasn't found
+// Substituting known values reads the bodies of other definitions, so lookups have to be 
+// applied in source order
+bool apply_name_lookup(Expression& expression, const NameLookup& lookup);
 
-    convert_to_known_value(expression, **value);
-    return true;
+template<typename BuiltinScopes>
+bool resolve_identifier(const Scope& scope, Expression& expression, BuiltinScopes builtins) {
+    assert(expression.expression_type == ExpressionType::identifier && 
+        "resolve_identifier called with not an identifier");
+
+    return apply_name_lookup(expression, 
+        lookup_identifier(scope, expression.string_value(), builtins));
 }
 
+// number of expressions a resolver thread picks up at a time
+constexpr size_t NAME_RESOLUTION_BATCH_SIZE = 1024;
+
+// Looks the names up on thread_count threads and then applies the results in source order,
+// so errors and the resulting AST are the same as with the serial version
+// The scope is only read through the const ref and the type store is frozen while the 
+// lookups run
 template<typename BuiltinScopes>
-bool resolve_operator(const Scope& scope, Expression& expression, BuiltinScopes builtins) {
+bool resolve_identifiers_parallel(CompilationState& state, const Scope& scope, 
+    std::vector<Expression*>& unresolved_identifiers, BuiltinScopes builtins, 
+    unsigned int thread_count) {
+
     using Log = LogInContext<LogContext::name_resolution>;
 
-    auto& [builtin_externals, _] = builtins;
-    auto definition = lookup_definition(scope, expression.string_value(), builtin_externals);
+    size_t batch_count = (unresolved_identifiers.size() + NAME_RESOLUTION_BATCH_SIZE - 1) / 
+        NAME_RESOLUTION_BATCH_SIZE;
+    thread_count = std::min<size_t>(thread_count, batch_count);
 
-    if (!definition) {
-        Log::error(expression.location) << "Unknown operator: " << expression.string_value() << Endl;
-        return false;
-    }
+    Log::debug_extra(NO_SOURCE_LOCATION) << "Resolving identifiers on " << 
+        thread_count << " threads" << Endl;
 
-    if (!(*definition)->is_operator()) {
-        Log::compiler_error(expression.location) << 
-            "resolve_operator called with non-operator: " << **definition;
-        return false;
-    }
+    std::vector<NameLookup> lookups(unresolved_identifiers.size());
+    std::atomic<size_t> next_batch = 0;
 
-    convert_to_operator_reference(expression, dynamic_cast<const Operator*>(*definition));
-    return true;
-}
+    auto work = [&]() {
+        for (size_t batch = next_batch++; batch < batch_count; batch = next_batch++) {
+            size_t begin = batch * NAME_RESOLUTION_BATCH_SIZE;
+            size_t end = std::min(begin + NAME_RESOLUTION_BATCH_SIZE, unresolved_identifiers.size());
 
-inline bool resolve_type_identifier(CompilationState& state, Expression& expression) {
-    using Log = LogInContext<LogContext::name_resolution>;
+            for (size_t index = begin; index < end; index++)
+                lookups[index] = lookup_name(state, scope, *unresolved_identifiers[index], builtins);
+        }
+    };
 
-    Log::debug_extra(expression.location) << "Attempting to resolve " << expression << Endl;
-    
-    std::optional<const Type*> type = state.types_->get(expression.string_value());
-    if (!type) {
-        Log::error(expression.location) << 
-            "Unkown type identifier: " << expression.string_value() << Endl;
-        return false;
+    {
+        TypeStore::Freeze freeze{*state.types_};
+
+        std::vector<std::thread> workers{};
+        for (unsigned int i = 1; i < thread_count; i++)
+            workers.emplace_back(work);
+
+        work();
+
+        for (auto& worker: workers)
+            worker.join();
     }
-    Log::debug_extra(expression.location) << "Found type " << **type << Endl;
-    
-    expression.expression_type = ExpressionType::type_reference;
-    expression.value = *type;
+
+    for (size_t index = 0; index < unresolved_identifiers.size(); index++) {
+        if (!apply_name_lookup(*unresolved_identifiers[index], lookups[index]))
+            return false;
+    }
+
+    Profiler::count(ProfilerCounter::identifiers_resolved, unresolved_identifiers.size());
     return true;
 }
 
@@ -127,32 +177,19 @@ bool resolve_identifiers(CompilationState& state, const Scope& scope,
 
     using Log = LogInContext<LogContext::name_resolution>;
 
+    auto thread_count = state.compiler_options_.thread_count;
+    if (thread_count > 1 && unresolved_identifiers.size() > NAME_RESOLUTION_BATCH_SIZE)
+        return resolve_identifiers_parallel(state, scope, unresolved_identifiers, builtins, 
+            thread_count);
+
     Log::debug_extra(NO_SOURCE_LOCATION) << "Resolving identifiers" << Endl;
 
     for (Expression* expression: unresolved_identifiers) {
-        switch (expression->expression_type) {
-            case ExpressionType::identifier:
-                if (!resolve_identifier(scope, *expression, builtins))
-                    return false;
-                break;
-            case ExpressionType::operator_identifier:
-                if (!resolve_operator(scope, *expression, builtins))
-                    return false;
-                break;
-
-            case ExpressionType::type_identifier:
-                if (!resolve_type_identifier(state, *expression))
-                    return false;
-                break;
-
-            default:
-                Log::error(expression->location) <<
-                    "Unexpected expression type in unresolved_identifiers_and_operators";
-                assert(false 
-                    && "Unexpected expression type in unresolved_identifiers_and_operators");
-                return false;
-        }
+        if (!apply_name_lookup(*expression, lookup_name(state, scope, *expression, builtins)))
+            return false;
     }
+
+    Profiler::count(ProfilerCounter::identifiers_resolved, unresolved_identifiers.size());
     return true;
 }
 
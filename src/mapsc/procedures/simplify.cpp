@@ -1,98 +1,296 @@
 #include "simplify.hh"
 
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 #include "common/std_visit_helper.hh"
 
+#include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
+
+#include "mapsc/ast/ast_store.hh"
 #include "mapsc/ast/definition_body.hh"
 #include "mapsc/ast/definition.hh"
 #include "mapsc/ast/statement.hh"
 #include "mapsc/types/type.hh"
+#include "mapsc/procedures/evaluate.hh"
 
 namespace Maps {
 
-// TODO: delete the simplified nodes properly
-bool simplify(DefinitionBody& definition) {
-    return std::visit(overloaded {
-        [](Error) { return false; },
-        [](Undefined) { return true; },
-        [&definition](Statement* statement) {
-            switch (statement->statement_type) {                
-                // expression statements get replaced by their expressions
-                case StatementType::expression_statement:
-                    // TODO: check type
-                    definition.body() = std::get<Expression*>(statement->value);
-                    statement->statement_type = StatementType::deleted;
-                    return simplify(definition);
-                    
-                case StatementType::block: {
-                    // TODO: check type
-                    auto& block = statement->get_value<Block>();
-
-                    if (block.size() == 0) {
-                        definition.body() = Undefined{};
-                        statement->statement_type = StatementType::deleted;
-                        return true;
-                    }
-
-                    if (block.size() == 1) {
-                        *statement = *block.back();
-                        // definition SEGFAULTS! ???:
-                        // block->back()->statement_type = StatementType::deleted;
-                        return simplify(definition);
-                    }
-
-                    return false;
-                }
+using Log = LogInContext<LogContext::transform_stage>;
 
-                // pure functions and non-function return statements get converted to expressions
-                case StatementType::return_: {
-                    auto type = definition.get_type();
-                    if (!type->is_function()) {
-                        statement->statement_type = StatementType::deleted;
-                        definition.body() = std::get<Expression*>(statement->value);
-                        return simplify(definition);
-                    }
-
-                    if (type->is_pure() && type->arity() == 0) {
-                        definition.body() = std::get<Expression*>(statement->value);
-                        statement->statement_type = StatementType::deleted;
-                        return simplify(definition);
-                    }
-
-                    return false;
-                }
+namespace {
+
+std::vector<Statement*> child_statements(Statement& statement) {
+    switch (statement.statement_type) {
+        case StatementType::block:
+            return statement.get_value<Block>();
+
+        case StatementType::conditional: {
+            auto [_, body, else_branch] = statement.get_value<ConditionalValue>();
+            if (else_branch)
+                return {body, *else_branch};
+            return {body};
+        }
+
+        case StatementType::loop: {
+            auto [_, body, initializer] = statement.get_value<LoopStatementValue>();
+            if (initializer)
+                return {*initializer, body};
+            return {body};
+        }
+
+        default:
+            return {};
+    }
+}
 
+class Rewriter {
+public:
+    Rewriter(AST_Store& ast_store, SimplifyCounts& counts): ast_store_(ast_store), counts_(counts) {}
+
+    bool simplify_statement(Statement& statement) {
+        switch (statement.statement_type) {
+            case StatementType::block:
+                return simplify_block(statement);
+
+            case StatementType::conditional:
+                return simplify_conditional(statement);
+
+            default:
+                return false;
+        }
+    }
+
+    bool collapse_body(DefinitionBody& definition);
+
+private:
+    bool simplify_block(Statement& statement) {
+        auto& block = statement.get_value<Block>();
+        bool changed = false;
+
+        Block simplified{};
+        simplified.reserve(block.size());
+
+        for (Statement* sub_statement: block) {
+            switch (sub_statement->statement_type) {
                 case StatementType::empty:
-                    statement->statement_type = StatementType::deleted;
-                    definition.body() = Undefined{};
-                    return true;
+                    ast_store_.delete_statement(sub_statement);
+                    counts_.empty_statements_removed++;
+                    changed = true;
+                    break;
+
+                // blocks don't have scopes of their own, so the statements can be spliced in
+                case StatementType::block: {
+                    const auto& inner = sub_statement->get_value<Block>();
+                    simplified.insert(simplified.end(), inner.begin(), inner.end());
+                    ast_store_.delete_statement(sub_statement);
+                    counts_.blocks_flattened++;
+                    changed = true;
+                    break;
+                }
 
                 default:
-                    return false;
+                    simplified.push_back(sub_statement);
+            }
+        }
+
+        if (changed)
+            block = std::move(simplified);
+
+        if (block.empty()) {
+            statement.statement_type = StatementType::empty;
+            statement.value = EmptyStatementValue{};
+            counts_.empty_statements_removed++;
+            return true;
+        }
+
+        // the parser won't accept some statements alone in braces, but hoisting them out of a
+        // block doesn't change what they mean
+        if (block.size() == 1) {
+            Statement* inner = block.front();
+            statement = *inner;
+            ast_store_.delete_statement(inner);
+            counts_.blocks_flattened++;
+            return true;
+        }
+
+        return changed;
+    }
+
+    bool simplify_conditional(Statement& statement) {
+        auto& conditional = statement.get_value<ConditionalValue>();
+
+        auto condition = evaluate(*conditional.condition);
+        if (condition && std::holds_alternative<bool>(*condition)) {
+            Statement* taken = std::get<bool>(*condition) ?
+                conditional.body : conditional.else_branch.value_or(nullptr);
+            Statement* dropped = std::get<bool>(*condition) ?
+                conditional.else_branch.value_or(nullptr) : conditional.body;
+
+            Log::debug_extra(statement.location) << "Folding conditional " << statement << Endl;
+
+            ast_store_.delete_expression_recursive(conditional.condition);
+            if (dropped)
+                ast_store_.delete_statement_recursive(dropped);
+
+            if (taken) {
+                statement = *taken;
+                ast_store_.delete_statement(taken);
+            } else {
+                statement = Statement{StatementType::empty, EmptyStatementValue{}, statement.type,
+                    statement.location};
             }
-        },
 
-        [](Expression*) {
+            counts_.conditionals_folded++;
             return true;
-            // switch (expression->expression_type) {
-            //     case ExpressionType::call: {
-            //         auto type = expression->type;
-            //         if (!type->is_function())
-            //             return inline_call(*expression, definition);
-
-            //         if (type->is_pure() && type->arity() == 0)
-            //             return inline_call(*expression, definition);
-
-            //         return false;
-            //     }
-
-            //     default:
-            //         return false;
-            // }
-        },
-    }, definition.body());
+        }
+
+        if (conditional.else_branch &&
+            (*conditional.else_branch)->statement_type == StatementType::empty) {
+
+            ast_store_.delete_statement(*conditional.else_branch);
+            conditional.else_branch = std::nullopt;
+            counts_.empty_statements_removed++;
+            return true;
+        }
+
+        return false;
+    }
+
+    AST_Store& ast_store_;
+    SimplifyCounts& counts_;
+};
+
+class Simplifier {
+public:
+    Simplifier(AST_Store& ast_store): rewriter_(ast_store, counts_) {}
+
+    void run(Statement* root) {
+        push_subtree(root, nullptr);
+
+        while (!worklist_.empty()) {
+            Statement* statement = worklist_.back();
+            worklist_.pop_back();
+
+            // might have been spliced into its parent after it was queued again
+            if (statement->statement_type == StatementType::deleted)
+                continue;
+
+            bool changed = false;
+            while (rewriter_.simplify_statement(*statement))
+                changed = true;
+
+            if (!changed)
+                continue;
+
+            // the children might have been moved here from a node that's now deleted
+            for (Statement* child: child_statements(*statement))
+                parents_[child] = statement;
+
+            if (Statement* parent = parents_[statement])
+                worklist_.push_back(parent);
+        }
+    }
+
+    bool collapse_body(DefinitionBody& definition) {
+        return rewriter_.collapse_body(definition);
+    }
+
+    SimplifyCounts counts_{};
+
+private:
+    // queued in pre-order so that popping from the back sees children before their parents
+    void push_subtree(Statement* root, Statement* parent) {
+        std::vector<std::pair<Statement*, Statement*>> to_visit{{root, parent}};
+
+        while (!to_visit.empty()) {
+            auto [statement, statement_parent] = to_visit.back();
+            to_visit.pop_back();
+
+            parents_[statement] = statement_parent;
+            worklist_.push_back(statement);
+
+            auto children = child_statements(*statement);
+            for (auto it = children.rbegin(); it != children.rend(); it++)
+                to_visit.push_back({*it, statement});
+        }
+    }
+
+    Rewriter rewriter_;
+    std::vector<Statement*> worklist_{};
+    std::unordered_map<Statement*, Statement*> parents_{};
+};
+
+bool Rewriter::collapse_body(DefinitionBody& definition) {
+    auto statement = std::get<Statement*>(definition.body());
+
+    switch (statement->statement_type) {
+        // expression statements get replaced by their expressions
+        case StatementType::expression_statement:
+            break;
+
+        // pure functions and non-function return statements get converted to expressions
+        case StatementType::return_: {
+            auto type = definition.get_type();
+            if (type->is_function() && !(type->is_pure() && type->arity() == 0))
+                return false;
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    definition.body() = std::get<Expression*>(statement->value);
+    ast_store_.delete_statement(statement);
+    counts_.bodies_collapsed++;
+    return true;
+}
+
+} // anonymous namespace
+
+std::optional<SimplifyCounts> simplify(AST_Store& ast_store, DefinitionBody& definition) {
+    if (std::holds_alternative<Error>(definition.body()))
+        return std::nullopt;
+
+    Simplifier simplifier{ast_store};
+
+    if (std::holds_alternative<Statement*>(definition.body())) {
+        simplifier.run(std::get<Statement*>(definition.body()));
+        simplifier.collapse_body(definition);
+    }
+
+    const SimplifyCounts& counts = simplifier.counts_;
+    if (counts.total() > 0) {
+        Log::debug_extra(definition.location()) << "Simplified " << definition << ": " <<
+            counts.blocks_flattened << " blocks flattened, " <<
+            counts.empty_statements_removed << " empty statements removed, " <<
+            counts.conditionals_folded << " conditionals folded, " <<
+            counts.bodies_collapsed << " bodies collapsed" << Endl;
+
+        Profiler::count(ProfilerCounter::statements_simplified, counts.total());
+    }
+
+    return counts;
+}
+
+bool simplify_statement(AST_Store& ast_store, Statement& statement, SimplifyCounts& counts) {
+    Rewriter rewriter{ast_store, counts};
+
+    bool changed = false;
+    while (rewriter.simplify_statement(statement))
+        changed = true;
+
+    return changed;
+}
+
+bool collapse_body(AST_Store& ast_store, DefinitionBody& definition, SimplifyCounts& counts) {
+    if (!std::holds_alternative<Statement*>(definition.body()))
+        return false;
+
+    return Rewriter{ast_store, counts}.collapse_body(definition);
 }
 
-} // namespace Maps
\ No newline at end of file
+} // namespace Maps
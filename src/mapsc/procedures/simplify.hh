@@ -1,12 +1,41 @@
 #ifndef __SIMPLIFY_HH
 #define __SIMPLIFY_HH
 
+#include <cstddef>
+#include <optional>
+
 namespace Maps {
 
+class AST_Store;
 class DefinitionBody;
+struct Statement;
+
+struct SimplifyCounts {
+    size_t blocks_flattened = 0;        // single statement blocks and blocks nested in blocks
+    size_t empty_statements_removed = 0;
+    size_t conditionals_folded = 0;
+    size_t bodies_collapsed = 0;        // statement bodies turned into expressions
+
+    size_t total() const {
+        return blocks_flattened + empty_statements_removed + conditionals_folded +
+            bodies_collapsed;
+    }
+};
+
+// Flattens blocks, drops empty statements and folds conditionals whose conditions are known,
+// then turns the body into an expression if it's just one
+// Works bottom-up from a worklist rather than recursing, so deep nesting is fine. The nodes
+// that get replaced are deleted through the AST_Store
+// Returns nullopt if the definition is an error
+std::optional<SimplifyCounts> simplify(AST_Store& ast_store, DefinitionBody& definition);
 
-bool simplify(DefinitionBody& definition);
+// The same rewrites one statement at a time, for running them as part of a walk that someone
+// else does. The statement's children should have been simplified already
+// Returns true if the statement changed
+bool simplify_statement(AST_Store& ast_store, Statement& statement, SimplifyCounts& counts);
+// turns a statement body that's just an expression or a return into an expression
+bool collapse_body(AST_Store& ast_store, DefinitionBody& definition, SimplifyCounts& counts);
 
 } // namespace Maps
 
-#endif
\ No newline at end of file
+#endif
@@ -38,19 +38,8 @@ bool SimpleTypeChecker::visit_expression(Expression* expression) {
     if (expression->declared_type && **expression->declared_type != *expression->type)
         return handle_declared_type(*expression, *expression->declared_type);
 
-    switch (expression->expression_type) {
-        case ExpressionType::known_value:
-            return true;
-
-        case ExpressionType::call:
-            
-        default:
-            assert(false && "Unexpected expressiontype in typecheck");
-            return false;
-    }
-
-    Log::error(expression->location) << "Type check on " << *expression << " failed" << Endl;
-
+    // only declared types are checked so far, the other expressions are typed as they're created
+    return true;
 }
 
 bool SimpleTypeChecker::visit_definition(DefinitionBody* definition) {
@@ -0,0 +1,291 @@
+#include "profiler.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <thread>
+#include <utility>
+
+namespace Maps {
+
+Profiler Profiler::global{};
+
+namespace {
+
+uint32_t current_thread_id() {
+    static std::atomic<uint32_t> next_thread_id = 0;
+    thread_local uint32_t thread_id = next_thread_id++;
+    return thread_id;
+}
+
+std::string escape_json(std::string_view string) {
+    std::string escaped{};
+    escaped.reserve(string.size());
+
+    for (char c: string) {
+        switch (c) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+} // anonymous namespace
+
+std::string_view counter_name(ProfilerCounter counter) {
+    switch (counter) {
+        case ProfilerCounter::tokens_lexed:
+            return "tokens lexed";
+        case ProfilerCounter::nodes_allocated:
+            return "nodes allocated";
+        case ProfilerCounter::identifiers_resolved:
+            return "identifiers resolved";
+        case ProfilerCounter::functions_emitted:
+            return "functions emitted";
+        case ProfilerCounter::constants_folded:
+            return "constants folded";
+        case ProfilerCounter::calls_inlined:
+            return "calls inlined";
+        case ProfilerCounter::statements_simplified:
+            return "statements simplified";
+        case ProfilerCounter::calls_eliminated:
+            return "calls eliminated";
+        case ProfilerCounter::object_cache_hits:
+            return "object cache hits";
+        case ProfilerCounter::object_cache_misses:
+            return "object cache misses";
+        case ProfilerCounter::nodes_freed:
+            return "nodes freed";
+    }
+}
+
+void Profiler::reset() {
+    std::lock_guard lock{events_mutex_};
+    events_.clear();
+    memory_peaks_.clear();
+    memory_samples_.clear();
+    last_memory_stats_ = std::nullopt;
+    pass_totals_.clear();
+    inline_sites_.clear();
+    epoch_ = Clock::now();
+
+    for (auto& counter: counters_)
+        counter = 0;
+}
+
+void Profiler::record(std::string name, std::string_view category, Clock::time_point start, 
+    Clock::time_point end) {
+    
+    std::lock_guard lock{events_mutex_};
+    events_.push_back({std::move(name), category, start, end - start, current_thread_id()});
+}
+
+void Profiler::sample_memory(std::string_view stage, const MemoryStats& stats) {
+    size_t bytes = stats.total_bytes();
+
+    std::lock_guard lock{events_mutex_};
+    memory_samples_.push_back({Clock::now(), bytes});
+    last_memory_stats_ = stats;
+
+    auto it = std::find_if(memory_peaks_.begin(), memory_peaks_.end(), 
+        [stage](const auto& peak) { return peak.first == stage; });
+
+    if (it == memory_peaks_.end()) {
+        memory_peaks_.push_back({std::string{stage}, bytes});
+        return;
+    }
+
+    it->second = std::max(it->second, bytes);
+}
+
+void Profiler::record_pass(std::string_view pass, Clock::duration duration, uint64_t visits, 
+    uint64_t changes) {
+
+    std::lock_guard lock{events_mutex_};
+    auto it = std::find_if(pass_totals_.begin(), pass_totals_.end(), 
+        [pass](const auto& totals) { return totals.name == pass; });
+
+    if (it == pass_totals_.end()) {
+        pass_totals_.push_back({std::string{pass}});
+        it = pass_totals_.end() - 1;
+    }
+
+    it->duration += duration;
+    it->visits += visits;
+    it->changes += changes;
+}
+
+std::vector<Profiler::PassTotals> Profiler::pass_totals() const {
+    std::lock_guard lock{events_mutex_};
+    return pass_totals_;
+}
+
+void Profiler::record_inline_site(InlineSite site) {
+    std::lock_guard lock{events_mutex_};
+    inline_sites_.push_back(std::move(site));
+}
+
+std::vector<Profiler::InlineSite> Profiler::inline_sites() const {
+    std::lock_guard lock{events_mutex_};
+    return inline_sites_;
+}
+
+std::optional<size_t> Profiler::memory_peak(std::string_view stage) const {
+    std::lock_guard lock{events_mutex_};
+    for (const auto& [name, bytes]: memory_peaks_) {
+        if (name == stage)
+            return bytes;
+    }
+
+    return std::nullopt;
+}
+
+uint64_t Profiler::get_count(ProfilerCounter counter) const {
+    return counters_.at(static_cast<size_t>(counter)).load(std::memory_order_relaxed);
+}
+
+std::vector<Profiler::Event> Profiler::events() const {
+    std::lock_guard lock{events_mutex_};
+    return events_;
+}
+
+void Profiler::write_report(std::ostream& ostream) const {
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    struct Total {
+        std::string_view category;
+        Clock::duration duration{};
+        size_t count = 0;
+    };
+
+    std::vector<std::string> order{};
+    std::map<std::string, Total> totals{};
+
+    for (const Event& event: events()) {
+        auto [it, inserted] = totals.insert({event.name, Total{event.category}});
+        if (inserted)
+            order.push_back(event.name);
+
+        it->second.duration += event.duration;
+        it->second.count++;
+    }
+
+    ostream << "===== time report =====\n";
+
+    for (const std::string& name: order) {
+        const Total& total = totals.at(name);
+        ostream << std::left << std::setw(32) << name << std::right << std::setw(12) << 
+            std::fixed << std::setprecision(3) << Milliseconds{total.duration}.count() << " ms" <<
+            std::setw(8) << total.count << "x  (" << total.category << ")\n";
+    }
+
+    ostream << "----- counters -----\n";
+
+    for (size_t i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+        auto counter = static_cast<ProfilerCounter>(i);
+        ostream << std::left << std::setw(32) << counter_name(counter) << std::right << 
+            std::setw(12) << get_count(counter) << '\n';
+    }
+
+    std::lock_guard lock{events_mutex_};
+    if (!pass_totals_.empty()) {
+        ostream << "----- transform passes -----\n";
+
+        for (const PassTotals& totals: pass_totals_) {
+            ostream << std::left << std::setw(32) << totals.name << std::right << std::setw(12) << 
+                std::fixed << std::setprecision(3) << Milliseconds{totals.duration}.count() << 
+                " ms" << std::setw(10) << totals.visits << " visits" << std::setw(10) << 
+                totals.changes << " changes\n";
+        }
+    }
+
+    if (!inline_sites_.empty()) {
+        ostream << "----- inline decisions -----\n";
+
+        for (const InlineSite& site: inline_sites_) {
+            std::string call_site = std::to_string(site.line) + ":" + std::to_string(site.column);
+            ostream << std::left << std::setw(12) << call_site << std::setw(20) << site.callee << 
+                std::setw(16) << site.decision << std::right << std::setw(8) << site.cost << 
+                " nodes\n";
+        }
+    }
+
+    if (memory_peaks_.empty()) {
+        ostream << std::flush;
+        return;
+    }
+
+    ostream << "----- peak memory -----\n";
+
+    for (const auto& [stage, bytes]: memory_peaks_)
+        ostream << std::left << std::setw(32) << stage << std::right << std::setw(12) << 
+            bytes << " bytes\n";
+
+    ostream << "----- memory by node kind -----\n";
+    last_memory_stats_->write_report(ostream);
+    ostream << std::flush;
+}
+
+void Profiler::write_chrome_trace(std::ostream& ostream) const {
+    using Microseconds = std::chrono::duration<double, std::micro>;
+
+    auto events = this->events();
+    Clock::time_point end = epoch_;
+
+    ostream << "{\"traceEvents\":[\n";
+
+    for (const Event& event: events) {
+        end = std::max(end, event.start + event.duration);
+
+        ostream << "{\"name\":\"" << escape_json(event.name) << 
+            "\",\"cat\":\"" << escape_json(event.category) << 
+            "\",\"ph\":\"X\",\"ts\":" << Microseconds{event.start - epoch_}.count() <<
+            ",\"dur\":" << Microseconds{event.duration}.count() << 
+            ",\"pid\":1,\"tid\":" << event.thread_id << "},\n";
+    }
+
+    // counters are only known in total, so they're emitted once at the end of the trace
+    ostream << "{\"name\":\"counters\",\"ph\":\"C\",\"ts\":" << 
+        Microseconds{end - epoch_}.count() << ",\"pid\":1,\"args\":{";
+
+    for (size_t i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+        auto counter = static_cast<ProfilerCounter>(i);
+        ostream << (i == 0 ? "" : ",") << '"' << counter_name(counter) << "\":" << 
+            get_count(counter);
+    }
+
+    ostream << "}}";
+
+    std::lock_guard lock{events_mutex_};
+    for (const MemorySample& sample: memory_samples_) {
+        ostream << ",\n{\"name\":\"memory\",\"ph\":\"C\",\"ts\":" << 
+            Microseconds{sample.time - epoch_}.count() << ",\"pid\":1,\"args\":{\"bytes\":" << 
+            sample.bytes << "}}";
+    }
+
+    ostream << "\n]}\n" << std::flush;
+}
+
+ProfileScope::ProfileScope(std::string_view name, std::string_view category)
+:active_(Profiler::global.is_enabled()), name_(name), category_(category) {
+    if (active_)
+        start_ = Profiler::Clock::now();
+}
+
+ProfileScope::~ProfileScope() {
+    if (active_)
+        Profiler::global.record(std::string{name_}, category_, start_, Profiler::Clock::now());
+}
+
+} // namespace Maps
@@ -0,0 +1,142 @@
+#ifndef __PROFILER_HH
+#define __PROFILER_HH
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapsc/memory_stats.hh"
+
+namespace Maps {
+
+constexpr auto PROFILER_COUNTERS_START_LINE = __LINE__;
+enum class ProfilerCounter {
+    tokens_lexed            = 0,
+    nodes_allocated         = 1,
+    identifiers_resolved    = 2,
+    functions_emitted       = 3,
+    constants_folded        = 4,
+    calls_inlined           = 5,
+    statements_simplified   = 6,
+    calls_eliminated        = 7,
+    object_cache_hits       = 8,
+    object_cache_misses     = 9,
+    nodes_freed             = 10,
+};
+constexpr auto PROFILER_COUNTER_COUNT = __LINE__ - PROFILER_COUNTERS_START_LINE - 3;
+
+std::string_view counter_name(ProfilerCounter counter);
+
+// Collects timed events and counters for --time-report and --time-trace
+// Does nothing unless enabled, so the scopes and counters can stay in the hot paths
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        std::string name;
+        std::string_view category;
+        Clock::time_point start;
+        Clock::duration duration;
+        uint32_t thread_id;
+    };
+
+    struct PassTotals {
+        std::string name;
+        Clock::duration duration{};
+        uint64_t visits = 0;
+        uint64_t changes = 0;
+    };
+
+    // what the inliner decided on a single call site
+    struct InlineSite {
+        std::string callee;
+        int line;
+        int column;
+        std::string_view decision;
+        size_t cost;
+    };
+
+    static Profiler global;
+
+    static void count(ProfilerCounter counter, uint64_t amount = 1) {
+        if (global.is_enabled())
+            global.counters_[static_cast<size_t>(counter)].fetch_add(amount, 
+                std::memory_order_relaxed);
+    }
+
+    bool is_enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void enable(bool enabled = true) { enabled_ = enabled; }
+    void reset();
+
+    void record(std::string name, std::string_view category, Clock::time_point start, 
+        Clock::time_point end);
+
+    // records the live memory at the end of a stage and keeps the largest sample for each stage
+    // Nodes that were deleted during the stage aren't counted, see AST_Store::memory_stats, 
+    // so this is a lower bound on the stage's high-water mark rather than the mark itself
+    void sample_memory(std::string_view stage, const MemoryStats& stats);
+    // adds to the running totals of a transform pass, see PassManager
+    void record_pass(std::string_view pass, Clock::duration duration, uint64_t visits, 
+        uint64_t changes);
+    void record_inline_site(InlineSite site);
+
+    uint64_t get_count(ProfilerCounter counter) const;
+    std::vector<Event> events() const;
+    std::optional<size_t> memory_peak(std::string_view stage) const;
+    // in the order the passes first ran
+    std::vector<PassTotals> pass_totals() const;
+    std::vector<InlineSite> inline_sites() const;
+
+    // total time and number of events per name, in the order they first appeared
+    void write_report(std::ostream& ostream) const;
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    void write_chrome_trace(std::ostream& ostream) const;
+
+private:
+    std::atomic<bool> enabled_ = false;
+    Clock::time_point epoch_ = Clock::now();
+
+    mutable std::mutex events_mutex_;
+    std::vector<Event> events_{};
+
+    struct MemorySample {
+        Clock::time_point time;
+        size_t bytes;
+    };
+
+    std::vector<std::pair<std::string, size_t>> memory_peaks_{};
+    std::vector<MemorySample> memory_samples_{};
+    std::optional<MemoryStats> last_memory_stats_{};
+    std::vector<PassTotals> pass_totals_{};
+    std::vector<InlineSite> inline_sites_{};
+
+    std::array<std::atomic<uint64_t>, PROFILER_COUNTER_COUNT> counters_{};
+};
+
+// Records the time from construction to destruction as an event
+class ProfileScope {
+public:
+    ProfileScope(std::string_view name, std::string_view category = "stage");
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool active_;
+    std::string_view name_;
+    std::string_view category_;
+    Profiler::Clock::time_point start_;
+};
+
+} // namespace Maps
+
+#endif
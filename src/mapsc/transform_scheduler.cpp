@@ -0,0 +1,252 @@
+#include "transform_scheduler.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "common/work_stealing_pool.hh"
+
+#include "mapsc/logging.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/dependency_tracker.hh"
+#include "mapsc/transform_stage.hh"
+
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/definition_body.hh"
+
+namespace Maps {
+
+using Log = LogInContext<LogContext::transform_stage>;
+
+namespace {
+
+// Tarjan's algorithm with an explicit stack so that long reference chains don't recurse
+// Components come out with the ones they reference before them
+std::vector<std::vector<size_t>> strongly_connected_components(
+    const std::vector<std::vector<size_t>>& edges) {
+
+    constexpr size_t UNVISITED = std::numeric_limits<size_t>::max();
+
+    std::vector<size_t> indices(edges.size(), UNVISITED);
+    std::vector<size_t> lowlinks(edges.size(), 0);
+    std::vector<bool> on_stack(edges.size(), false);
+    std::vector<size_t> stack{};
+    size_t next_index = 0;
+
+    // node and the next of its edges to follow
+    std::vector<std::pair<size_t, size_t>> call_stack{};
+    std::vector<std::vector<size_t>> components{};
+
+    auto enter = [&](size_t node) {
+        indices[node] = lowlinks[node] = next_index++;
+        stack.push_back(node);
+        on_stack[node] = true;
+        call_stack.push_back({node, 0});
+    };
+
+    for (size_t root = 0; root < edges.size(); root++) {
+        if (indices[root] != UNVISITED)
+            continue;
+
+        enter(root);
+
+        while (!call_stack.empty()) {
+            auto [node, edge] = call_stack.back();
+
+            if (edge < edges[node].size()) {
+                call_stack.back().second++;
+                size_t target = edges[node][edge];
+
+                if (indices[target] == UNVISITED) {
+                    enter(target);
+                } else if (on_stack[target]) {
+                    lowlinks[node] = std::min(lowlinks[node], indices[target]);
+                }
+                continue;
+            }
+
+            call_stack.pop_back();
+            if (!call_stack.empty()) {
+                size_t parent = call_stack.back().first;
+                lowlinks[parent] = std::min(lowlinks[parent], lowlinks[node]);
+            }
+
+            if (lowlinks[node] != indices[node])
+                continue;
+
+            std::vector<size_t> component{};
+            size_t member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                on_stack[member] = false;
+                component.push_back(member);
+            } while (member != node);
+
+            std::sort(component.begin(), component.end());
+            components.push_back(std::move(component));
+        }
+    }
+
+    return components;
+}
+
+} // anonymous namespace
+
+DefinitionGraph build_definition_graph(std::span<DefinitionBody* const> definitions) {
+    std::unordered_map<const DefinitionHeader*, size_t> indices{};
+    for (size_t index = 0; index < definitions.size(); index++)
+        indices.insert({definitions[index]->header_, index});
+
+    std::vector<std::vector<size_t>> edges(definitions.size());
+    for (size_t index = 0; index < definitions.size(); index++) {
+        for (const DefinitionHeader* reference: collect_references(*definitions[index])) {
+            auto it = indices.find(reference);
+            if (it != indices.end())
+                edges[index].push_back(it->second);
+        }
+
+        std::sort(edges[index].begin(), edges[index].end());
+    }
+
+    DefinitionGraph graph{};
+    graph.components = strongly_connected_components(edges);
+    graph.dependents.resize(graph.components.size());
+    graph.dependency_counts.resize(graph.components.size(), 0);
+
+    std::vector<size_t> component_of(definitions.size());
+    for (size_t component = 0; component < graph.components.size(); component++) {
+        for (size_t index: graph.components[component])
+            component_of[index] = component;
+    }
+
+    for (size_t component = 0; component < graph.components.size(); component++) {
+        std::vector<size_t> dependencies{};
+
+        for (size_t index: graph.components[component]) {
+            for (size_t reference: edges[index]) {
+                if (component_of[reference] != component)
+                    dependencies.push_back(component_of[reference]);
+            }
+        }
+
+        std::sort(dependencies.begin(), dependencies.end());
+        dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+        graph.dependency_counts[component] = dependencies.size();
+        for (size_t dependency: dependencies)
+            graph.dependents[dependency].push_back(component);
+    }
+
+    return graph;
+}
+
+bool schedule_transforms(CompilationState& state, Scope& scope,
+    std::span<DefinitionBody* const> definitions, unsigned int thread_count) {
+
+    auto graph = build_definition_graph(definitions);
+    size_t component_count = graph.components.size();
+
+    if (component_count == 0)
+        return true;
+
+    thread_count = std::clamp<size_t>(thread_count, 1, component_count);
+
+    Log::debug_extra(NO_SOURCE_LOCATION) << "Scheduling transforms on " << definitions.size() <<
+        " definitions in " << component_count << " components on " << thread_count <<
+        " threads" << Endl;
+
+    enum class Outcome: uint8_t { success, failed, skipped };
+
+    struct ComponentState {
+        std::atomic<size_t> remaining_dependencies = 0;
+        std::atomic<bool> dependency_failed = false;
+        Outcome outcome = Outcome::success;
+        std::vector<LogRecord> log{};
+    };
+
+    std::vector<ComponentState> components(component_count);
+
+    // each worker gets a store of its own, see AST_Store::merge
+    std::vector<CompilationState> worker_states(thread_count, state);
+    for (auto& worker_state: worker_states)
+        worker_state.ast_store_ = std::make_shared<AST_Store>();
+
+    // the pass stats aren't shared between threads, so each worker gets its own copy
+    std::vector<PassManager> pass_managers(thread_count, create_transform_pass_manager(state));
+
+    WorkStealingPool<size_t> pool{thread_count};
+
+    for (size_t component = 0; component < component_count; component++) {
+        components[component].remaining_dependencies = graph.dependency_counts[component];
+
+        if (graph.dependency_counts[component] == 0)
+            pool.push(component, component);
+    }
+
+    pool.run([&](unsigned int worker, size_t component) {
+        ComponentState& component_state = components[component];
+        const auto& members = graph.components[component];
+
+        {
+            LogStream::Capture capture{};
+
+            if (component_state.dependency_failed) {
+                component_state.outcome = Outcome::skipped;
+
+                for (size_t index: members) {
+                    Log::error(definitions[index]->location()) << "Skipping transforms on " <<
+                        *definitions[index] << " since a definition it uses failed" << Endl;
+                }
+            } else {
+                for (size_t index: members) {
+                    if (!run_transforms(worker_states[worker], scope, *definitions[index],
+                        pass_managers[worker])) {
+                        component_state.outcome = Outcome::failed;
+                        break;
+                    }
+                }
+            }
+
+            component_state.log = capture.take();
+        }
+
+        for (size_t dependent: graph.dependents[component]) {
+            if (component_state.outcome != Outcome::success)
+                components[dependent].dependency_failed = true;
+
+            if (--components[dependent].remaining_dependencies == 0)
+                pool.push(worker, dependent);
+        }
+    });
+
+    for (auto& worker_state: worker_states)
+        state.ast_store_->merge(std::move(*worker_state.ast_store_));
+
+    for (auto& pass_manager: pass_managers)
+        pass_manager.flush_stats();
+
+    // logs are written in the order of each component's first definition
+    std::vector<size_t> log_order(component_count);
+    for (size_t component = 0; component < component_count; component++)
+        log_order[component] = component;
+
+    std::sort(log_order.begin(), log_order.end(), [&graph](size_t lhs, size_t rhs) {
+        return graph.components[lhs].front() < graph.components[rhs].front();
+    });
+
+    bool success = true;
+    for (size_t component: log_order) {
+        LogStream::global.write_records(std::move(components[component].log));
+        success = success && components[component].outcome == Outcome::success;
+    }
+
+    return success;
+}
+
+} // namespace Maps
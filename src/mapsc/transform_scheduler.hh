@@ -0,0 +1,36 @@
+#ifndef __TRANSFORM_SCHEDULER_HH
+#define __TRANSFORM_SCHEDULER_HH
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Maps {
+
+class CompilationState;
+class DefinitionBody;
+class Scope;
+
+// Dependencies between top level definitions, with mutually recursive definitions collapsed
+// into strongly connected components
+struct DefinitionGraph {
+    // components in dependency order, each listing indices into the definitions in source order
+    std::vector<std::vector<size_t>> components;
+    // the components that reference each component
+    std::vector<std::vector<size_t>> dependents;
+    // the number of other components each component references
+    std::vector<size_t> dependency_counts;
+};
+
+DefinitionGraph build_definition_graph(std::span<DefinitionBody* const> definitions);
+
+// Runs the transforms on each component once the components it depends on are done, with
+// independent components running concurrently on thread_count threads
+// Every failure is reported rather than just the first, definitions depending on a failed one
+// are skipped. Logs are written in source order once everything is done
+[[nodiscard]] bool schedule_transforms(CompilationState& state, Scope& scope,
+    std::span<DefinitionBody* const> definitions, unsigned int thread_count);
+
+} // namespace Maps
+
+#endif
@@ -1,13 +1,28 @@
 #include "transform_stage.hh"
 
 #include <span>
+#include <variant>
+#include <vector>
+
+#include "common/std_visit_helper.hh"
 
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
 
 #include "mapsc/ast/scope.hh"
 #include "mapsc/ast/definition.hh"
 
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/statement.hh"
+
 #include "mapsc/procedures/concretize.hh"
+#include "mapsc/procedures/cse.hh"
+#include "mapsc/procedures/evaluate.hh"
+#include "mapsc/procedures/inline.hh"
+#include "mapsc/procedures/simplify.hh"
+#include "mapsc/procedures/type_check.hh"
+#include "mapsc/transform_scheduler.hh"
 #include "mapsc/compilation_state.hh"
 
 namespace Maps {
@@ -17,39 +32,158 @@ using Log = LogInContext<LogContext::transform_stage>;
 bool run_transforms(CompilationState& state, Scope& scope, 
     std::span<DefinitionBody* const> definitions) {
 
-    for (auto definition: definitions) {
-        if (!run_transforms(state, scope, *definition))
-            return false;
-    }
+    if (definitions.size() == 1)
+        return run_transforms(state, scope, *definitions.front());
 
-    return true;
+    return schedule_transforms(state, scope, definitions, state.compiler_options_.thread_count);
 }
 
-// class Transformer {
-//     using Transforms = std::tuple<std::vector<
-    
-//     Transformer()
+namespace {
 
-//     bool visit_definition() {
+const void* body_identity(const DefinitionBody& definition) {
+    return std::visit(overloaded {
+        [](Expression* expression) -> const void* { return expression; },
+        [](Statement* statement) -> const void* { return statement; },
+        [](auto) -> const void* { return nullptr; }
+    }, definition.body());
+}
 
-//     }
+// the older procedures only report success, so changes are spotted by the body or the type
+// being swapped out
+PassResult run_definition_procedure(DefinitionBody& definition, auto procedure) {
+    auto body_index = definition.body().index();
+    auto body = body_identity(definition);
+    auto type = definition.get_type();
 
-//     bool visit_statement() {
+    if (!procedure())
+        return PassResult::failed;
 
-//     }
+    bool changed = definition.body().index() != body_index ||
+        body_identity(definition) != body || definition.get_type() != type;
 
-//     bool visit_expression() {
+    return changed ? PassResult::changed : PassResult::unchanged;
+}
 
-//     }
-// }
+PassResult from_bool(bool success) {
+    return success ? PassResult::unchanged : PassResult::failed;
+}
+
+} // anonymous namespace
+
+PassManager create_transform_pass_manager() {
+    PassManager pass_manager{};
+
+    // collapsing the body decides whether the definition is a value or a function, so this
+    // has to be done before concretize settles the type
+    pass_manager.add_pass({
+        .name = "simplify",
+        .statement_transform = [](CompilationState& state, Statement& statement) {
+            SimplifyCounts counts{};
+            if (!simplify_statement(*state.ast_store_, statement, counts))
+                return PassResult::unchanged;
+
+            Profiler::count(ProfilerCounter::statements_simplified, counts.total());
+            return PassResult::changed;
+        },
+        .definition_transform = [](CompilationState& state, DefinitionBody& definition) {
+            if (std::holds_alternative<Error>(definition.body()))
+                return PassResult::failed;
+
+            SimplifyCounts counts{};
+            if (!collapse_body(*state.ast_store_, definition, counts))
+                return PassResult::unchanged;
+
+            Profiler::count(ProfilerCounter::statements_simplified, counts.total());
+            return PassResult::changed;
+        }
+    });
+
+    // before concretize so that the inlined bodies get concretized along with the rest
+    pass_manager.add_pass({
+        .name = "inline",
+        .definition_transform = [](CompilationState& state, DefinitionBody& definition) {
+            return inline_calls(state, definition) > 0 ? PassResult::changed : PassResult::unchanged;
+        },
+        .fusable = false
+    });
+
+    pass_manager.add_pass({
+        .name = "concretize",
+        .definition_transform = [](CompilationState& state, DefinitionBody& definition) {
+            return run_definition_procedure(definition,
+                [&state, &definition]() { return concretize(state, definition); });
+        }
+    });
+
+    // The rest share a single walk that can't start before concretize is done with the whole
+    // definition, since they need the types it settles on, e.g. to tell which builtin a call
+    // is to
+    pass_manager.add_pass({
+        .name = "constant_fold",
+        .expression_transform = [](CompilationState& state, Expression& expression) {
+            return fold_constants(state, expression) ? PassResult::changed : PassResult::unchanged;
+        },
+        .statement_transform = [](CompilationState& state, Statement& statement) {
+            return fold_constants(state, statement) ? PassResult::changed : PassResult::unchanged;
+        },
+        .fusable = false
+    });
+
+    // after the walk, so that calls that fold away aren't given bindings
+    pass_manager.add_pass({
+        .name = "cse",
+        .definition_transform = [](CompilationState& state, DefinitionBody& definition) {
+            return eliminate_common_subexpressions(state, definition).bindings_created > 0 ?
+                PassResult::changed : PassResult::unchanged;
+        }
+    });
+
+    // if cse adds bindings the walk goes over the body again, so they get checked too
+    pass_manager.add_pass({
+        .name = "type_check",
+        .expression_transform = [](CompilationState&, Expression& expression) {
+            return from_bool(SimpleTypeChecker{}.visit_expression(&expression));
+        },
+        .statement_transform = [](CompilationState&, Statement& statement) {
+            return from_bool(SimpleTypeChecker{}.visit_statement(&statement));
+        },
+        .definition_transform = [](CompilationState&, DefinitionBody& definition) {
+            return from_bool(SimpleTypeChecker{}.visit_definition(&definition));
+        },
+        .enabled = false
+    });
+
+    return pass_manager;
+}
+
+PassManager create_transform_pass_manager(const CompilationState& state) {
+    auto pass_manager = create_transform_pass_manager();
+    pass_manager.apply_overrides(state.compiler_options_.pass_overrides);
+    return pass_manager;
+}
 
 bool run_transforms(CompilationState& state, Scope& scope, DefinitionBody& definition) {
+    auto pass_manager = create_transform_pass_manager(state);
+    bool success = run_transforms(state, scope, definition, pass_manager);
+    pass_manager.flush_stats();
+    return success;
+}
+
+bool run_transforms(CompilationState& state, Scope& scope, DefinitionBody& definition,
+    PassManager& pass_manager) {
+
     if (definition.is_deleted()) {
         Log::debug_extra(definition.location()) << 
             "Skipping transforms on deleted definition " << definition;
         return true;
     }
 
+    if (!definition.is_dirty()) {
+        Log::debug_extra(definition.location()) <<
+            "Skipping transforms on clean definition " << definition << Endl;
+        return true;
+    }
+
     if (!definition.is_top_level_definition()) {
         Log::compiler_error(definition.location()) <<
             "run_transforms called on not a top level definition";
@@ -59,55 +193,29 @@ bool run_transforms(CompilationState& state, Scope& scope, DefinitionBody& defin
 
     Log::debug_extra(definition.location()) << "Running transforms on definition " << definition << "..." << Endl;
 
-    // Log::debug_extra("Simplify " + definition.to_string() + "...", 
-    //     definition.location());
-    // if (!simplify(definition)) {
-    //     Log::error("Simplifying " + definition.to_string() + " failed", definition.location());
-    //     return false;
-    // }
-    // Log::debug_extra("Simplify ok", 
-    //     definition.location());
-
-    
-    // Log::debug_extra("Inlines & substitutions on " + definition.to_string() + "...", 
-    //     definition.location());
-    // if (!inline_and_substitute(definition)) {
-    //     Log::error("Inlines & substitutions on " + definition.to_string() + " failed", definition.location());
-    //     return false;
-    // }
-    // Log::debug_extra("Inlines & substitutions ok", 
-    //     definition.location());
-
-
-    Log::debug_extra(definition.location()) << "Concretize " << definition << "..." << Endl;
-    if (!concretize(state, definition)) {
-        Log::error(definition.location()) << "Concretizing " << definition << " failed" << Endl;
-        return false;
+    bool success;
+    {
+        ProfileScope profile{"transform passes", "transform"};
+        success = pass_manager.run(state, definition);
     }
-    Log::debug_extra(definition.location()) << "Concretize ok" << Endl;
-
-    
-    // Log::debug_extra("Type checking " + definition.to_string() + "...", 
-    //     definition.location());
-    // if (!type_check(definition)) {
-    //     Log::error("Type check on " + definition.to_string() + " failed", definition.location());
-    //     return false;
-    // }
-    // Log::debug_extra("Type check ok", 
-    //     definition.location());
 
+    if (!success)
+        return false;
+
+    definition.mark_clean();
+    Log::debug_extra(definition.location()) << "Transforms ok" << Endl;
     return true;
 }
 
 bool run_transforms(CompilationState& state, Scope& scope, 
     std::span<DefinitionHeader* const> definitions) {
 
+    std::vector<DefinitionBody*> bodies{};
     for (auto header: definitions)
-        if (header->body_)
-            if (!run_transforms(state, scope, **header->body_))
-                return false;
+        if (header->body_ && (*header->body_)->is_dirty())
+            bodies.push_back(*header->body_);
 
-    return true;
+    return run_transforms(state, scope, bodies);
 }
 
 } // namespace Maps
@@ -4,13 +4,22 @@
 #include <span>
 
 #include "mapsc/ast/scope.hh"
+#include "mapsc/pass_manager.hh"
 
 namespace Maps {
 
 class CompilationState;
 class DefinitionBody;
 
+// the transform passes in the order they run, with the default ones enabled
+PassManager create_transform_pass_manager();
+// with the pass overrides in state's options applied
+PassManager create_transform_pass_manager(const CompilationState& state);
+
 [[nodiscard]] bool run_transforms(CompilationState& state, Scope& scope, DefinitionBody& definition);
+// for running several definitions through the same passes, the caller flushes the stats
+[[nodiscard]] bool run_transforms(CompilationState& state, Scope& scope, DefinitionBody& definition,
+    PassManager& pass_manager);
 [[nodiscard]] bool run_transforms(CompilationState& state, Scope& scope, std::span<DefinitionBody* const> definitions);
 [[nodiscard]] bool run_transforms(CompilationState& state, Scope& scope, std::span<DefinitionHeader* const> definitions);
 
@@ -28,12 +28,48 @@ TypeStore::TypeStore(const std::span<const Type* const> builtin_simple_types,
     // }
 }
 
+TypeStore::Freeze::Freeze(TypeStore& store)
+:store_(store), was_frozen_(store.frozen_) {
+    store_.frozen_ = true;
+}
+
+TypeStore::Freeze::~Freeze() {
+    store_.frozen_ = was_frozen_;
+}
+
 bool TypeStore::empty() const {
+    std::lock_guard lock{mutex_};
     return types_.empty();
 }
 
 size_t TypeStore::size() const {
+    std::lock_guard lock{mutex_};
     return types_.size();
 }
 
+MemoryStats TypeStore::memory_stats() const {
+    std::lock_guard lock{mutex_};
+    MemoryStats stats{};
+
+    for (const auto& type: types_) {
+        if (auto function_type = dynamic_cast<const RTFunctionType*>(type.get())) {
+            stats.add("type:function", sizeof(RTFunctionType), 
+                heap_bytes(function_type->name_) + heap_bytes(function_type->param_types_));
+            continue;
+        }
+
+        if (auto rt_type = dynamic_cast<const RT_Type*>(type.get())) {
+            stats.add("type:simple", sizeof(RT_Type), heap_bytes(rt_type->name_));
+            continue;
+        }
+
+        stats.add("type:other", sizeof(Type));
+    }
+
+    stats.add_overhead(heap_bytes(types_) + heap_bytes(types_by_identifier_) + 
+        heap_bytes(types_by_structure_));
+
+    return stats;
+}
+
 } // namespace Maps
\ No newline at end of file
@@ -1,10 +1,12 @@
 #ifndef __TYPE_REGISTRY_HH
 #define __TYPE_REGISTRY_HH
 
+#include <cassert>
 #include <cstddef>
 #include <span>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <concepts>
 #include <vector>
 #include <string>
@@ -13,6 +15,7 @@
 
 #include <initializer_list>
 
+#include "mapsc/memory_stats.hh"
 #include "mapsc/types/type.hh"
 #include "mapsc/types/type_defs.hh"
 
@@ -22,8 +25,25 @@ class FunctionType;
 
 // class for holding the shared type information such as traits
 // See identifying_types text file for better description
+// Lookups and creating function types are safe to call from multiple threads
 class TypeStore {
 public:
+    // While frozen the store is read-only and lookups skip the lock so that many threads can 
+    // read it without contention
+    // Must be created and destroyed while no other thread is using the store
+    class Freeze {
+    public:
+        Freeze(TypeStore& store);
+        ~Freeze();
+
+        Freeze(const Freeze&) = delete;
+        Freeze& operator=(const Freeze&) = delete;
+
+    private:
+        TypeStore& store_;
+        bool was_frozen_;
+    };
+
     TypeStore(const std::span<const Type* const> builtin_simple_types = BUILTIN_TYPES,
         const std::span<const FunctionType* const> builtin_function_types = BUILTIN_FUNCTION_TYPES);
 
@@ -31,11 +51,19 @@ public:
     bool empty() const;
     // builtin types don't count
     size_t size() const;
+    // builtin types aren't counted here either, but their lookup table entries are
+    MemoryStats memory_stats() const;
 
     // TODO: move this to be private, callers should use get instead
     std::optional<const Type*> create_type(const std::string& name);
     
+    bool is_frozen() const { return frozen_; }
+
     std::optional<const Type*> get(const auto identifier) const {
+        std::unique_lock lock{mutex_, std::defer_lock};
+        if (!frozen_)
+            lock.lock();
+
         const auto it = types_by_identifier_.find(identifier);
         if (it == types_by_identifier_.end())
             return std::nullopt;
@@ -47,6 +75,8 @@ public:
         requires std::convertible_to<std::ranges::range_value_t<R>, const Type*>
     const FunctionType* get_function_type(const Type* return_type, R arg_types, bool is_pure) {
         std::string signature = make_function_signature(return_type, arg_types, is_pure);
+
+        std::lock_guard lock{mutex_};
         auto existing_it = types_by_structure_.find(signature);
 
         // if type with this structure exists, just return that
@@ -86,6 +116,8 @@ private:
     const FunctionType* create_function_type(const std::string& signature,
         const Type* return_type, R arg_types, bool is_pure = true) {
 
+        assert(!frozen_ && "tried to create a function type in a frozen TypeStore");
+
         std::unique_ptr<const Type> up = 
             make_unique<const RTFunctionType>(return_type, arg_types, is_pure);
         types_.push_back(std::move(up));
@@ -96,6 +128,9 @@ private:
         return dynamic_cast<const FunctionType*>(raw_ptr);
     }
 
+    mutable std::mutex mutex_;
+    bool frozen_ = false;
+
     std::map<std::string, const Type*, std::less<>> types_by_identifier_ = {};
     std::map<std::string, const Type*, std::less<>> types_by_structure_ = {};
 
@@ -0,0 +1,27 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "mapsc/log_sink.hh"
+
+// Converts a binary log written with --log-format=binary into text
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "USAGE: mapsc-logdecode LOGFILE" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream log_file{argv[1], std::ios::binary};
+    if (!log_file) {
+        std::cerr << "ERROR: couldn't open " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!Maps::decode_binary_log(log_file, std::cout)) {
+        std::cerr << "ERROR: " << argv[1] << " is not a valid binary log" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -27,7 +27,7 @@
 using std::unique_ptr, std::make_unique;
 
 // TODO: handle multiple inputfiles
-constexpr std::string_view USAGE = "USAGE: testc inputfile [-o filename] [-ir filename]";
+constexpr std::string_view USAGE = "USAGE: testc inputfile [-o filename] [-ir filename] [-O0|-O1|-O2|-O3|-Os] [-march=CPU|native] [-mcpu=CPU|native] [-mattr=+FEATURE,-FEATURE]";
 
 constexpr std::string_view DEFAULT_MODULE_NAME = "module";
 
@@ -46,6 +46,10 @@ struct CL_Options {
     bool ir_file = false;
     bool print_ir = false;
     std::string ir_file_path = static_cast<std::string>(DEFAULT_IR_FILE_PATH);
+
+    Maps::LLVM_IR::OptimizationLevel optimization_level = Maps::LLVM_IR::OptimizationLevel::O0;
+    // generic unless asked for, so that the object files run anywhere
+    Maps::LLVM_IR::CodegenTarget codegen_target{};
 };
 
 std::optional<CL_Options> parse_cl_args(int argc, char** argv) {
@@ -72,6 +76,28 @@ std::optional<CL_Options> parse_cl_args(int argc, char** argv) {
 
             continue;            
         }
+
+        if (arg.starts_with("-O")) {
+            auto level = Maps::LLVM_IR::parse_optimization_level(arg.substr(2));
+            if (!level) {
+                std::cerr << "Unknown optimization level " << arg << std::endl;
+                return std::nullopt;
+            }
+
+            options.optimization_level = *level;
+            continue;
+        }
+
+        if (arg.starts_with("-march=") || arg.starts_with("-mcpu=") || arg.starts_with("-mattr=")) {
+            auto separator = arg.find('=');
+            if (!Maps::LLVM_IR::apply_target_option(options.codegen_target, 
+                arg.substr(0, separator), arg.substr(separator + 1))) {
+
+                std::cerr << "Couldn't set the target from " << arg << std::endl;
+                return std::nullopt;
+            }
+            continue;
+        }
         
         // args without '-' are input files
         if (options.input_file_paths.size() >= 1) {
@@ -161,7 +187,8 @@ int main(int argc, char** argv) {
 
     if (cl_options->object_file) {
         std::cerr << "outputting object file to " << cl_options->object_file_path << std::endl;
-        generate_object_file(cl_options->object_file_path, *module_, std::cerr);
+        generate_object_file(cl_options->object_file_path, *module_, std::cerr, 
+            cl_options->optimization_level, cl_options->codegen_target);
     }
     
     std::cerr << "done" << std::endl;
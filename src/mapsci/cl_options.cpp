@@ -1,6 +1,10 @@
 #include "cl_options.hh"
 
+#include <algorithm>
+#include <charconv>
+
 #include "mapsc/logging.hh"
+#include "mapsc/transform_stage.hh"
 
 namespace Maps {
 
@@ -14,6 +18,12 @@ options:\n\
   --ir | --print-ir\n\
   --no-eval\n\
   --parsed | --print-parsed\n\
+  --enable-passes=PASS1,PASS2 | --disable-passes=PASS1,PASS2\n\
+  --inline-budget=N\n\
+  -O0 | -O1 | -O2 | -O3 | -Os\n\
+  -march=CPU|native | -mcpu=CPU|native | -mattr=+FEATURE,-FEATURE\n\
+  --object-cache[=DIR] | --object-cache-size=MB\n\
+  --lazy-jit | --jit-threads=N\n\
   -h | --help\n\
 ";
 
@@ -68,6 +78,8 @@ std::tuple<bool, int, REPL_Options> process_cl_options(int argc, char* argv[],
     std::vector<std::string> source_filenames{};
 
     REPL_Options repl_options;
+    // only used for checking pass names given on the command line
+    auto known_passes = create_transform_pass_manager();
 
     for (std::string arg: args) {
         // split the arg on '='
@@ -90,6 +102,23 @@ std::tuple<bool, int, REPL_Options> process_cl_options(int argc, char* argv[],
         } else if (key == "-e" || key == "--everything") {
             log_options.set_loglevel(LogLevel::debug_extra);
 
+        } else if (key == "--log-async") {
+            log_options.asynchronous = true;
+
+        } else if (key == "--log-format") {
+            if (value == "binary") {
+                log_options.format = LogFormat::binary;
+                log_options.asynchronous = true;
+            } else if (value == "text") {
+                log_options.format = LogFormat::text;
+            } else {
+                std::cout << "malformed --log-format argument, expected \"text\" or \"binary\"\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+
+        } else if (key == "--log-file") {
+            log_options.log_file_path = value;
+
         } else if (key == "--ir" || key == "--print-ir" || key == "--dump-ir") {
             repl_options.set_debug_print(REPL_Stage::ir);
             
@@ -192,6 +221,115 @@ std::tuple<bool, int, REPL_Options> process_cl_options(int argc, char* argv[],
         } else if (key == "--node-types") {
             repl_options.reverse_parse.debug_node_types = true;
 
+        } else if (key == "--threads") {
+            unsigned int thread_count = 0;
+            auto [_, error] = std::from_chars(value.data(), value.data() + value.size(), 
+                thread_count);
+
+            if (error != std::errc{} || thread_count == 0) {
+                std::cout << "malformed --threads argument, expected --threads=N with N > 0\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+            repl_options.compiler_options.thread_count = thread_count;
+
+        } else if (key == "--enable-passes" || key == "--disable-passes") {
+            bool enable = key == "--enable-passes";
+            std::stringstream passes{value};
+            std::string pass;
+
+            while (std::getline(passes, pass, ',')) {
+                bool known = std::any_of(known_passes.passes().begin(), known_passes.passes().end(),
+                    [&pass](const TransformPass& known_pass) { return known_pass.name == pass; });
+
+                if (!known) {
+                    std::cout << "unknown transform pass \"" << pass << "\" in " << key <<
+                        ", the passes are:";
+                    for (const auto& known_pass: known_passes.passes())
+                        std::cout << " " << known_pass.name;
+                    std::cout << "\n";
+                    return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+                }
+
+                repl_options.compiler_options.pass_overrides.push_back({pass, enable});
+            }
+
+        } else if (key == "--inline-budget") {
+            size_t inline_budget = 0;
+            auto [_, error] = std::from_chars(value.data(), value.data() + value.size(), 
+                inline_budget);
+
+            if (error != std::errc{} || value.empty()) {
+                std::cout << "malformed --inline-budget argument, expected --inline-budget=N\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+            repl_options.compiler_options.inline_budget = inline_budget;
+
+        } else if (key.starts_with("-O")) {
+            auto optimization_level = LLVM_IR::parse_optimization_level(key.substr(2));
+            if (!optimization_level) {
+                std::cout << "unknown optimization level " << key << 
+                    ", expected -O0, -O1, -O2, -O3 or -Os\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+            repl_options.optimization_level = *optimization_level;
+
+        } else if (key == "-march" || key == "-mcpu" || key == "-mattr") {
+            // the options adjust the host, same as not giving any
+            if (!repl_options.codegen_target)
+                repl_options.codegen_target = LLVM_IR::host_target();
+
+            if (!repl_options.codegen_target || 
+                !LLVM_IR::apply_target_option(*repl_options.codegen_target, key, value)) {
+                std::cout << "couldn't set the target from " << arg << "\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+
+        } else if (key == "--object-cache") {
+            if (value.empty()) {
+                repl_options.object_cache_directory = LLVM_IR::default_object_cache_directory();
+
+                if (!repl_options.object_cache_directory) {
+                    std::cout << "couldn't find a cache directory, use --object-cache=DIR\n";
+                    return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+                }
+            } else {
+                repl_options.object_cache_directory = value;
+            }
+
+        } else if (key == "--object-cache-size") {
+            uintmax_t megabytes = 0;
+            auto [_, error] = std::from_chars(value.data(), value.data() + value.size(), 
+                megabytes);
+
+            if (error != std::errc{} || value.empty()) {
+                std::cout << "malformed --object-cache-size argument, expected --object-cache-size=MB\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+            repl_options.object_cache_size = megabytes * 1024 * 1024;
+
+        } else if (key == "--lazy-jit") {
+            repl_options.lazy_jit = true;
+
+        } else if (key == "--jit-threads") {
+            unsigned threads = 0;
+            auto [_, error] = std::from_chars(value.data(), value.data() + value.size(), threads);
+
+            if (error != std::errc{} || value.empty()) {
+                std::cout << "malformed --jit-threads argument, expected --jit-threads=N\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+            repl_options.jit_compile_threads = threads;
+
+        } else if (key == "--time-report") {
+            repl_options.time_report = true;
+
+        } else if (key == "--time-trace") {
+            if (value.empty()) {
+                std::cout << "--time-trace requires a filename: --time-trace=FILE\n";
+                return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+            }
+            repl_options.time_trace_path = value;
+
         } else if (key == "--no-history") {
             repl_options.save_history = false;
 
@@ -213,6 +351,11 @@ std::tuple<bool, int, REPL_Options> process_cl_options(int argc, char* argv[],
         }
     }
 
+    if (log_options.format == LogFormat::binary && log_options.log_file_path.empty()) {
+        std::cout << "--log-format=binary requires --log-file\n";
+        return {SHOULD_EXIT, EXIT_FAILURE, repl_options};
+    }
+
     if (repl_options.save_history && repl_options.history_file_path.empty()) {
         auto history_file_path = get_default_history_file_path();
         if (!history_file_path) {
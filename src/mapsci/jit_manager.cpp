@@ -1,19 +1,137 @@
 #include "jit_manager.hh"
 
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/ExecutionEngine/Orc/Shared/ExecutorAddress.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "mapsc/profiler.hh"
+
 namespace Maps {
 
-JIT_Manager::JIT_Manager(llvm::orc::ThreadSafeContext* context, llvm::raw_ostream* error_stream)
-    : error_stream_(error_stream), context_(context) {
+namespace {
+
+template <typename JITBuilder>
+llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> create_jit(
+    llvm::orc::JITTargetMachineBuilder target_machine_builder, 
+    llvm::orc::LLJITBuilderState::CompileFunctionCreator compile_function_creator,
+    unsigned compile_threads) {
+
+    JITBuilder jit_builder{};
+    jit_builder.setJITTargetMachineBuilder(std::move(target_machine_builder));
+    jit_builder.setCompileFunctionCreator(std::move(compile_function_creator));
+    jit_builder.setNumCompileThreads(compile_threads);
+
+    auto jit = jit_builder.create();
+    if (!jit)
+        return jit.takeError();
+
+    // every function is its own partition, so only the ones that get called are compiled
+    if constexpr (std::is_same_v<JITBuilder, llvm::orc::LLLazyJITBuilder>)
+        (*jit)->setPartitionFunction(llvm::orc::CompileOnDemandLayer::compileRequested);
+
+    return std::move(*jit);
+}
+
+} // namespace
+
+// The same as the default compile function, except that it borrows a target machine from the 
+// pool instead of owning one, or creating one for every module when there are compile threads,
+// and goes through the object cache if there is one
+class JIT_Manager::PooledCompiler: public llvm::orc::IRCompileLayer::IRCompiler {
+public:
+    PooledCompiler(JIT_Manager& jit_manager, llvm::orc::IRSymbolMapper::ManglingOptions options)
+    :IRCompiler(std::move(options)), jit_manager_(jit_manager) {}
+
+    llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module& module_) override {
+        auto target_machine = jit_manager_.acquire_target_machine();
+        if (!target_machine)
+            return llvm::createStringError(llvm::inconvertibleErrorCode(), 
+                "creating a target machine failed");
+
+        auto object = llvm::orc::SimpleCompiler{*target_machine, 
+            jit_manager_.object_cache_.get()}(module_);
+
+        jit_manager_.release_target_machine(std::move(target_machine));
+        return object;
+    }
+
+private:
+    JIT_Manager& jit_manager_;
+};
+
+JIT_Manager::JIT_Manager(llvm::orc::ThreadSafeContext* context, llvm::raw_ostream* error_stream,
+    const Options& options)
+    : error_stream_(error_stream), context_(context), lazy_(options.lazy), 
+      compile_threads_(options.compile_threads) {
+
+    auto optimization_level = options.optimization_level;
+
+    auto target_machine_builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+
+    if (!target_machine_builder) {
+        *error_stream_ << target_machine_builder.takeError() << '\n';
+        is_good = false;
+        return;
+    }
+
+    if (options.codegen_target) {
+        target_machine_builder->setCPU(options.codegen_target->cpu);
+        target_machine_builder->getFeatures() = 
+            llvm::SubtargetFeatures{options.codegen_target->features};
+    }
+
+    codegen_target_ = {target_machine_builder->getCPU(), 
+        target_machine_builder->getFeatures().getString()};
+
+    auto target_machine = target_machine_builder->createTargetMachine();
+
+    if (!target_machine) {
+        *error_stream_ << target_machine.takeError() << '\n';
+        is_good = false;
+        return;
+    }
+
+    target_machine_builder_ = *target_machine_builder;
+    auto mangling_options = llvm::orc::irManglingOptionsFromTargetOptions(
+        (*target_machine)->Options);
+    idle_target_machines_.push_back(std::move(*target_machine));
+
+    if (options.object_cache_directory) {
+        object_cache_ = std::make_unique<LLVM_IR::DiskObjectCache>(
+            *options.object_cache_directory, options.object_cache_size, 
+            LLVM_IR::object_cache_salt(target_machine_builder->getTargetTriple().str(), 
+                codegen_target_.cpu, codegen_target_.features, 
+                LLVM_IR::optimization_level_name(optimization_level)));
+
+        // carry on without it
+        if (!object_cache_->is_good)
+            object_cache_.reset();
+    }
 
-    auto jit = llvm::orc::LLJITBuilder().create();
+    auto compile_function_creator = [this, mangling_options](llvm::orc::JITTargetMachineBuilder)
+        -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+        
+        return std::make_unique<PooledCompiler>(*this, mangling_options);
+    };
+
+    auto jit = lazy_ ?
+        create_jit<llvm::orc::LLLazyJITBuilder>(std::move(*target_machine_builder), 
+            compile_function_creator, compile_threads_) :
+        create_jit<llvm::orc::LLJITBuilder>(std::move(*target_machine_builder), 
+            compile_function_creator, compile_threads_);
 
     if (!jit) {
         *error_stream_ << jit.takeError() << '\n';
@@ -22,19 +140,95 @@ JIT_Manager::JIT_Manager(llvm::orc::ThreadSafeContext* context, llvm::raw_ostrea
     }
 
     jit_ = std::move(*jit);
+
+    // runs on every module added with addIRModule before it gets compiled, or in lazy mode on 
+    // every function when it's first called
+    jit_->getIRTransformLayer().setTransform(
+        [this, optimization_level](llvm::orc::ThreadSafeModule module, 
+            llvm::orc::MaterializationResponsibility&) -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+
+            module.withModuleDo([this, optimization_level](llvm::Module& module_) {
+                LLVM_IR::record_target(module_, codegen_target_);
+
+                if (optimization_level == LLVM_IR::OptimizationLevel::O0)
+                    return;
+
+                auto target_machine = acquire_target_machine();
+                LLVM_IR::optimize_module(module_, optimization_level, target_machine.get());
+                release_target_machine(std::move(target_machine));
+            });
+            return std::move(module);
+        });
 }
 
-// llvm::orc::ResourceTracker* compile_and_run_with_rt(llvm::Module& module) {
-//     auto resource_tracker = jit_->getMainJITDylib().createResourceTracker();
-// }
-    
 bool JIT_Manager::compile_and_run(std::unique_ptr<llvm::Module> module, const std::string& entry_point) {
-    if (auto err = jit_->addIRModule(llvm::orc::ThreadSafeModule{std::move(module), *context_})) {
-        *error_stream_ << err << '\n';
-        error_stream_->flush();
+    if (!add_module(llvm::orc::ThreadSafeModule{std::move(module), *context_}, 
+            jit_->getMainJITDylib().getDefaultResourceTracker()))
         return false;
+
+    return run(entry_point);
+}
+
+bool JIT_Manager::add_definition(const std::string& name, llvm::orc::ThreadSafeModule module) {
+    remove_definition(name);
+
+    std::vector<std::string> symbols{};
+    module.withModuleDo([&symbols](const llvm::Module& module_) {
+        for (const llvm::Function& function: module_) {
+            if (!function.isDeclaration() && !function.hasLocalLinkage())
+                symbols.push_back(function.getName().str());
+        }
+    });
+
+    auto tracker = jit_->getMainJITDylib().createResourceTracker();
+    if (!add_module(std::move(module), tracker))
+        return false;
+
+    // in lazy mode looking things up would defeat the point
+    if (compile_threads_ > 0 && !lazy_)
+        start_materializing(symbols);
+
+    definitions_.insert_or_assign(name, Definition{std::move(tracker), std::move(symbols)});
+    return true;
+}
+
+bool JIT_Manager::add_definition(const std::string& name, std::unique_ptr<llvm::Module> module) {
+    return add_definition(name, llvm::orc::ThreadSafeModule{std::move(module), *context_});
+}
+
+bool JIT_Manager::remove_definition(const std::string& name) {
+    auto it = definitions_.find(name);
+    if (it == definitions_.end())
+        return false;
+
+    auto [tracker, symbols] = std::move(it->second);
+    definitions_.erase(it);
+
+    if (auto error = tracker->remove()) {
+        *error_stream_ << error << '\n';
+        error_stream_->flush();
     }
 
+    auto implementation = implementation_dylib();
+    if (!implementation)
+        return true;
+
+    // the stubs went with the tracker, but the bodies stay in the implementation dylib
+    // the memory for the ones that got compiled isn't freed
+    // one at a time, since remove doesn't remove anything if one of them is missing
+    for (const std::string& symbol: symbols)
+        llvm::consumeError(implementation->remove({jit_->mangleAndIntern(symbol)}));
+
+    return true;
+}
+
+bool JIT_Manager::has_definition(const std::string& name) const {
+    return definitions_.contains(name);
+}
+
+bool JIT_Manager::run(const std::string& entry_point) {
+    std::optional<ProfileScope> materialization_profile{std::in_place, "jit materialization", "llvm"};
+
     auto f1_sym = jit_->lookup(entry_point);
     if (!f1_sym) {
         *error_stream_ << f1_sym.takeError() << '\n';
@@ -42,20 +236,124 @@ bool JIT_Manager::compile_and_run(std::unique_ptr<llvm::Module> module, const st
         return false;
     }
 
+    materialization_profile.reset();
+
     // execute the compiled function
     auto *f1_ptr = f1_sym->toPtr<void(*)()>();
+
+    ProfileScope run_profile{"run", "jit"};
     f1_ptr();
 
     return true;
 }
 
+llvm::orc::ThreadSafeContext JIT_Manager::module_context() const {
+    if (compile_threads_ == 0)
+        return *context_;
+
+    return llvm::orc::ThreadSafeContext{std::make_unique<llvm::LLVMContext>()};
+}
+
+bool JIT_Manager::add_module(llvm::orc::ThreadSafeModule module, 
+    llvm::orc::ResourceTrackerSP tracker) {
+
+    llvm::Error error = llvm::Error::success();
+
+    if (lazy_) {
+        // what addLazyIRModule does, except that it can't take a tracker
+        module.withModuleDo([this](llvm::Module& module_) {
+            if (module_.getDataLayout().isDefault())
+                module_.setDataLayout(jit_->getDataLayout());
+        });
+
+        error = static_cast<llvm::orc::LLLazyJIT&>(*jit_).getCompileOnDemandLayer().add(
+            std::move(tracker), std::move(module));
+    } else {
+        error = jit_->addIRModule(std::move(tracker), std::move(module));
+    }
+
+    if (error) {
+        *error_stream_ << error << '\n';
+        error_stream_->flush();
+        return false;
+    }
+
+    return true;
+}
+
+void JIT_Manager::start_materializing(const std::vector<std::string>& symbols) {
+    llvm::orc::SymbolLookupSet lookup_set{};
+    for (const std::string& symbol: symbols)
+        lookup_set.add(jit_->mangleAndIntern(symbol));
+
+    jit_->getExecutionSession().lookup(llvm::orc::LookupKind::Static, 
+        llvm::orc::makeJITDylibSearchOrder(&jit_->getMainJITDylib()), std::move(lookup_set),
+        llvm::orc::SymbolState::Ready,
+        [](llvm::Expected<llvm::orc::SymbolMap> result) {
+            // if it failed, the lookup in run fails the same way and reports it
+            if (!result)
+                llvm::consumeError(result.takeError());
+        },
+        llvm::orc::NoDependenciesToRegister);
+}
+
+std::unique_ptr<llvm::TargetMachine> JIT_Manager::acquire_target_machine() {
+    {
+        std::lock_guard lock{target_machines_mutex_};
+        if (!idle_target_machines_.empty()) {
+            auto target_machine = std::move(idle_target_machines_.back());
+            idle_target_machines_.pop_back();
+            return target_machine;
+        }
+    }
+
+    // the optimization passes can do without one if this fails
+    auto target_machine = target_machine_builder_->createTargetMachine();
+    if (!target_machine) {
+        llvm::consumeError(target_machine.takeError());
+        return nullptr;
+    }
+
+    return std::move(*target_machine);
+}
+
+void JIT_Manager::release_target_machine(std::unique_ptr<llvm::TargetMachine> target_machine) {
+    if (!target_machine)
+        return;
+
+    std::lock_guard lock{target_machines_mutex_};
+    idle_target_machines_.push_back(std::move(target_machine));
+}
+
+llvm::orc::JITDylib* JIT_Manager::implementation_dylib() {
+    if (!lazy_)
+        return nullptr;
+
+    // the compile on demand layer keeps the actual function bodies in a separate dylib, and 
+    // only puts stubs in the main one
+    return jit_->getExecutionSession().getJITDylibByName(
+        jit_->getMainJITDylib().getName() + ".impl");
+}
+
 // resets everything in the jitDYlib
 void JIT_Manager::reset() {
+    // clearing the dylib takes the trackers with it
+    definitions_.clear();
+
     auto error = jit_->getMainJITDylib().clear();
     if (error) {
         *error_stream_ << error;
         error_stream_->flush();
     }
+
+    auto implementation = implementation_dylib();
+    if (!implementation)
+        return;
+
+    if (auto error = implementation->clear()) {
+        *error_stream_ << error;
+        error_stream_->flush();
+    }
 }
     
 } // namespace Maps
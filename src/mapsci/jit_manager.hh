@@ -1,9 +1,24 @@
 #ifndef __JIT_MANAGER_HH
 #define __JIT_MANAGER_HH
 
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "mapsc/llvm_ir_gen/object_cache.hh"
+#include "mapsc/llvm_ir_gen/optimization.hh"
+#include "mapsc/llvm_ir_gen/target.hh"
 
 namespace llvm {
 
@@ -20,22 +35,93 @@ namespace Maps {
 
 class JIT_Manager {
 public:
-    JIT_Manager(llvm::orc::ThreadSafeContext* context, llvm::raw_ostream* error_stream);
+    struct Options {
+        // modules get optimized at this level as they are added
+        LLVM_IR::OptimizationLevel optimization_level = LLVM_IR::OptimizationLevel::O0;
+        // code is generated for the host unless a target is given
+        std::optional<LLVM_IR::CodegenTarget> codegen_target = std::nullopt;
+        // if set, compiled objects are stored here and reused
+        std::optional<std::filesystem::path> object_cache_directory = std::nullopt;
+        uintmax_t object_cache_size = LLVM_IR::DEFAULT_OBJECT_CACHE_SIZE;
+        // if true, functions only get compiled when they're first called
+        // the optimization passes then only see one function at a time
+        bool lazy = false;
+        // if not 0, code is generated on this many threads in the background, starting as soon 
+        // as a definition is added
+        unsigned compile_threads = 0;
+    };
+
+    JIT_Manager(llvm::orc::ThreadSafeContext* context, llvm::raw_ostream* error_stream,
+        const Options& options);
 
-    // llvm::orc::ResourceTracker* compile_and_run_with_rt(llvm::Module& module) {
-    //     auto resource_tracker = jit_->getMainJITDylib().createResourceTracker();
-    // }
+    // delegating contructor to make options optional
+    JIT_Manager(llvm::orc::ThreadSafeContext* context, llvm::raw_ostream* error_stream)
+    :JIT_Manager(context, error_stream, Options{}) {}
 
     bool compile_and_run(std::unique_ptr<llvm::Module> module, const std::string& entry_point);
 
+    // Adds the module with a resource tracker of its own, replacing whatever was added under 
+    // the same name before. Nothing gets compiled until something in it is looked up
+    // Anything that called into the replaced module has to be replaced as well, the addresses
+    // get resolved when the caller is compiled
+    // With compile threads the module starts compiling right away, so run only has to wait
+    // for whatever is still in progress
+    bool add_definition(const std::string& name, llvm::orc::ThreadSafeModule module);
+    // the module has to be in the shared context
+    bool add_definition(const std::string& name, std::unique_ptr<llvm::Module> module);
+    // returns false if there was nothing under the name
+    bool remove_definition(const std::string& name);
+    bool has_definition(const std::string& name) const;
+
+    // looks up the entry point, compiling what it needs, and calls it
+    bool run(const std::string& entry_point);
+
+    // The context to generate the next module in. With compile threads every module gets one 
+    // of its own, since modules sharing a context can't be compiled at the same time
+    llvm::orc::ThreadSafeContext module_context() const;
+
     // resets everything in the jitDYlib
     void reset();
 
     bool is_good = true;
 private:
+    class PooledCompiler;
+
+    struct Definition {
+        llvm::orc::ResourceTrackerSP tracker;
+        // the external symbols the module defines
+        // in lazy mode the bodies live in the implementation dylib, which the tracker 
+        // doesn't cover, so they have to be removed by name
+        std::vector<std::string> symbols;
+    };
+
+    bool add_module(llvm::orc::ThreadSafeModule module, llvm::orc::ResourceTrackerSP tracker);
+    // looks the symbols up without waiting for the result, which gets them compiled on the
+    // compile threads
+    void start_materializing(const std::vector<std::string>& symbols);
+
+    // codegen and the optimization passes can run on several threads at once, and target 
+    // machines can't be shared between threads
+    std::unique_ptr<llvm::TargetMachine> acquire_target_machine();
+    void release_target_machine(std::unique_ptr<llvm::TargetMachine> target_machine);
+    // the dylib the compile on demand layer puts the function bodies in, if there is one yet
+    llvm::orc::JITDylib* implementation_dylib();
+
     llvm::raw_ostream* error_stream_;
     llvm::orc::ThreadSafeContext* context_;
+    bool lazy_;
+    unsigned compile_threads_;
+
+    // everything up to the jit has to outlive it, the compile threads use them
+    LLVM_IR::CodegenTarget codegen_target_;
+    std::optional<llvm::orc::JITTargetMachineBuilder> target_machine_builder_;
+    // borrowed by codegen and the optimization passes, more get created as needed
+    std::mutex target_machines_mutex_;
+    std::vector<std::unique_ptr<llvm::TargetMachine>> idle_target_machines_;
+    std::unique_ptr<LLVM_IR::DiskObjectCache> object_cache_;
+
     std::unique_ptr<llvm::orc::LLJIT> jit_;
+    std::unordered_map<std::string, Definition> definitions_{};
 };
 
 } // namespace Maps
@@ -6,6 +6,9 @@
 
 #include "mapsc/compilation_state.hh"
 #include "mapsc/procedures/reverse_parse.hh"
+#include "mapsc/llvm_ir_gen/object_cache.hh"
+#include "mapsc/llvm_ir_gen/optimization.hh"
+#include "mapsc/llvm_ir_gen/target.hh"
 
 namespace llvm { class LLVMContext; class raw_ostream; }
 
@@ -42,8 +45,24 @@ struct REPL_Options {
     bool save_history = true;
     std::filesystem::path history_file_path;
 
+    // print the profiler report on exit
+    bool time_report = false;
+    // if not empty, write a chrome trace-event file here on exit
+    std::string time_trace_path = "";
+
     Maps::CompilationState::Options compiler_options{};
     Maps::ReverseParser::Options reverse_parse{};
+    // passed on to the JIT
+    LLVM_IR::OptimizationLevel optimization_level = LLVM_IR::OptimizationLevel::O0;
+    // the host if not set
+    std::optional<LLVM_IR::CodegenTarget> codegen_target = std::nullopt;
+    // compiled objects are cached here across runs if set
+    std::optional<std::filesystem::path> object_cache_directory = std::nullopt;
+    uintmax_t object_cache_size = LLVM_IR::DEFAULT_OBJECT_CACHE_SIZE;
+    // only compile functions when they're first called
+    bool lazy_jit = false;
+    // compile definitions in the background on this many threads, 0 for none
+    unsigned jit_compile_threads = 0;
 
     std::string module_name = std::string{REPL_DEFAULT_MODULE_NAME};
     std::string prompt = std::string{REPL_DEFAULT_PROMPT};
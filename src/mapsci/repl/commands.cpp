@@ -81,6 +81,11 @@ void REPL::run_command(Maps::CompilationState& state, const std::string& input)
         return;
     }
 
+    if (command == ":memstats") {
+        state.memory_stats().write_report(std::cout);
+        return;
+    }
+
     if (command == ":t") {
         std::cout << eval_type(input_stream) << std::endl;
         return;
@@ -6,11 +6,14 @@
 #include <optional>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <unordered_set>
 
 #include "readline.h"
 
 #include "mapsc/builtins.hh"
 #include "mapsc/compilation_state.hh"
+#include "mapsc/profiler.hh"
 #include "mapsc/transform_stage.hh"
 
 #include "mapsc/types/type.hh"
@@ -25,7 +28,6 @@
 
 #include "mapsc/procedures/name_resolution.hh"
 #include "mapsc/procedures/cleanup.hh"
-#include "mapsc/procedures/concretize.hh"
 
 #include "mapsc/llvm_ir_gen/ir_generator.hh"
 #include "mapsc/llvm_ir_gen/ir_builtins.hh"
@@ -113,9 +115,12 @@ optional<DefinitionBody*> REPL::create_repl_wrapper(CompilationState& state, Sco
     return body;
 }
 
-bool REPL::compile_and_run(std::unique_ptr<llvm::Module> module_, const std::string& entry_point) {
-    jit_->reset();
-    jit_->compile_and_run(std::move(module_), entry_point);
+bool REPL::compile_and_run(llvm::orc::ThreadSafeModule module_, const std::string& entry_point) {
+    // whatever is already in the jit from earlier inputs stays there
+    if (!jit_->add_definition(entry_point, std::move(module_)))
+        return false;
+
+    jit_->run(entry_point);
     std::cout << std::endl;
     return true;
 }
@@ -140,8 +145,24 @@ std::string REPL::eval_type(std::istream& input_stream) {
 bool REPL::run_compilation_pipeline(CompilationState& state, 
     Scope& global_scope, std::istream& source) {
 
+    // the scope is reset before each debug print so that the printing isn't timed
+    std::optional<ProfileScope> stage_profile{};
+    std::string_view stage_name{};
+
+    auto start_stage = [&](std::string_view name) {
+        stage_name = name;
+        stage_profile.emplace(name);
+    };
+
+    auto end_stage = [&]() {
+        stage_profile.reset();
+        if (Profiler::global.is_enabled())
+            Profiler::global.sample_memory(stage_name, state.memory_stats());
+    };
+
     // ---------------------------------- LAYER1 ----------------------------------------
 
+    start_stage("layer1");
     auto [ 
         layer1_success,
         top_level_definition,
@@ -154,6 +175,7 @@ bool REPL::run_compilation_pipeline(CompilationState& state,
     if (!layer1_success && !options_.ignore_errors)
         return false;
 
+    end_stage();
     debug_print(REPL_Stage::layer1, global_scope, (*top_level_definition)->header_);
 
     if (options_.stop_after == REPL_Stage::layer1)
@@ -162,27 +184,33 @@ bool REPL::run_compilation_pipeline(CompilationState& state,
 
     // ------------------------------ NAME RESOLUTION -----------------------------------
 
+    start_stage("type name resolution");
     if (!resolve_identifiers(state, global_scope, unresolved_type_identifiers) && 
             !options_.ignore_errors)
         return false;
 
+    end_stage();
     debug_print(REPL_Stage::type_name_resolution, global_scope, (*top_level_definition)->header_);
 
     // if (!la(possible_binding_type_declarations) && !options_.ignore_errors)
     //     return false;
 
+    start_stage("name resolution");
     if (!resolve_identifiers(state, global_scope, unresolved_identifiers) && 
             !options_.ignore_errors)
         return false;
 
+    end_stage();
     debug_print(REPL_Stage::name_resolution, global_scope, (*top_level_definition)->header_);
 
 
     // ----------------------------------- LAYER2 ----------------------------------------
 
+    start_stage("layer2");
     if (!run_layer2(state, unparsed_termed_expressions) && !options_.ignore_errors)
         return false;
 
+    end_stage();
     debug_print(REPL_Stage::layer2, global_scope, (*top_level_definition)->header_);
 
     if (options_.stop_after == REPL_Stage::layer2)
@@ -191,11 +219,15 @@ bool REPL::run_compilation_pipeline(CompilationState& state,
 
     // --------------------------------- TRANSFORM STAGE --------------------------------------
 
+    start_stage("transform stage");
     if (!run_transforms(state, global_scope, top_level_definition) && !options_.ignore_errors) {
         std::cout << "Transform stage failed" << std::endl;
         return false;
     }
 
+    // the walks are done, so the nodes the passes replaced can go
+    state.ast_store_->free_deleted();
+    end_stage();
     debug_print(REPL_Stage::transform_stage, global_scope, (*top_level_definition)->header_);
 
 
@@ -203,9 +235,15 @@ bool REPL::run_compilation_pipeline(CompilationState& state,
 
     if (!top_level_definition || ((*top_level_definition)->get_type()->is_pure() && (*top_level_definition)->get_type()->is_voidish())) {
         std::cout << "Top level definition doesn't produce a value or doesn't exist" << std::endl;
+
+        // with compile threads the definitions get compiled while the next input is typed
+        if (options_.eval && options_.stop_after == REPL_Stage::done)
+            return generate_definitions(state, global_scope, true) || options_.ignore_errors;
+
         return true;
     }
 
+    start_stage("pre ir");
     auto repl_wrapper = create_repl_wrapper(state, global_scope, *top_level_definition);
 
     if (!repl_wrapper) {
@@ -223,6 +261,7 @@ bool REPL::run_compilation_pipeline(CompilationState& state,
             return false;
     }
 
+    end_stage();
     debug_print(REPL_Stage::pre_ir, global_scope, 
         std::array<const DefinitionHeader*, 2>{(*top_level_definition)->header_, (*repl_wrapper)->header_});
 
@@ -232,32 +271,151 @@ bool REPL::run_compilation_pipeline(CompilationState& state,
 
     // ------------------------------------ IR GEN ---------------------------------------
 
-    unique_ptr<llvm::Module> module_ = make_unique<llvm::Module>(options_.module_name, *context_);
-    LLVM_IR::IR_Generator generator{context_, module_.get(), &state, error_stream_};
+    start_stage("ir");
 
-    if (!LLVM_IR::insert_builtins(generator)) {
-        std::cout << "Inserting IR builtins failed\n";
-        return false;
-    }
+    bool run_input = options_.eval && options_.stop_after != REPL_Stage::ir;
+    bool ir_success = generate_definitions(state, global_scope, run_input);
 
-    bool ir_success = generator.run(global_scope, 
-        std::array{(*top_level_definition)->header_, (*repl_wrapper)->header_});
+    // the top level definition is only called by the wrapper, so it goes into the same module
+    // that gets replaced on every input
+    llvm::orc::ThreadSafeModule wrapper_module{};
+    if (ir_success) {
+        wrapper_module = run_ir_gen(state, global_scope, options_.repl_wrapper_name,
+            std::array{(*top_level_definition)->header_, (*repl_wrapper)->header_});
+        ir_success = static_cast<bool>(wrapper_module);
+    }
 
-    debug_print(REPL_Stage::ir, *module_);
+    end_stage();
+    if (wrapper_module)
+        wrapper_module.withModuleDo([this](const llvm::Module& module_) {
+            debug_print(REPL_Stage::ir, module_);
+        });
 
     if (!ir_success && !options_.ignore_errors) {
         std::cout << "IR gen failed\n";
         return false;
     }
 
-    if (options_.stop_after == REPL_Stage::ir || !options_.eval)
+    if (!run_input || !wrapper_module)
         return true;
 
 
     // -------------------------------- COMPILE AND RUN ---------------------------------
 
     std::cout << '\n';
-    return compile_and_run(std::move(module_), options_.repl_wrapper_name);
+    return compile_and_run(std::move(wrapper_module), options_.repl_wrapper_name);
+}
+
+bool REPL::generate_definitions(CompilationState& state, const Scope& global_scope, 
+    bool add_to_jit) {
+
+    // every global definition has a module of its own, so only the new ones and the ones
+    // that had to go through the transforms again need to be generated
+    std::vector<DefinitionHeader*> changed = dependencies_.dirty_definitions(global_scope);
+    std::unordered_set<const DefinitionHeader*> queued{changed.begin(), changed.end()};
+
+    // inputs that didn't make it to ir gen left theirs out
+    for (DefinitionHeader* definition: global_scope) {
+        if (!queued.contains(definition) && !jit_->has_definition(definition->name_string()))
+            changed.push_back(definition);
+    }
+
+    for (DefinitionHeader* definition: changed) {
+        auto module = run_ir_gen(state, global_scope, definition->name_string(), 
+            std::array{definition});
+
+        if (!module)
+            return false;
+
+        module.withModuleDo([this](const llvm::Module& module_) {
+            debug_print(REPL_Stage::ir, module_);
+        });
+
+        // with compile threads it starts compiling while the rest are generated
+        if (add_to_jit && !jit_->add_definition(definition->name_string(), std::move(module)))
+            return false;
+    }
+
+    return true;
+}
+
+llvm::orc::ThreadSafeModule REPL::run_ir_gen(CompilationState& state, 
+    const Scope& global_scope, const std::string& entry_point, 
+    std::span<DefinitionHeader* const> definitions) {
+
+    llvm::orc::ThreadSafeContext module_context = jit_->module_context();
+    llvm::LLVMContext* context = module_context.getContext();
+
+    // the builtins can only be copied within a context, so modules in the shared one get 
+    // copies that can be inlined, and modules in contexts of their own call the ones in the jit
+    const llvm::Module* builtins = nullptr;
+
+    if (context == context_) {
+        if (!builtins_)
+            builtins_ = LLVM_IR::load_builtins(*context_, state);
+        builtins = builtins_.get();
+
+        if (!builtins) {
+            std::cout << "Loading IR builtins failed\n";
+            return {};
+        }
+    } else if (!add_builtins_to_jit(state)) {
+        std::cout << "Adding IR builtins to the jit failed\n";
+        return {};
+    }
+
+    auto module_ = make_unique<llvm::Module>(options_.module_name + "." + entry_point, *context);
+    LLVM_IR::IR_Generator generator{context, module_.get(), &state, error_stream_, 
+        {.entry_point = entry_point}};
+
+    if (!LLVM_IR::declare_builtins(generator)) {
+        std::cout << "Inserting IR builtins failed\n";
+        return {};
+    }
+
+    for (DefinitionHeader* definition: definitions) {
+        if (!definition->body_)
+            continue;
+
+        for (const DefinitionHeader* reference: collect_references(**definition->body_)) {
+            // builtins and locals aren't in the global scope
+            auto global = global_scope.get_identifier(reference->name_string());
+            if (!global || *global != reference)
+                continue;
+
+            if (module_->getFunction(reference->name_string()) ||
+                std::find(definitions.begin(), definitions.end(), reference) != definitions.end())
+                continue;
+
+            if (!generator.declare_global_definition(*reference))
+                return {};
+        }
+    }
+
+    if (!generator.run(definitions))
+        return {};
+
+    if (builtins && !LLVM_IR::link_builtins(generator, *builtins)) {
+        std::cout << "Linking IR builtins failed\n";
+        return {};
+    }
+
+    return llvm::orc::ThreadSafeModule{std::move(module_), std::move(module_context)};
+}
+
+bool REPL::add_builtins_to_jit(const CompilationState& state) {
+    if (jit_->has_definition(BUILTINS_DEFINITION_NAME))
+        return true;
+
+    llvm::orc::ThreadSafeContext builtins_context{std::make_unique<llvm::LLVMContext>()};
+    auto builtins = LLVM_IR::load_builtins(*builtins_context.getContext(), state);
+    if (!builtins)
+        return false;
+
+    // the bitcode keeps the builtins external, so the declarations in other modules resolve to 
+    // this one
+    return jit_->add_definition(BUILTINS_DEFINITION_NAME, 
+        llvm::orc::ThreadSafeModule{std::move(builtins), std::move(builtins_context)});
 }
 
 
@@ -272,22 +430,15 @@ bool REPL::run_layer2(CompilationState& state, std::vector<Expression*> unparsed
 bool REPL::run_transforms(CompilationState& state, 
     Scope& scope, optional<DefinitionBody* const> top_level_definition) {
 
-    for (auto definition: scope) {
-        if (*definition->body_)
-            if (!Maps::concretize(state, **definition->body_))
-                return false;
-    }
-
-    if (!Maps::run_transforms(state, scope, scope.identifiers_in_order_))
+    // definitions from earlier inputs are left alone unless something they use has changed
+    if (!Maps::run_transforms(state, scope, dependencies_.dirty_definitions(scope)))
         return false;
         
     if (!top_level_definition)
         return true;
 
-    if (!Maps::concretize(state, **top_level_definition))
-        return false;
-
-    return true;
+    // the top level definition isn't in the scope, so it goes through the transforms separately
+    return Maps::run_transforms(state, scope, **top_level_definition);
 }
 
 bool REPL::insert_global_cleanup(Maps::CompilationState& state, 
@@ -10,8 +10,13 @@
 #include <istream>
 #include <array>
 #include <utility>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Module.h"
 
 #include "mapsc/compilation_state.hh"
+#include "mapsc/dependency_tracker.hh"
 #include "mapsc/ast/scope.hh"
 
 #include "mapsci/jit_manager.hh"
@@ -72,7 +77,7 @@ private:
 
     std::optional<DefinitionBody*> create_repl_wrapper(CompilationState& state, Scope& global_scope,
         DefinitionBody* top_level_definition);
-    bool compile_and_run(std::unique_ptr<llvm::Module> module_, const std::string& entry_point);
+    bool compile_and_run(llvm::orc::ThreadSafeModule module_, const std::string& entry_point);
     
     bool run_compilation_pipeline(CompilationState& state, Scope& global_scope, 
         std::istream& istream);
@@ -89,17 +94,36 @@ private:
     bool insert_global_cleanup(CompilationState& state, 
         Scope& scope, DefinitionBody& entry_point);
 
-    std::unique_ptr<llvm::Module> run_ir_gen(CompilationState& state, 
-        DefinitionHeader* definition);
+    // Generates a module with the given definitions, where only the entry point is visible 
+    // outside. The global definitions they reference are declared, since they live in modules 
+    // of their own. Returns an empty module if it failed
+    llvm::orc::ThreadSafeModule run_ir_gen(CompilationState& state, const Scope& global_scope,
+        const std::string& entry_point, std::span<DefinitionHeader* const> definitions);
+    // Adds the builtin definitions to the jit as a module of their own, unless they're there 
+    // already. Modules outside the shared context only declare them, since copying them in 
+    // would mean parsing the bitcode again for every context
+    bool add_builtins_to_jit(const CompilationState& state);
+    // generates the global definitions that are new or changed, and adds them to the jit if 
+    // add_to_jit is set
+    bool generate_definitions(CompilationState& state, const Scope& global_scope, 
+        bool add_to_jit);
+
+    // the name the builtins module is added to the jit under, not a valid identifier so it 
+    // can't clash with a definition
+    static constexpr char BUILTINS_DEFINITION_NAME[] = "<builtins>";
 
     // ----- PRIVATE FIELDS -----
     bool running_ = true;
 
     llvm::LLVMContext* context_;
+    // the builtin definitions in context_, loaded on the first input that gets to ir gen
+    std::unique_ptr<llvm::Module> builtins_ = nullptr;
     JIT_Manager* jit_;
     llvm::raw_ostream* error_stream_;
     REPL_Options options_ = {};
     ReverseParser reverse_parser_;
+    // only committed once an input has made it through the pipeline
+    DependencyTracker dependencies_ = {};
 };
 
 } // namespace Maps
@@ -15,6 +15,7 @@
 #include "readline.h"
 
 #include "mapsc/builtins.hh"
+#include "mapsc/logging.hh"
 #include "mapsc/ast/definition.hh"
 #include "mapsc/compilation_state.hh"
 
@@ -81,6 +82,7 @@ bool REPL::run() {
             continue;
         }
 
+        dependencies_.commit(definitions);
         stored_state = state;
         stored_definitions = definitions;
     }
@@ -128,6 +130,9 @@ void REPL::debug_print(REPL_Stage stage, const llvm::Module& module) {
 // ----- PRIVATE METHODS -----
 
 std::optional<std::string> REPL::get_input() {
+    // the messages from the last input shouldn't wait in this thread's batch
+    LogStream::global.flush();
+
     char* line = readline(options_.prompt.c_str());
 
     if (!line) {
@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 
@@ -7,6 +8,7 @@
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "mapsc/logging.hh"
+#include "mapsc/profiler.hh"
 
 #include "mapsci/cl_options.hh"
 #include "mapsci/init_llvm.hh"
@@ -28,22 +30,59 @@ int main(int argc, char* argv[]) {
     if (action == SHOULD_EXIT)
         return exit_code;
 
+    auto& log_options = *(*log_options_lock)->options_;
+    std::ofstream log_file{};
+
+    if (!log_options.log_file_path.empty()) {
+        log_file.open(log_options.log_file_path, std::ios::out | std::ios::binary);
+        if (!log_file) {
+            std::cerr << "opening log file " << log_options.log_file_path << " failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+        log_options.inner_stream = &log_file;
+    }
+
     if (!init_llvm()) {
         std::cerr << "initializing llvm failed" << std::endl;
         return EXIT_FAILURE;
     }
 
     auto ts_context = make_unique<llvm::orc::ThreadSafeContext>(make_unique<llvm::LLVMContext>());
-    JIT_Manager jit{ts_context.get(), &error_stream};
+    JIT_Manager jit{ts_context.get(), &error_stream, {
+        .optimization_level = repl_options.optimization_level, 
+        .codegen_target = repl_options.codegen_target, 
+        .object_cache_directory = repl_options.object_cache_directory, 
+        .object_cache_size = repl_options.object_cache_size,
+        .lazy = repl_options.lazy_jit,
+        .compile_threads = repl_options.jit_compile_threads}};
 
     if (!jit.is_good) {
         std::cerr << "initializing JIT failed" << std::endl;
         return EXIT_FAILURE;
     }
 
+    if (log_options.asynchronous)
+        LogStream::global.start_async();
+
+    if (repl_options.time_report || !repl_options.time_trace_path.empty())
+        Maps::Profiler::global.enable();
+
     // REPL logs its own failures
-    if (!run_repl(jit, *ts_context->getContext(), error_stream, repl_options)) 
-        return EXIT_FAILURE;
-    
-    return EXIT_SUCCESS;
+    bool success = run_repl(jit, *ts_context->getContext(), error_stream, repl_options);
+
+    LogStream::global.stop_async();
+
+    if (repl_options.time_report)
+        Maps::Profiler::global.write_report(std::cerr);
+
+    if (!repl_options.time_trace_path.empty()) {
+        std::ofstream trace_file{repl_options.time_trace_path};
+        if (!trace_file) {
+            std::cerr << "opening " << repl_options.time_trace_path << " failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+        Maps::Profiler::global.write_chrome_trace(trace_file);
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef __BENCHMARK_HH
+#define __BENCHMARK_HH
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+
+// Minimal timing helpers for the benchmark executables
+// The benchmarks aren't run by ctest, build them with the benchmarks target and run by hand
+
+namespace Maps::Benchmarks {
+
+using Clock = std::chrono::steady_clock;
+
+// Runs the body repetitions times and prints the mean time per iteration
+// iterations is the number of operations the body performs, used for the per-op figure
+inline double run_benchmark(std::string_view name, size_t repetitions, size_t iterations, 
+    auto body) {
+    
+    auto start = Clock::now();
+
+    for (size_t i = 0; i < repetitions; i++)
+        body();
+
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    double mean_us = elapsed.count() / repetitions;
+
+    std::cout << name << ": " << mean_us << " us/run, " 
+              << (mean_us * 1000 / iterations) << " ns/op" << std::endl;
+
+    return mean_us;
+}
+
+// ----- shared workload for the jit benchmarks -----
+
+constexpr size_t CALLS_PER_FUNCTION = 40;
+
+// a chain of CALLS_PER_FUNCTION arithmetic builtin calls, starting from seed
+inline std::optional<Expression*> create_body(CompilationState& state, size_t seed) {
+    Expression* value = create_known_value(state, static_cast<maps_Int>(seed), NO_SOURCE_LOCATION);
+
+    for (size_t i = 0; i < CALLS_PER_FUNCTION; i++) {
+        auto call = create_call(state, i % 2 == 0 ? &plus_Int : &mult_Int, {value,
+            create_known_value(state, static_cast<maps_Int>(i % 7 + 1), NO_SOURCE_LOCATION)},
+            NO_SOURCE_LOCATION);
+
+        if (!call)
+            return std::nullopt;
+        value = *call;
+    }
+
+    return value;
+}
+
+inline std::string definition_name(size_t i) {
+    return "definition_" + std::to_string(i);
+}
+
+// The llvm type of a definition with a body from create_body
+// Takes the generator as a template parameter so that the benchmarks that don't generate ir 
+// don't need the llvm headers
+template <typename IR_Generator>
+auto* definition_type(IR_Generator& generator) {
+    using FunctionType = std::remove_pointer_t<decltype(generator.types_.repl_wrapper_signature)>;
+    return FunctionType::get(generator.types_.int_t, {}, false);
+}
+
+} // namespace Maps::Benchmarks
+
+#endif
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsci/jit_manager.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+using Maps::Benchmarks::create_body;
+using Maps::Benchmarks::definition_name;
+using Maps::Benchmarks::definition_type;
+
+// Time from starting ir gen for a large input (DEFINITION_COUNT definitions and a wrapper that
+// calls all of them) to getting the result back, at -O2
+// With compile threads each definition starts compiling as soon as it's added, while the rest
+// are still being generated
+
+constexpr size_t DEFINITION_COUNT = 200;
+constexpr size_t REPETITIONS = 5;
+constexpr std::string_view ENTRY_POINT = "entry_point";
+
+llvm::orc::ThreadSafeModule create_definition_module(JIT_Manager& jit, CompilationState& state,
+    const std::string& name, const Expression& body) {
+
+    auto context = jit.module_context();
+    auto module = std::make_unique<llvm::Module>(name, *context.getContext());
+    IR_Generator generator{context.getContext(), module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false, .entry_point = name}};
+
+    insert_builtins(generator);
+    generator.function_definition(name, definition_type(generator),
+        llvm::Function::ExternalLinkage);
+    generator.builder_->CreateRet(generator.handle_call(body));
+
+    return llvm::orc::ThreadSafeModule{std::move(module), std::move(context)};
+}
+
+llvm::orc::ThreadSafeModule create_wrapper_module(JIT_Manager& jit, CompilationState& state) {
+    auto context = jit.module_context();
+    auto module = std::make_unique<llvm::Module>("wrapper", *context.getContext());
+    IR_Generator generator{context.getContext(), module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false}};
+
+    std::vector<llvm::Function*> callees{};
+    for (size_t i = 0; i < DEFINITION_COUNT; i++)
+        callees.push_back(*generator.forward_declaration(definition_name(i),
+            definition_type(generator)));
+
+    generator.function_definition(std::string{ENTRY_POINT},
+        llvm::FunctionType::get(generator.types_.void_t, {}, false));
+    for (llvm::Function* callee: callees)
+        generator.builder_->CreateCall(callee);
+    generator.builder_->CreateRetVoid();
+
+    return llvm::orc::ThreadSafeModule{std::move(module), std::move(context)};
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+
+    std::vector<Expression*> bodies{};
+    for (size_t i = 0; i < DEFINITION_COUNT; i++) {
+        auto body = create_body(state, i);
+        if (!body) {
+            std::cerr << "Creating the benchmark workload failed" << std::endl;
+            return 1;
+        }
+        bodies.push_back(*body);
+    }
+
+    llvm::orc::ThreadSafeContext context{std::make_unique<llvm::LLVMContext>()};
+    std::vector<unsigned> thread_counts{0, 1, std::thread::hardware_concurrency()};
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), 
+        thread_counts.end());
+
+    for (unsigned compile_threads: thread_counts) {
+        JIT_Manager jit{&context, &llvm::errs(), {
+            .optimization_level = OptimizationLevel::O2, .compile_threads = compile_threads}};
+
+        if (!jit.is_good)
+            return 1;
+
+        run_benchmark("input with " + std::to_string(compile_threads) + " compile threads",
+            REPETITIONS, DEFINITION_COUNT, [&jit, &state, &bodies]() {
+                for (size_t i = 0; i < DEFINITION_COUNT; i++) {
+                    std::string name = definition_name(i);
+                    if (!jit.add_definition(name,
+                        create_definition_module(jit, state, name, *bodies.at(i))))
+                        std::exit(1);
+                }
+
+                if (!jit.add_definition(std::string{ENTRY_POINT},
+                        create_wrapper_module(jit, state)) ||
+                    !jit.run(std::string{ENTRY_POINT}))
+                    std::exit(1);
+            });
+    }
+
+    return 0;
+}
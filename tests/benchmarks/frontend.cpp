@@ -0,0 +1,66 @@
+#include <sstream>
+#include <string>
+
+#include "mapsc/logging.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/scope.hh"
+#include "mapsc/parser/layer1.hh"
+#include "mapsc/parser/layer2.hh"
+#include "mapsc/procedures/name_resolution.hh"
+#include "mapsc/types/type_store.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using Maps::Benchmarks::run_benchmark;
+
+// Runs layer1, name resolution and layer2 on a synthetic corpus of let definitions
+
+constexpr size_t DEFINITION_COUNT = 2000;
+constexpr size_t REPETITIONS = 10;
+
+std::string synthetic_corpus(size_t definition_count) {
+    std::stringstream source{};
+
+    for (size_t i = 0; i < definition_count; i++) {
+        source << "let a" << i << " = " << i << "\n";
+        source << "let x" << i << " = a" << i << " * 3 + " << i << " + a" << i << " * 2 - 7\n";
+    }
+
+    return source.str();
+}
+
+bool run_frontend(const std::string& corpus) {
+    TypeStore types{};
+    CompilationState state{&types};
+    Scope scope{};
+    std::stringstream source{corpus};
+
+    auto layer1_result = run_layer1(state, scope, source);
+    if (!layer1_result.success)
+        return false;
+
+    if (!resolve_identifiers(state, scope, layer1_result.unresolved_type_identifiers))
+        return false;
+    if (!resolve_identifiers(state, scope, layer1_result.unresolved_identifiers))
+        return false;
+
+    return run_layer2(state, layer1_result.unparsed_termed_expressions);
+}
+
+int main() {
+    // the let definitions warn about scoping
+    auto lock = LogStream::global.set_loglevel(LogLevel::error);
+
+    auto corpus = synthetic_corpus(DEFINITION_COUNT);
+
+    if (!run_frontend(corpus)) {
+        std::cerr << "Frontend failed on the synthetic corpus" << std::endl;
+        return 1;
+    }
+
+    run_benchmark("frontend (layer1, name resolution, layer2)", REPETITIONS, DEFINITION_COUNT, 
+        [&corpus]() { run_frontend(corpus); });
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <memory>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsc/llvm_ir_gen/optimization.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+
+// Compares -O2 compile times and what's left of the module with the attributes and internal
+// linkage ir gen adds against the same module stripped of them
+// The workload only uses some of the builtins, the rest can be dropped if they're internal
+
+constexpr size_t CALL_COUNT = 2000;
+constexpr size_t REPETITIONS = 10;
+
+std::optional<Expression*> create_workload(CompilationState& state) {
+    Expression* value = create_known_value(state, maps_Int{0}, NO_SOURCE_LOCATION);
+
+    for (size_t i = 0; i < CALL_COUNT; i++) {
+        auto call = create_call(state, i % 2 == 0 ? &plus_Int : &mult_Int, {value,
+            create_known_value(state, static_cast<maps_Int>(i % 7 + 1), NO_SOURCE_LOCATION)},
+            NO_SOURCE_LOCATION);
+
+        if (!call)
+            return std::nullopt;
+        value = *call;
+    }
+
+    return value;
+}
+
+// what ir gen produced before it knew about purity and linkage
+void strip_attributes(llvm::Module& module_) {
+    for (llvm::Function& function: module_) {
+        function.setAttributes(llvm::AttributeList{});
+        if (!function.isDeclaration())
+            function.setLinkage(llvm::Function::ExternalLinkage);
+
+        for (llvm::Instruction& instruction: llvm::instructions(function)) {
+            if (auto call = llvm::dyn_cast<llvm::CallInst>(&instruction))
+                call->setAttributes(llvm::AttributeList{});
+        }
+    }
+}
+
+// returns the number of functions left after optimization, or 0 if it failed
+size_t compile(CompilationState& state, const Expression& workload, bool strip) {
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto module = std::make_unique<llvm::Module>("benchmark", *context);
+
+    IR_Generator generator{context.get(), module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false, .entry_point = "workload"}};
+
+    insert_builtins(generator);
+    generator.function_definition("workload",
+        llvm::FunctionType::get(generator.types_.int_t, {}, false));
+    generator.builder_->CreateRet(generator.handle_call(workload));
+
+    if (strip)
+        strip_attributes(*module);
+
+    optimize_module(*module, OptimizationLevel::O2);
+    size_t function_count = module->size();
+
+    auto jit = llvm::orc::LLJITBuilder().create();
+    if (!jit) {
+        llvm::errs() << jit.takeError() << '\n';
+        return 0;
+    }
+
+    if (auto error = (*jit)->addIRModule(
+        llvm::orc::ThreadSafeModule{std::move(module), std::move(context)})) {
+
+        llvm::errs() << error << '\n';
+        return 0;
+    }
+
+    auto symbol = (*jit)->lookup("workload");
+    if (!symbol) {
+        llvm::errs() << symbol.takeError() << '\n';
+        return 0;
+    }
+
+    return function_count;
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+
+    auto workload = create_workload(state);
+    if (!workload) {
+        std::cerr << "Creating the benchmark workload failed" << std::endl;
+        return 1;
+    }
+
+    for (bool strip: {true, false}) {
+        std::string name = strip ? "-O2 without attributes" : "-O2 with attributes";
+
+        size_t function_count = 0;
+        run_benchmark(name, REPETITIONS, CALL_COUNT, [&]() {
+            function_count = compile(state, **workload, strip);
+            if (function_count == 0)
+                std::exit(1);
+        });
+
+        std::cout << "    " << function_count << " functions left after optimization" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsci/jit_manager.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+using Maps::Benchmarks::create_body;
+using Maps::Benchmarks::definition_name;
+using Maps::Benchmarks::definition_type;
+
+// Latency of one REPL input that adds a definition and calls it, after a session of
+// SESSION_SIZE earlier definitions
+// "whole session" regenerates and recompiles every definition into a fresh dylib like the REPL
+// used to, "incremental" only adds the new definition and the wrapper with trackers of their own
+
+constexpr std::array<size_t, 3> SESSION_SIZES = {10, 100, 300};
+constexpr size_t REPETITIONS = 10;
+constexpr std::string_view ENTRY_POINT = "entry_point";
+constexpr std::string_view NEW_DEFINITION = "new_definition";
+
+void add_definition(IR_Generator& generator, const std::string& name, const Expression& body) {
+    generator.function_definition(name, definition_type(generator),
+        generator.definition_linkage(name));
+    generator.builder_->CreateRet(generator.handle_call(body));
+}
+
+void add_entry_point(IR_Generator& generator, llvm::Function* callee) {
+    generator.function_definition(std::string{ENTRY_POINT},
+        llvm::FunctionType::get(generator.types_.void_t, {}, false));
+    generator.builder_->CreateCall(callee);
+    generator.builder_->CreateRetVoid();
+}
+
+// the whole session and the new input in one module
+std::unique_ptr<llvm::Module> create_session_module(llvm::LLVMContext& context,
+    CompilationState& state, const std::vector<Expression*>& bodies, size_t session_size) {
+
+    auto module = std::make_unique<llvm::Module>("session", context);
+    IR_Generator generator{&context, module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false, 
+            .entry_point = std::string{ENTRY_POINT}}};
+
+    insert_builtins(generator);
+
+    for (size_t i = 0; i < session_size; i++)
+        add_definition(generator, definition_name(i), *bodies.at(i));
+
+    add_definition(generator, std::string{NEW_DEFINITION}, *bodies.at(session_size));
+    add_entry_point(generator, module->getFunction(NEW_DEFINITION));
+
+    return module;
+}
+
+// a module with just the one definition, like the REPL generates for each of them
+std::unique_ptr<llvm::Module> create_definition_module(llvm::LLVMContext& context,
+    CompilationState& state, const std::string& name, const Expression& body) {
+
+    auto module = std::make_unique<llvm::Module>(name, context);
+    IR_Generator generator{&context, module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false, .entry_point = name}};
+
+    insert_builtins(generator);
+    add_definition(generator, name, body);
+
+    return module;
+}
+
+std::unique_ptr<llvm::Module> create_wrapper_module(llvm::LLVMContext& context,
+    CompilationState& state) {
+
+    auto module = std::make_unique<llvm::Module>("wrapper", context);
+    IR_Generator generator{&context, module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false}};
+
+    auto callee = generator.forward_declaration(std::string{NEW_DEFINITION},
+        definition_type(generator));
+    add_entry_point(generator, *callee);
+
+    return module;
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+
+    std::vector<Expression*> bodies{};
+    for (size_t i = 0; i <= SESSION_SIZES.back(); i++) {
+        auto body = create_body(state, i);
+        if (!body) {
+            std::cerr << "Creating the benchmark workload failed" << std::endl;
+            return 1;
+        }
+        bodies.push_back(*body);
+    }
+
+    llvm::orc::ThreadSafeContext context{std::make_unique<llvm::LLVMContext>()};
+
+    for (size_t session_size: SESSION_SIZES) {
+        std::string suffix = " after " + std::to_string(session_size) + " definitions";
+
+        {
+            JIT_Manager jit{&context, &llvm::errs()};
+            if (!jit.is_good)
+                return 1;
+
+            run_benchmark("input (whole session)" + suffix, REPETITIONS, 1,
+                [&jit, &context, &state, &bodies, session_size]() {
+                    auto module = create_session_module(*context.getContext(), state, bodies,
+                        session_size);
+
+                    jit.reset();
+                    if (!jit.compile_and_run(std::move(module), std::string{ENTRY_POINT}))
+                        std::exit(1);
+                });
+        }
+
+        JIT_Manager jit{&context, &llvm::errs()};
+        if (!jit.is_good)
+            return 1;
+
+        // the earlier inputs, which only get compiled if something calls them
+        for (size_t i = 0; i < session_size; i++) {
+            std::string name = definition_name(i);
+            if (!jit.add_definition(name, create_definition_module(*context.getContext(),
+                state, name, *bodies.at(i))))
+                return 1;
+        }
+
+        run_benchmark("input (incremental)" + suffix, REPETITIONS, 1,
+            [&jit, &context, &state, &bodies, session_size]() {
+                std::string name{NEW_DEFINITION};
+                if (!jit.add_definition(name, create_definition_module(*context.getContext(),
+                        state, name, *bodies.at(session_size))) ||
+                    !jit.add_definition(std::string{ENTRY_POINT},
+                        create_wrapper_module(*context.getContext(), state)) ||
+                    !jit.run(std::string{ENTRY_POINT}))
+                    std::exit(1);
+            });
+    }
+
+    return 0;
+}
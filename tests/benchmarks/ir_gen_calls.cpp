@@ -0,0 +1,115 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+
+// Emits thousands of calls to the overloaded builtins to measure the cost of callee lookups 
+// in IR_Generator::handle_call
+// Also compares setting up the builtins for a small, REPL input sized module by generating them 
+// against declaring them and linking them in from the cached bitcode
+
+constexpr size_t CALL_COUNT = 4000;
+constexpr size_t REPETITIONS = 20;
+constexpr size_t SMALL_MODULE_REPETITIONS = 2000;
+
+int main() {
+    auto [state, types] = CompilationState::create_test_state();
+
+    const DefinitionHeader* callees[] = {
+        &plus_Int, &binary_minus_Int, &mult_Int, &unary_minus_Int, &to_Float_Int
+    };
+
+    std::vector<Expression*> calls{};
+    for (size_t i = 0; i < CALL_COUNT; i++) {
+        const DefinitionHeader* callee = callees[i % std::size(callees)];
+        auto arity = dynamic_cast<const FunctionType*>(callee->get_type())->arity();
+
+        std::vector<Expression*> args{};
+        for (size_t j = 0; j < arity; j++)
+            args.push_back(create_known_value(state, maps_Int{static_cast<maps_Int>(i + j)}, NO_SOURCE_LOCATION));
+
+        auto call = create_call(state, callee, std::move(args), NO_SOURCE_LOCATION);
+        if (!call) {
+            std::cerr << "Creating benchmark calls failed" << std::endl;
+            return 1;
+        }
+        calls.push_back(*call);
+    }
+
+    run_benchmark("handle_call (overloaded builtins)", REPETITIONS, CALL_COUNT, [&state, &calls]() {
+        llvm::LLVMContext context{};
+        auto module = std::make_unique<llvm::Module>("benchmark", context);
+        IR_Generator generator{&context, module.get(), &state, &llvm::errs(), 
+            {.verify_functions = false, .verify_module = false}};
+
+        insert_builtins(generator);
+        generator.function_definition("benchmark_calls", 
+            llvm::FunctionType::get(generator.types_.void_t, {}, false));
+
+        for (auto call: calls)
+            generator.handle_call(*call);
+
+        generator.builder_->CreateRetVoid();
+    });
+
+    // a single call, like most REPL inputs
+    auto small_call = create_call(state, &plus_Int, {
+        create_known_value(state, maps_Int{1}, NO_SOURCE_LOCATION), 
+        create_known_value(state, maps_Int{2}, NO_SOURCE_LOCATION)}, NO_SOURCE_LOCATION);
+
+    if (!small_call) {
+        std::cerr << "Creating benchmark calls failed" << std::endl;
+        return 1;
+    }
+
+    // the REPL keeps the same context for every input, so the builtins are only loaded once
+    llvm::LLVMContext context{};
+    auto builtins = load_builtins(context, state);
+    if (!builtins)
+        return 1;
+
+    for (bool from_bitcode: {false, true}) {
+        std::string name = from_bitcode ? 
+            "small module (builtins copied from bitcode)" : "small module (builtins generated)";
+
+        run_benchmark(name, SMALL_MODULE_REPETITIONS, 1, 
+            [&state, &small_call, &context, &builtins, from_bitcode]() {
+                auto module = std::make_unique<llvm::Module>("benchmark", context);
+                IR_Generator generator{&context, module.get(), &state, &llvm::errs(), {
+                    .verify_functions = false, .verify_module = false, .entry_point = "benchmark"}};
+
+                if (from_bitcode) {
+                    declare_builtins(generator);
+                } else {
+                    insert_builtins(generator);
+                }
+
+                generator.function_definition("benchmark", 
+                    llvm::FunctionType::get(generator.types_.int_t, {}, false));
+                generator.builder_->CreateRet(generator.handle_call(**small_call));
+
+                if (from_bitcode && !link_builtins(generator, *builtins))
+                    std::exit(1);
+            });
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapsc/logging.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/layer2_expression.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/ast/test_helpers/test_definition.hh"
+#include "mapsc/parser/layer2.hh"
+#include "mapsc/types/type_store.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using Maps::Benchmarks::run_benchmark;
+
+// Runs layer2 on long generated operator chains
+// layer2 rewrites the terms it's given, so every run gets a freshly generated chain
+
+constexpr size_t OPERATOR_COUNT = 10000;
+constexpr size_t REPETITIONS = 20;
+
+struct ChainOperators {
+    const Operator* low;
+    const Operator* middle;
+    const Operator* high;
+};
+
+ChainOperators create_operators(CompilationState& state) {
+    const Type* type = state.types_->get_function_type(
+        &NumberLiteral, {&NumberLiteral, &NumberLiteral}, true);
+
+    auto create = [&state, type](const std::string& name, Operator::Precedence precedence) {
+        return create_testing_binary_operator(*state.ast_store_, name, type, 
+            precedence, Operator::Associativity::left, TSL);
+    };
+
+    return {create("+", 100), create("*", 200), create("^", 300)};
+}
+
+// value op value op value ..., with the operators taken from cycle in turn
+std::vector<Expression*> create_chain(CompilationState& state, 
+    std::span<const Operator* const> cycle, size_t operator_count) {
+
+    AST_Store& ast_store = *state.ast_store_;
+    std::vector<Expression*> terms{create_numeric_literal(ast_store, "1", TSL)};
+
+    for (size_t i = 0; i < operator_count; i++) {
+        terms.push_back(create_operator_reference(ast_store, cycle[i % cycle.size()], TSL));
+        terms.push_back(create_numeric_literal(ast_store, "1", TSL));
+    }
+
+    return terms;
+}
+
+// one chain per repetition, plus the one that's checked before timing
+std::vector<Expression*> create_chains(CompilationState& state, 
+    std::span<const Operator* const> cycle) {
+
+    std::vector<Expression*> chains{};
+    for (size_t i = 0; i <= REPETITIONS; i++)
+        chains.push_back(create_layer2_expression_testing(*state.ast_store_, 
+            create_chain(state, cycle, OPERATOR_COUNT), TSL));
+
+    return chains;
+}
+
+int main() {
+    auto lock = LogStream::global.set_loglevel(LogLevel::error);
+
+    auto [state, _types] = CompilationState::create_test_state();
+    auto operators = create_operators(state);
+
+    // 1 + 1 + 1 + ...
+    const Operator* flat_cycle[] = {operators.low};
+    // 1 + 1 * 1 ^ 1 + 1 * 1 ^ 1 ..., keeps the precedence stack moving up and down
+    const Operator* mixed_cycle[] = {operators.low, operators.middle, operators.high};
+    // 1 ^ 1 * 1 + 1 ^ 1 * 1 + ..., every operator closes the level opened before it
+    const Operator* descending_cycle[] = {operators.high, operators.middle, operators.low};
+
+    auto flat = create_chains(state, flat_cycle);
+    auto mixed = create_chains(state, mixed_cycle);
+    auto descending = create_chains(state, descending_cycle);
+
+    for (auto chains: {&flat, &mixed, &descending}) {
+        if (!run_layer2(state, chains->back())) {
+            std::cerr << "Layer2 failed on a generated operator chain" << std::endl;
+            return 1;
+        }
+        chains->pop_back();
+    }
+
+    auto run_chains = [&state](std::vector<Expression*>& chains) {
+        return [&state, &chains, next = size_t{0}]() mutable { 
+            run_layer2(state, chains.at(next++)); 
+        };
+    };
+
+    run_benchmark("layer2 flat chain", REPETITIONS, OPERATOR_COUNT, run_chains(flat));
+    run_benchmark("layer2 mixed precedence chain", REPETITIONS, OPERATOR_COUNT, 
+        run_chains(mixed));
+    run_benchmark("layer2 descending precedence chain", REPETITIONS, OPERATOR_COUNT, 
+        run_chains(descending));
+
+    return 0;
+}
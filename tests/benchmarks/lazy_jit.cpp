@@ -0,0 +1,98 @@
+#include <memory>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsci/jit_manager.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+using Maps::Benchmarks::create_body;
+
+// Time from generating a module to getting the result back, with the whole module compiled 
+// up front vs. compiled on demand
+// The module is a "library" of functions of which the entry point only calls one, like a REPL
+// input with a big preloaded scope
+
+constexpr size_t LIBRARY_SIZE = 300;
+constexpr size_t REPETITIONS = 10;
+constexpr std::string_view ENTRY_POINT = "entry_point";
+
+std::unique_ptr<llvm::Module> create_module(llvm::LLVMContext& context, CompilationState& state,
+    const std::vector<Expression*>& bodies) {
+
+    auto module = std::make_unique<llvm::Module>("benchmark", context);
+    IR_Generator generator{&context, module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false, 
+            .entry_point = std::string{ENTRY_POINT}}};
+
+    insert_builtins(generator);
+
+    std::vector<llvm::Function*> library{};
+    for (size_t i = 0; i < bodies.size(); i++) {
+        auto function = generator.function_definition("library_" + std::to_string(i),
+            llvm::FunctionType::get(generator.types_.int_t, {}, false), 
+            llvm::Function::InternalLinkage);
+
+        generator.builder_->CreateRet(generator.handle_call(*bodies.at(i)));
+        library.push_back(*function);
+    }
+
+    generator.function_definition(std::string{ENTRY_POINT}, 
+        llvm::FunctionType::get(generator.types_.void_t, {}, false));
+    generator.builder_->CreateCall(library.front());
+    generator.builder_->CreateRetVoid();
+
+    return module;
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+
+    std::vector<Expression*> bodies{};
+    for (size_t i = 0; i < LIBRARY_SIZE; i++) {
+        auto body = create_body(state, i);
+        if (!body) {
+            std::cerr << "Creating the benchmark workload failed" << std::endl;
+            return 1;
+        }
+        bodies.push_back(*body);
+    }
+
+    llvm::orc::ThreadSafeContext context{std::make_unique<llvm::LLVMContext>()};
+
+    for (bool lazy: {false, true}) {
+        JIT_Manager jit{&context, &llvm::errs(), {.lazy = lazy}};
+        if (!jit.is_good)
+            return 1;
+
+        run_benchmark(lazy ? "first result (lazy)" : "first result (eager)", REPETITIONS, 1, 
+            [&jit, &context, &state, &bodies]() {
+                auto module = create_module(*context.getContext(), state, bodies);
+
+                jit.reset();
+                if (!jit.compile_and_run(std::move(module), std::string{ENTRY_POINT}))
+                    std::exit(1);
+            });
+    }
+
+    return 0;
+}
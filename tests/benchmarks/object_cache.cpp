@@ -0,0 +1,103 @@
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsc/llvm_ir_gen/object_cache.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+
+// Codegen time for the same module without the object cache and when it's a cache hit
+// A hit still has to print and hash the module to find the key
+// Codegen can change the module, so every run gets a fresh copy (in both cases)
+
+constexpr size_t CALL_COUNT = 2000;
+constexpr size_t REPETITIONS = 20;
+
+std::unique_ptr<llvm::Module> create_module(llvm::LLVMContext& context, CompilationState& state) {
+    auto module = std::make_unique<llvm::Module>("benchmark", context);
+    IR_Generator generator{&context, module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false}};
+
+    insert_builtins(generator);
+    generator.function_definition("workload",
+        llvm::FunctionType::get(generator.types_.int_t, {}, false));
+
+    Expression* value = create_known_value(state, maps_Int{0}, NO_SOURCE_LOCATION);
+    for (size_t i = 0; i < CALL_COUNT; i++) {
+        auto call = create_call(state, i % 2 == 0 ? &plus_Int : &mult_Int, {value,
+            create_known_value(state, static_cast<maps_Int>(i % 7 + 1), NO_SOURCE_LOCATION)},
+            NO_SOURCE_LOCATION);
+
+        if (!call)
+            return nullptr;
+        value = *call;
+    }
+
+    generator.builder_->CreateRet(generator.handle_call(*value));
+    return module;
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+
+    auto module = create_module(context, state);
+    auto target_machine_builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!module || !target_machine_builder)
+        return 1;
+
+    auto target_machine = target_machine_builder->createTargetMachine();
+    if (!target_machine)
+        return 1;
+
+    auto directory = std::filesystem::temp_directory_path() / ("maps_object_cache_benchmark_" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    DiskObjectCache cache{directory, DEFAULT_OBJECT_CACHE_SIZE, "benchmark"};
+    if (!cache.is_good)
+        return 1;
+
+    llvm::orc::SimpleCompiler uncached{**target_machine};
+    llvm::orc::SimpleCompiler cached{**target_machine, &cache};
+
+    // fill the cache
+    if (!cached(*llvm::CloneModule(*module)))
+        return 1;
+
+    run_benchmark("codegen without cache", REPETITIONS, 1, [&uncached, &module]() {
+        if (!uncached(*llvm::CloneModule(*module)))
+            std::exit(1);
+    });
+
+    run_benchmark("codegen with a cache hit", REPETITIONS, 1, [&cached, &module]() {
+        if (!cached(*llvm::CloneModule(*module)))
+            std::exit(1);
+    });
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <memory>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/function_definition.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsc/llvm_ir_gen/optimization.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+
+// Compile time (ir gen + optimization + jit) and run time of the generated code at each -O level
+// The workload is a long chain of arithmetic builtin calls, which is most of what ir gen can
+// produce at the moment. It multiplies by its parameter, otherwise the optimizer would either 
+// fold the whole chain or collapse it into a single multiply and add
+
+constexpr size_t CALL_COUNT = 2000;
+constexpr size_t COMPILE_REPETITIONS = 10;
+constexpr size_t RUN_REPETITIONS = 10'000;
+
+constexpr OptimizationLevel LEVELS[] = {
+    OptimizationLevel::O0, OptimizationLevel::O1, OptimizationLevel::O2,
+    OptimizationLevel::O3, OptimizationLevel::Os
+};
+
+// the seed is the parameter of the generated function
+struct Workload {
+    const Parameter* seed;
+    Expression* value;
+};
+
+using WorkloadFunction = maps_Int(*)(maps_Int);
+
+// ((((seed + 1) * seed) - 3) + 4)...
+std::optional<Workload> create_workload(CompilationState& state) {
+    const DefinitionHeader* callees[] = {&plus_Int, &mult_Int, &binary_minus_Int};
+
+    Parameter* seed = create_parameter(*state.ast_store_, "seed", &Int, NO_SOURCE_LOCATION);
+    Expression* value = create_reference(*state.ast_store_, seed, NO_SOURCE_LOCATION);
+
+    for (size_t i = 0; i < CALL_COUNT; i++) {
+        const DefinitionHeader* callee = callees[i % std::size(callees)];
+
+        Expression* operand = callee == &mult_Int ?
+            create_reference(*state.ast_store_, seed, NO_SOURCE_LOCATION) :
+            create_known_value(state, static_cast<maps_Int>(i % 7 + 1), NO_SOURCE_LOCATION);
+
+        auto call = create_call(state, callee, {value, operand}, NO_SOURCE_LOCATION);
+
+        if (!call)
+            return std::nullopt;
+        value = *call;
+    }
+
+    return Workload{seed, value};
+}
+
+std::optional<WorkloadFunction> compile(llvm::orc::LLJIT& jit, CompilationState& state,
+    const Workload& workload, OptimizationLevel level) {
+
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto module = std::make_unique<llvm::Module>("benchmark", *context);
+    module->setDataLayout(jit.getDataLayout());
+
+    IR_Generator generator{context.get(), module.get(), &state, &llvm::errs(),
+        {.verify_functions = false, .verify_module = false}};
+
+    insert_builtins(generator);
+    auto function = generator.function_definition("workload", llvm::FunctionType::get(
+        generator.types_.int_t, {generator.types_.int_t}, false));
+    if (!function)
+        return std::nullopt;
+
+    generator.local_values_.insert({workload.seed, (*function)->getArg(0)});
+    generator.builder_->CreateRet(generator.handle_call(*workload.value));
+
+    optimize_module(*module, level);
+
+    auto tracker = jit.getMainJITDylib().createResourceTracker();
+    if (auto error = jit.addIRModule(tracker,
+        llvm::orc::ThreadSafeModule{std::move(module), std::move(context)})) {
+
+        llvm::errs() << error << '\n';
+        return std::nullopt;
+    }
+
+    auto symbol = jit.lookup("workload");
+    if (!symbol) {
+        llvm::errs() << symbol.takeError() << '\n';
+        return std::nullopt;
+    }
+
+    return symbol->toPtr<WorkloadFunction>();
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+
+    auto workload = create_workload(state);
+    if (!workload) {
+        std::cerr << "Creating the benchmark workload failed" << std::endl;
+        return 1;
+    }
+
+    for (OptimizationLevel level: LEVELS) {
+        std::string name{optimization_level_name(level)};
+
+        // every compile gets a fresh jit so that the symbols don't clash
+        run_benchmark("compile " + name, COMPILE_REPETITIONS, CALL_COUNT,
+            [&state, &workload, level]() {
+                auto jit = llvm::orc::LLJITBuilder().create();
+                if (!jit || !compile(**jit, state, *workload, level))
+                    std::exit(1);
+            });
+
+        auto jit = llvm::orc::LLJITBuilder().create();
+        if (!jit) {
+            llvm::errs() << jit.takeError() << '\n';
+            return 1;
+        }
+
+        auto function = compile(**jit, state, *workload, level);
+        if (!function)
+            return 1;
+
+        // read through volatile so that each run looks like it could get a different seed
+        volatile maps_Int seed = 3;
+        volatile maps_Int result = 0;
+        run_benchmark("run " + name, RUN_REPETITIONS, CALL_COUNT, [&function, &seed, &result]() {
+            result = (*function)(seed);
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsc/llvm_ir_gen/parallel_ir_gen.hh"
+
+#include "benchmarks/benchmark.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using Maps::Benchmarks::run_benchmark;
+
+// IR gen for a batch of DEFINITION_COUNT definitions, each calling the one before it
+// "one module" is a single IR_Generator going through them in order, the parallel ones give
+// every definition a context and module of its own and link them together afterwards
+
+constexpr size_t DEFINITION_COUNT = 300;
+constexpr size_t CALLS_PER_FUNCTION = 40;
+constexpr size_t REPETITIONS = 5;
+
+std::optional<Expression*> create_body(CompilationState& state,
+    const DefinitionHeader* previous, size_t seed) {
+
+    std::optional<Expression*> value = previous ?
+        create_call(state, previous, {}, NO_SOURCE_LOCATION) :
+        create_known_value(state, static_cast<maps_Int>(seed), NO_SOURCE_LOCATION);
+
+    for (size_t i = 0; value && i < CALLS_PER_FUNCTION; i++) {
+        value = create_call(state, i % 2 == 0 ? &plus_Int : &mult_Int, {*value,
+            create_known_value(state, static_cast<maps_Int>(i % 7 + 1), NO_SOURCE_LOCATION)},
+            NO_SOURCE_LOCATION);
+    }
+
+    return value;
+}
+
+bool run_one_module(CompilationState& state, const std::vector<DefinitionHeader*>& definitions) {
+    llvm::LLVMContext context{};
+    llvm::Module module_{"batch", context};
+    IR_Generator generator{&context, &module_, &state, &llvm::errs()};
+
+    auto builtins = load_builtins(context, state);
+    return builtins && declare_builtins(generator) && generator.run(definitions) &&
+        link_builtins(generator, *builtins);
+}
+
+bool run_parallel(CompilationState& state, const std::vector<DefinitionHeader*>& definitions,
+    unsigned int thread_count) {
+
+    llvm::LLVMContext context{};
+    llvm::Module module_{"batch", context};
+    return run_ir_gen_parallel(state, module_, definitions, thread_count, &llvm::errs());
+}
+
+int main() {
+    auto [state, types] = CompilationState::create_test_state();
+
+    std::vector<DefinitionHeader*> definitions{};
+    for (size_t i = 0; i < DEFINITION_COUNT; i++) {
+        auto body = create_body(state, definitions.empty() ? nullptr : definitions.back(), i);
+        if (!body) {
+            std::cerr << "Creating the benchmark workload failed" << std::endl;
+            return 1;
+        }
+
+        auto [definition, _] = create_let_definition(*state.ast_store_,
+            "definition_" + std::to_string(i), *body, NO_SOURCE_LOCATION);
+        definitions.push_back(definition);
+    }
+
+    run_benchmark("one module", REPETITIONS, DEFINITION_COUNT, [&state, &definitions]() {
+        if (!run_one_module(state, definitions))
+            std::exit(1);
+    });
+
+    std::vector<unsigned int> thread_counts{1, std::max(1u, std::thread::hardware_concurrency())};
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()),
+        thread_counts.end());
+
+    for (unsigned int thread_count: thread_counts) {
+        run_benchmark("partitioned on " + std::to_string(thread_count) + " threads", REPETITIONS,
+            DEFINITION_COUNT, [&state, &definitions, thread_count]() {
+                if (!run_parallel(state, definitions, thread_count))
+                    std::exit(1);
+            });
+    }
+
+    return 0;
+}
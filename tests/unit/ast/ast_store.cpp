@@ -1,5 +1,6 @@
 #include "doctest.h"
 
+#include "mapsc/builtins.hh"
 #include "mapsc/types/type.hh"
 #include "mapsc/types/type_defs.hh"
 #include "mapsc/ast/ast_store.hh"
@@ -65,4 +66,80 @@ TEST_CASE("Should allocate definitions correctly") {
 
     CHECK(std::holds_alternative<Expression*>(body->get_value()));
     CHECK(*std::get<Expression*>(body->get_value()) == *value);
-}
\ No newline at end of file
+}
+
+TEST_CASE("AST_Store::memory_stats should account for nodes and their payloads") {
+    auto [state, ast_store, scope, types] = setup();
+
+    CHECK(ast_store->memory_stats().node_count() == 0);
+
+    auto value = create_known_value(state, 123, TSL);
+    auto [header, body] = ast_store->allocate_definition(
+        RT_DefinitionHeader{DefinitionType::let_definition, "test", TSL}, value);
+
+    std::vector<Expression*> terms{value, value, value};
+    ast_store->allocate_expression(Expression{ExpressionType::layer2_expression, 
+        TermedExpressionValue{terms, &scope}, TSL});
+
+    auto stats = ast_store->memory_stats();
+    CHECK(stats.node_count() == ast_store->size());
+
+    auto known_values = stats.get("expression:known_value");
+    REQUIRE(known_values);
+    CHECK(*known_values == MemoryUsage{1, sizeof(Expression), 0});
+
+    auto termed = stats.get("expression:termed_expression");
+    REQUIRE(termed);
+    CHECK(termed->payload_bytes == 3 * sizeof(Expression*));
+
+    auto let_definitions = stats.get("definition:let");
+    REQUIRE(let_definitions);
+    CHECK(let_definitions->node_bytes == sizeof(RT_DefinitionHeader));
+
+    CHECK(stats.get("definition body")->count == 1);
+    CHECK(stats.total_bytes() > 2 * sizeof(Expression) + sizeof(RT_DefinitionHeader));
+}
+
+TEST_CASE("AST_Store::memory_stats should leave out deleted nodes") {
+    auto [state, ast_store, scope, types] = setup();
+
+    auto value = create_known_value(state, 123, TSL);
+    auto deleted = create_known_value(state, 456, TSL);
+    ast_store->delete_expression(deleted);
+
+    auto known_values = ast_store->memory_stats().get("expression:known_value");
+    REQUIRE(known_values);
+    CHECK(known_values->count == 1);
+    CHECK(!ast_store->memory_stats().get("expression:deleted"));
+}
+
+TEST_CASE("AST_Store::free_deleted should free the deleted nodes nothing refers to") {
+    auto [state, ast_store, scope, types] = setup();
+
+    auto kept = create_known_value(state, 1, TSL);
+    auto still_referred_to = create_known_value(state, 2, TSL);
+    auto termed = ast_store->allocate_expression(Expression{ExpressionType::layer2_expression, 
+        TermedExpressionValue{{kept, still_referred_to}, &scope}, TSL});
+    ast_store->allocate_definition(
+        RT_DefinitionHeader{DefinitionType::let_definition, "test", TSL}, termed);
+
+    auto garbage = create_known_value(state, 3, TSL);
+    auto garbage_call = ast_store->allocate_expression(Expression{ExpressionType::call,
+        CallExpressionValue{&plus_Int, {garbage, create_known_value(state, 4, TSL)}}, &Int, TSL});
+
+    CHECK(ast_store->free_deleted() == 0);
+
+    size_t size_before = ast_store->size();
+    ast_store->delete_expression(still_referred_to);
+    ast_store->delete_expression_recursive(garbage_call);
+
+    CHECK(ast_store->free_deleted() == 3);
+    CHECK(ast_store->size() == size_before - 3);
+
+    // the termed expression can still be looked at
+    CHECK(still_referred_to->expression_type == ExpressionType::deleted);
+    CHECK(termed->terms().at(0) == kept);
+
+    // nothing new was deleted
+    CHECK(ast_store->free_deleted() == 0);
+}
@@ -0,0 +1,116 @@
+#include "doctest.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+TEST_CASE("Arithmetic builtins should be internal and marked as not touching memory") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+    IR_Generator generator{&context, &module, &state, &llvm::errs()};
+
+    REQUIRE(insert_builtins(generator));
+
+    auto plus = module.getFunction("+_Int_Int_Int");
+    REQUIRE(plus);
+    CHECK(plus->hasInternalLinkage());
+    CHECK(plus->doesNotAccessMemory());
+    CHECK(plus->doesNotThrow());
+    CHECK(plus->willReturn());
+    CHECK(plus->mustProgress());
+    CHECK(plus->hasRetAttribute(llvm::Attribute::NoUndef));
+    CHECK(plus->getArg(0)->hasAttribute(llvm::Attribute::NoUndef));
+
+    SUBCASE("libmaps declarations only get what holds for any function") {
+        auto concat = module.getFunction("concat");
+        REQUIRE(concat);
+        CHECK(concat->doesNotThrow());
+        CHECK(!concat->onlyReadsMemory());
+        CHECK(concat->getArg(0)->hasNonNullAttr());
+    }
+
+    SUBCASE("calls repeat the callee's attributes") {
+        generator.function_definition("caller",
+            llvm::FunctionType::get(generator.types_.int_t, {}, false));
+
+        auto call = create_call(state, &plus_Int, {create_known_value(state, maps_Int{1}, TSL),
+            create_known_value(state, maps_Int{2}, TSL)}, TSL);
+        REQUIRE(call);
+
+        auto llvm_call = llvm::dyn_cast<llvm::CallInst>(generator.handle_call(**call));
+        REQUIRE(llvm_call);
+        CHECK(llvm_call->hasFnAttr(llvm::Attribute::NoUnwind));
+        CHECK(llvm_call->doesNotAccessMemory());
+    }
+}
+
+TEST_CASE("Pure functions that call something allocating shouldn't be marked as not touching memory") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+    IR_Generator generator{&context, &module, &state, &llvm::errs()};
+
+    REQUIRE(insert_builtins(generator));
+    auto concat = module.getFunction("concat");
+    REQUIRE(concat);
+
+    // returns an Int, but allocates a string on the way
+    auto function = *generator.function_definition("allocates",
+        llvm::FunctionType::get(generator.types_.int_t, {}, false));
+    auto string = llvm::ConstantPointerNull::get(generator.types_.mutstring_ptr_t);
+    generator.builder_->CreateCall(concat, {string, string});
+    generator.builder_->CreateRet(generator.builder_->getInt32(0));
+
+    generator.add_memory_attributes(*function, *types->get_function_type(&Int, {}, true));
+    CHECK(!function->onlyReadsMemory());
+    CHECK(!function->hasFnAttribute(llvm::Attribute::NoSync));
+}
+
+TEST_CASE("Only the entry point should get external linkage if one is given") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+
+    auto [value, value_body] = create_let_definition(*state.ast_store_, "value", 
+        create_known_value(state, maps_Int{3}, TSL), TSL);
+
+    SUBCASE("entry point set") {
+        IR_Generator generator{&context, &module, &state, &llvm::errs(), 
+            {.entry_point = "main"}};
+
+        REQUIRE(generator.handle_global_definition(*value));
+
+        auto function = module.getFunction("value");
+        REQUIRE(function);
+        CHECK(function->hasInternalLinkage());
+        CHECK(function->doesNotAccessMemory());
+        // with mustprogress llvm would take it to always return
+        CHECK(!function->mustProgress());
+        CHECK(!function->willReturn());
+    }
+
+    SUBCASE("no entry point") {
+        IR_Generator generator{&context, &module, &state, &llvm::errs()};
+
+        REQUIRE(generator.handle_global_definition(*value));
+        CHECK(module.getFunction("value")->hasExternalLinkage());
+    }
+}
@@ -0,0 +1,60 @@
+#include "doctest.h"
+
+#include <memory>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+#include "mapsc/llvm_ir_gen/function_store.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+TEST_CASE("FunctionStore should resolve overloaded builtins by definition") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+    IR_Generator generator{&context, &module, &state, &llvm::errs()};
+
+    insert_builtins(generator);
+
+    auto plus = generator.function_store_->get(plus_Int);
+    auto minus = generator.function_store_->get(binary_minus_Int);
+
+    REQUIRE(plus);
+    REQUIRE(minus);
+    CHECK(plus->getCallee() != minus->getCallee());
+    CHECK(plus->getCallee()->getName() == "+_Int_Int_Int");
+
+    auto plus_again = generator.function_store_->get(plus_Int);
+    REQUIRE(plus_again);
+    CHECK(plus_again->getCallee() == plus->getCallee());
+}
+
+TEST_CASE("FunctionStore should return bound definitions without a name lookup") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+
+    DefinitionHeader definition{"not_in_store", &IntInt_to_Int};
+    auto function = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getInt32Ty(context), {}, false), 
+        llvm::Function::ExternalLinkage, "some_other_name", &module);
+
+    FunctionStore store{};
+    CHECK(store.bind(definition, function));
+    CHECK(!store.bind(definition, function));
+
+    auto result = store.get(definition);
+    REQUIRE(result);
+    CHECK(result->getCallee() == function);
+}
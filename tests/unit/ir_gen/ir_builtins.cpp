@@ -0,0 +1,126 @@
+#include "doctest.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+namespace {
+
+// i32 caller() { ret 1 + 2 }
+void create_caller(CompilationState& state, IR_Generator& generator) {
+    generator.function_definition("caller",
+        llvm::FunctionType::get(generator.types_.int_t, {}, false));
+
+    auto call = create_call(state, &plus_Int, {create_known_value(state, maps_Int{1}, TSL),
+        create_known_value(state, maps_Int{2}, TSL)}, TSL);
+    REQUIRE(call);
+
+    generator.builder_->CreateRet(generator.handle_call(**call));
+}
+
+} // namespace
+
+TEST_CASE("builtins_bitcode should only be generated once") {
+    auto [state, types] = CompilationState::create_test_state();
+
+    auto bitcode = builtins_bitcode(state);
+    REQUIRE(bitcode);
+    CHECK(bitcode->getBufferSize() > 0);
+    CHECK(builtins_bitcode(state) == bitcode);
+
+    llvm::LLVMContext context{};
+    auto builtins = load_builtins(context, state);
+    REQUIRE(builtins);
+
+    auto plus = builtins->getFunction("+_Int_Int_Int");
+    REQUIRE(plus);
+    CHECK(!plus->isDeclaration());
+    CHECK(plus->doesNotAccessMemory());
+}
+
+TEST_CASE("declare_builtins should only declare the arithmetic builtins") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+    IR_Generator generator{&context, &module, &state, &llvm::errs()};
+
+    REQUIRE(declare_builtins(generator));
+
+    auto plus = module.getFunction("+_Int_Int_Int");
+    REQUIRE(plus);
+    CHECK(plus->isDeclaration());
+    CHECK(plus->doesNotAccessMemory());
+
+    auto stored = generator.function_store_->get(plus_Int);
+    REQUIRE(stored);
+    CHECK(stored->getCallee() == plus);
+}
+
+TEST_CASE("link_builtins should only define the builtins that are called") {
+    auto [state, types] = CompilationState::create_test_state();
+    llvm::LLVMContext context{};
+    llvm::Module module{"test", context};
+
+    auto builtins = load_builtins(context, state);
+    REQUIRE(builtins);
+
+    SUBCASE("with an entry point") {
+        IR_Generator generator{&context, &module, &state, &llvm::errs(),
+            {.entry_point = "caller"}};
+
+        REQUIRE(declare_builtins(generator));
+        create_caller(state, generator);
+        REQUIRE(link_builtins(generator, *builtins));
+
+        auto plus = module.getFunction("+_Int_Int_Int");
+        REQUIRE(plus);
+        CHECK(!plus->isDeclaration());
+        CHECK(plus->hasInternalLinkage());
+        CHECK(plus->willReturn());
+
+        // the function store still points to the same function
+        auto stored = generator.function_store_->get(plus_Int);
+        REQUIRE(stored);
+        CHECK(stored->getCallee() == plus);
+
+        auto mult = module.getFunction("*_Int_Int_Int");
+        REQUIRE(mult);
+        CHECK(mult->isDeclaration());
+
+        // libmaps stays external
+        auto concat = module.getFunction("concat");
+        REQUIRE(concat);
+        CHECK(concat->isDeclaration());
+
+        CHECK(!llvm::verifyModule(module, &llvm::errs()));
+    }
+
+    SUBCASE("without an entry point") {
+        IR_Generator generator{&context, &module, &state, &llvm::errs()};
+
+        REQUIRE(declare_builtins(generator));
+        create_caller(state, generator);
+        REQUIRE(link_builtins(generator, *builtins));
+
+        auto plus = module.getFunction("+_Int_Int_Int");
+        REQUIRE(plus);
+        CHECK(!plus->isDeclaration());
+        CHECK(plus->hasExternalLinkage());
+    }
+}
@@ -0,0 +1,160 @@
+#include "doctest.h"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+
+#include "mapsc/profiler.hh"
+#include "mapsc/llvm_ir_gen/object_cache.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+namespace {
+
+// i32 name() { ret value }
+unique_ptr<llvm::Module> create_module(llvm::LLVMContext& context, const string& name,
+    int value) {
+
+    auto module_ = make_unique<llvm::Module>("test", context);
+    llvm::IRBuilder<> builder{context};
+
+    auto function = llvm::Function::Create(llvm::FunctionType::get(builder.getInt32Ty(), {}, false),
+        llvm::Function::ExternalLinkage, name, *module_);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", function));
+    builder.CreateRet(builder.getInt32(value));
+
+    return module_;
+}
+
+// a fresh directory under the system temp directory, removed at the end of the test
+struct TemporaryDirectory {
+    TemporaryDirectory()
+    :path(filesystem::temp_directory_path() / ("maps_object_cache_test_" +
+        to_string(chrono::steady_clock::now().time_since_epoch().count()))) {}
+
+    ~TemporaryDirectory() {
+        error_code error;
+        filesystem::remove_all(path, error);
+    }
+
+    filesystem::path path;
+};
+
+} // namespace
+
+TEST_CASE("DiskObjectCache keys should depend on the module and the salt") {
+    TemporaryDirectory directory{};
+    llvm::LLVMContext context{};
+
+    DiskObjectCache cache{directory.path, DEFAULT_OBJECT_CACHE_SIZE, "salt"};
+    REQUIRE(cache.is_good);
+
+    auto module_ = create_module(context, "f", 1);
+    CHECK(cache.key(*module_) == cache.key(*create_module(context, "f", 1)));
+    CHECK(cache.key(*module_) != cache.key(*create_module(context, "f", 2)));
+    CHECK(cache.key(*module_) != cache.key(*create_module(context, "g", 1)));
+
+    DiskObjectCache other_target{directory.path, DEFAULT_OBJECT_CACHE_SIZE, "other salt"};
+    CHECK(cache.key(*module_) != other_target.key(*module_));
+
+    CHECK(object_cache_salt("x86_64", "znver3", "", "-O2") !=
+        object_cache_salt("x86_64", "znver4", "", "-O2"));
+}
+
+TEST_CASE("DiskObjectCache should return what was stored for the same module") {
+    TemporaryDirectory directory{};
+    llvm::LLVMContext context{};
+    DiskObjectCache cache{directory.path, DEFAULT_OBJECT_CACHE_SIZE, "salt"};
+
+    Profiler::global.reset();
+    Profiler::global.enable();
+
+    auto module_ = create_module(context, "f", 1);
+    CHECK(!cache.getObject(module_.get()));
+    CHECK(Profiler::global.get_count(ProfilerCounter::object_cache_misses) == 1);
+
+    auto object = llvm::MemoryBuffer::getMemBuffer("not really an object", "object", false);
+    cache.notifyObjectCompiled(module_.get(), object->getMemBufferRef());
+    CHECK(filesystem::exists(cache.object_path(cache.key(*module_))));
+
+    // a different module with the same contents, e.g. from the next run
+    auto same_module = create_module(context, "f", 1);
+    auto cached = cache.getObject(same_module.get());
+    REQUIRE(cached);
+    CHECK(cached->getBuffer() == "not really an object");
+    CHECK(Profiler::global.get_count(ProfilerCounter::object_cache_hits) == 1);
+
+    CHECK(!cache.getObject(create_module(context, "f", 2).get()));
+    Profiler::global.enable(false);
+}
+
+TEST_CASE("DiskObjectCache should evict the least recently used objects") {
+    TemporaryDirectory directory{};
+    llvm::LLVMContext context{};
+
+    // room for two objects
+    const string object_contents(100, 'x');
+    DiskObjectCache cache{directory.path, 250, "salt"};
+
+    auto first = create_module(context, "first", 1);
+    auto second = create_module(context, "second", 2);
+    auto third = create_module(context, "third", 3);
+
+    auto object = llvm::MemoryBuffer::getMemBuffer(object_contents, "object", false);
+    auto store = [&cache, &object](const llvm::Module& module_, int age_in_seconds) {
+        cache.notifyObjectCompiled(&module_, object->getMemBufferRef());
+        filesystem::last_write_time(cache.object_path(cache.key(module_)),
+            filesystem::file_time_type::clock::now() - chrono::seconds{age_in_seconds});
+    };
+
+    store(*first, 20);
+    store(*second, 10);
+    CHECK(filesystem::exists(cache.object_path(cache.key(*first))));
+
+    store(*third, 0);
+    CHECK(!filesystem::exists(cache.object_path(cache.key(*first))));
+    CHECK(filesystem::exists(cache.object_path(cache.key(*second))));
+    CHECK(filesystem::exists(cache.object_path(cache.key(*third))));
+}
+
+TEST_CASE("Compiling through the DiskObjectCache should skip codegen the second time") {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto target_machine_builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+    REQUIRE(target_machine_builder);
+    auto target_machine = target_machine_builder->createTargetMachine();
+    REQUIRE(target_machine);
+
+    TemporaryDirectory directory{};
+    llvm::LLVMContext context{};
+    DiskObjectCache cache{directory.path, DEFAULT_OBJECT_CACHE_SIZE, "salt"};
+    llvm::orc::SimpleCompiler compiler{**target_machine, &cache};
+
+    Profiler::global.reset();
+    Profiler::global.enable();
+
+    auto compiled = compiler(*create_module(context, "f", 1));
+    REQUIRE(compiled);
+
+    auto cached = compiler(*create_module(context, "f", 1));
+    REQUIRE(cached);
+    CHECK((*cached)->getBuffer() == (*compiled)->getBuffer());
+
+    CHECK(Profiler::global.get_count(ProfilerCounter::object_cache_misses) == 1);
+    CHECK(Profiler::global.get_count(ProfilerCounter::object_cache_hits) == 1);
+    Profiler::global.enable(false);
+}
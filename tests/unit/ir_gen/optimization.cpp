@@ -0,0 +1,63 @@
+#include "doctest.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/DerivedTypes.h"
+
+#include "mapsc/llvm_ir_gen/optimization.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+namespace {
+
+// internal i32 callee() { ret 1 }, i32 caller() { ret callee() }
+void create_call_pair(llvm::LLVMContext& context, llvm::Module& module_) {
+    llvm::IRBuilder<> builder{context};
+    auto signature = llvm::FunctionType::get(builder.getInt32Ty(), {}, false);
+
+    auto callee = llvm::Function::Create(signature, llvm::Function::InternalLinkage,
+        "callee", module_);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", callee));
+    builder.CreateRet(builder.getInt32(1));
+
+    auto caller = llvm::Function::Create(signature, llvm::Function::ExternalLinkage,
+        "caller", module_);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", caller));
+    builder.CreateRet(builder.CreateCall(callee));
+}
+
+} // namespace
+
+TEST_CASE("parse_optimization_level should accept the -O levels") {
+    CHECK(parse_optimization_level("0") == OptimizationLevel::O0);
+    CHECK(parse_optimization_level("2") == OptimizationLevel::O2);
+    CHECK(parse_optimization_level("s") == OptimizationLevel::Os);
+    CHECK(!parse_optimization_level("4"));
+    CHECK(!parse_optimization_level(""));
+
+    CHECK(optimization_level_name(OptimizationLevel::O3) == "-O3");
+}
+
+TEST_CASE("optimize_module should only inline at levels above O0") {
+    llvm::LLVMContext context{};
+    llvm::Module module_{"test", context};
+    create_call_pair(context, module_);
+
+    SUBCASE("O0") {
+        optimize_module(module_, OptimizationLevel::O0);
+        CHECK(module_.getFunction("callee"));
+    }
+
+    SUBCASE("O2") {
+        optimize_module(module_, OptimizationLevel::O2);
+        CHECK(!module_.getFunction("callee"));
+
+        auto caller = module_.getFunction("caller");
+        REQUIRE(caller);
+        CHECK(caller->getInstructionCount() == 1);
+    }
+}
@@ -0,0 +1,151 @@
+#include "doctest.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/parallel_ir_gen.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+namespace {
+
+// a = 3, b = a + 4, c = b * 2, d = c + a
+array<DefinitionHeader*, 4> create_definitions(CompilationState& state) {
+    auto [a, a_body] = create_let_definition(*state.ast_store_, "a",
+        create_known_value(state, maps_Int{3}, TSL), TSL);
+
+    auto sum = create_call(state, &plus_Int, {*create_call(state, a, {}, TSL),
+        create_known_value(state, maps_Int{4}, TSL)}, TSL);
+    REQUIRE(sum);
+    auto [b, b_body] = create_let_definition(*state.ast_store_, "b", *sum, TSL);
+
+    auto product = create_call(state, &mult_Int, {*create_call(state, b, {}, TSL),
+        create_known_value(state, maps_Int{2}, TSL)}, TSL);
+    REQUIRE(product);
+    auto [c, c_body] = create_let_definition(*state.ast_store_, "c", *product, TSL);
+
+    auto total = create_call(state, &plus_Int, {*create_call(state, c, {}, TSL),
+        *create_call(state, a, {}, TSL)}, TSL);
+    REQUIRE(total);
+    auto [d, d_body] = create_let_definition(*state.ast_store_, "d", *total, TSL);
+
+    return {a, b, c, d};
+}
+
+// More than fit into one partition. Mostly each one calls the one before it, except that 
+// every tenth one calls one further along, for declarations both ways
+vector<DefinitionHeader*> create_chain(CompilationState& state, size_t count) {
+    vector<DefinitionHeader*> definitions(count, nullptr);
+
+    auto create = [&state, &definitions](size_t i, auto& create) -> DefinitionHeader* {
+        if (definitions[i])
+            return definitions[i];
+
+        Expression* body;
+        if (i % 10 == 5 || i == 0) {
+            body = create_known_value(state, static_cast<maps_Int>(i), TSL);
+        } else {
+            bool calls_forward = i % 10 == 0 && i + 5 < definitions.size();
+            DefinitionHeader* callee = create(calls_forward ? i + 5 : i - 1, create);
+            auto call = create_call(state, callee, {}, TSL);
+            REQUIRE(call);
+            auto sum = create_call(state, &plus_Int, {*call,
+                create_known_value(state, maps_Int{1}, TSL)}, TSL);
+            REQUIRE(sum);
+            body = *sum;
+        }
+
+        definitions[i] = create_let_definition(*state.ast_store_, "chain_" + to_string(i),
+            body, TSL).first;
+        return definitions[i];
+    };
+
+    for (size_t i = 0; i < count; i++)
+        create(i, create);
+
+    return definitions;
+}
+
+string print_module(const llvm::Module& module_) {
+    string text{};
+    llvm::raw_string_ostream stream{text};
+    module_.print(stream, nullptr);
+    return stream.str();
+}
+
+} // namespace
+
+TEST_CASE("Parallel ir gen should link the partitions into one module") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto definitions = create_definitions(state);
+
+    llvm::LLVMContext context{};
+    llvm::Module module_{"test", context};
+
+    REQUIRE(run_ir_gen_parallel(state, module_, definitions, 2, &llvm::errs(),
+        {.entry_point = "d"}));
+    CHECK(!llvm::verifyModule(module_, &llvm::errs()));
+
+    for (string name: {"a", "b", "c"}) {
+        auto function = module_.getFunction(name);
+        REQUIRE(function);
+        CHECK(!function->isDeclaration());
+        CHECK(function->hasInternalLinkage());
+    }
+
+    auto entry_point = module_.getFunction("d");
+    REQUIRE(entry_point);
+    CHECK(!entry_point->isDeclaration());
+    CHECK(entry_point->hasExternalLinkage());
+
+    // the builtins are linked in once, not once per partition
+    auto plus = module_.getFunction("+_Int_Int_Int");
+    REQUIRE(plus);
+    CHECK(!plus->isDeclaration());
+    CHECK(!module_.getFunction("+_Int_Int_Int.1"));
+}
+
+TEST_CASE("Parallel ir gen should give the same module for any thread count") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto definitions = create_chain(state, DEFINITIONS_PER_PARTITION * 3 + 7);
+
+    llvm::LLVMContext context{};
+    string expected{};
+
+    for (unsigned int thread_count: {1, 2, 3, 4, 8}) {
+        CAPTURE(thread_count);
+
+        llvm::Module module_{"test", context};
+        REQUIRE(run_ir_gen_parallel(state, module_, definitions, thread_count, &llvm::errs()));
+
+        for (auto definition: definitions) {
+            auto function = module_.getFunction(definition->name_string());
+            REQUIRE(function);
+            CHECK(!function->isDeclaration());
+        }
+
+        if (expected.empty()) {
+            expected = print_module(module_);
+            continue;
+        }
+
+        CHECK(print_module(module_) == expected);
+    }
+}
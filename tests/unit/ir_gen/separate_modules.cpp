@@ -0,0 +1,156 @@
+#include "doctest.h"
+
+#include <array>
+#include <memory>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "mapsc/source_location.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/llvm_ir_gen/ir_generator.hh"
+#include "mapsc/llvm_ir_gen/ir_builtins.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+TEST_CASE("Global definitions should be able to live in modules of their own") {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+    // declared first so that it outlives the modules
+    llvm::orc::ThreadSafeContext thread_safe_context{make_unique<llvm::LLVMContext>()};
+    llvm::LLVMContext* context = thread_safe_context.getContext();
+
+    // value = 3, caller = value + 4
+    auto [value, value_body] = create_let_definition(*state.ast_store_, "value",
+        create_known_value(state, maps_Int{3}, TSL), TSL);
+
+    auto value_call = create_call(state, value, {}, TSL);
+    REQUIRE(value_call);
+    auto sum = create_call(state, &plus_Int, {*value_call,
+        create_known_value(state, maps_Int{4}, TSL)}, TSL);
+    REQUIRE(sum);
+    auto [caller, caller_body] = create_let_definition(*state.ast_store_, "caller", *sum, TSL);
+
+    auto builtins = load_builtins(*context, state);
+    REQUIRE(builtins);
+
+    auto value_module = make_unique<llvm::Module>("value", *context);
+    {
+        IR_Generator generator{context, value_module.get(), &state, &llvm::errs(),
+            {.entry_point = "value"}};
+
+        REQUIRE(generator.run(std::array{value}));
+
+        auto function = value_module->getFunction("value");
+        REQUIRE(function);
+        CHECK(!function->isDeclaration());
+        CHECK(function->hasExternalLinkage());
+        CHECK(function->doesNotAccessMemory());
+    }
+
+    auto caller_module = make_unique<llvm::Module>("caller", *context);
+    {
+        IR_Generator generator{context, caller_module.get(), &state, &llvm::errs(),
+            {.entry_point = "caller"}};
+
+        REQUIRE(declare_builtins(generator));
+        REQUIRE(generator.declare_global_definition(*value));
+        REQUIRE(generator.run(std::array{caller}));
+        REQUIRE(link_builtins(generator, *builtins));
+
+        auto declaration = caller_module->getFunction("value");
+        REQUIRE(declaration);
+        CHECK(declaration->isDeclaration());
+        CHECK(declaration->hasExternalLinkage());
+        // the body it would go by is in the other module
+        CHECK(!declaration->onlyReadsMemory());
+
+        // the builtins are copies private to the module
+        auto plus = caller_module->getFunction("+_Int_Int_Int");
+        REQUIRE(plus);
+        CHECK(plus->hasInternalLinkage());
+
+        CHECK(!llvm::verifyModule(*caller_module, &llvm::errs()));
+    }
+
+    auto jit = llvm::orc::LLJITBuilder().create();
+    REQUIRE(jit);
+    REQUIRE(!(*jit)->addIRModule({std::move(value_module), thread_safe_context}));
+    REQUIRE(!(*jit)->addIRModule({std::move(caller_module), thread_safe_context}));
+
+    auto symbol = (*jit)->lookup("caller");
+    REQUIRE(symbol);
+    CHECK(symbol->toPtr<maps_Int(*)()>()() == 7);
+}
+
+TEST_CASE("Modules in contexts of their own should be able to call the builtins in a module of their own") {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    auto [state, types] = CompilationState::create_test_state();
+
+    // sum = 3 + 4, product = 2 * 5
+    auto sum_call = create_call(state, &plus_Int, {create_known_value(state, maps_Int{3}, TSL),
+        create_known_value(state, maps_Int{4}, TSL)}, TSL);
+    REQUIRE(sum_call);
+    auto [sum, sum_body] = create_let_definition(*state.ast_store_, "sum", *sum_call, TSL);
+
+    auto product_call = create_call(state, &mult_Int, {create_known_value(state, maps_Int{2}, TSL),
+        create_known_value(state, maps_Int{5}, TSL)}, TSL);
+    REQUIRE(product_call);
+    auto [product, product_body] = create_let_definition(*state.ast_store_, "product", 
+        *product_call, TSL);
+
+    auto jit = llvm::orc::LLJITBuilder().create();
+    REQUIRE(jit);
+
+    llvm::orc::ThreadSafeContext builtins_context{make_unique<llvm::LLVMContext>()};
+    auto builtins = load_builtins(*builtins_context.getContext(), state);
+    REQUIRE(builtins);
+    CHECK(builtins->getFunction("+_Int_Int_Int")->hasExternalLinkage());
+    REQUIRE(!(*jit)->addIRModule({std::move(builtins), builtins_context}));
+
+    for (DefinitionHeader* definition: std::array{sum, product}) {
+        llvm::orc::ThreadSafeContext module_context{make_unique<llvm::LLVMContext>()};
+        llvm::LLVMContext* context = module_context.getContext();
+
+        auto module_ = make_unique<llvm::Module>(definition->name_string(), *context);
+        IR_Generator generator{context, module_.get(), &state, &llvm::errs(),
+            {.entry_point = definition->name_string()}};
+
+        REQUIRE(declare_builtins(generator));
+        REQUIRE(generator.run(std::array{definition}));
+
+        // nothing gets copied in, the calls resolve to the builtins module
+        for (const llvm::Function& function: *module_) {
+            if (function.getName() != definition->name_string())
+                CHECK(function.isDeclaration());
+        }
+
+        CHECK(!llvm::verifyModule(*module_, &llvm::errs()));
+        REQUIRE(!(*jit)->addIRModule({std::move(module_), module_context}));
+    }
+
+    auto sum_symbol = (*jit)->lookup("sum");
+    REQUIRE(sum_symbol);
+    CHECK(sum_symbol->toPtr<maps_Int(*)()>()() == 7);
+
+    auto product_symbol = (*jit)->lookup("product");
+    REQUIRE(product_symbol);
+    CHECK(product_symbol->toPtr<maps_Int(*)()>()() == 10);
+}
@@ -0,0 +1,73 @@
+#include "doctest.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/DerivedTypes.h"
+
+#include "mapsc/llvm_ir_gen/target.hh"
+
+using namespace Maps;
+using namespace Maps::LLVM_IR;
+using namespace std;
+
+TEST_CASE("apply_target_option should handle -march, -mcpu and -mattr") {
+    CodegenTarget target{};
+
+    CHECK(apply_target_option(target, "-mcpu", "skylake"));
+    CHECK(target.cpu == "skylake");
+    CHECK(target.features.empty());
+
+    CHECK(apply_target_option(target, "-mattr", "+avx2"));
+    CHECK(apply_target_option(target, "-mattr", "-fma"));
+    CHECK(target.features == "+avx2,-fma");
+
+    CHECK(!apply_target_option(target, "-mtune", "skylake"));
+
+    SUBCASE("native") {
+        auto host = host_target();
+        REQUIRE(host);
+
+        CHECK(apply_target_option(target, "-march", "native"));
+        CHECK(target == *host);
+    }
+
+    SUBCASE("-march replaces the features with the cpu's own") {
+        CHECK(apply_target_option(target, "-march", "znver3"));
+        CHECK(target.cpu == "znver3");
+        CHECK(target.features.empty());
+    }
+}
+
+TEST_CASE("-mattr should add to the host's features rather than replace the host") {
+    auto host = host_target();
+    REQUIRE(host);
+
+    CodegenTarget target = *host;
+    CHECK(apply_target_option(target, "-mattr", "+avx2"));
+
+    CHECK(target.cpu == host->cpu);
+    CHECK(target.features.starts_with(host->features));
+    CHECK(target.features.ends_with("+avx2"));
+}
+
+TEST_CASE("record_target should mark the defined functions with the target") {
+    llvm::LLVMContext context{};
+    llvm::Module module_{"test", context};
+    llvm::IRBuilder<> builder{context};
+    auto signature = llvm::FunctionType::get(builder.getVoidTy(), {}, false);
+
+    auto declaration = llvm::Function::Create(signature, llvm::Function::ExternalLinkage,
+        "declaration", module_);
+    auto definition = llvm::Function::Create(signature, llvm::Function::ExternalLinkage,
+        "definition", module_);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", definition));
+    builder.CreateRetVoid();
+
+    record_target(module_, {"skylake", "+avx2"});
+
+    CHECK(definition->getFnAttribute("target-cpu").getValueAsString() == "skylake");
+    CHECK(definition->getFnAttribute("target-features").getValueAsString() == "+avx2");
+    CHECK(!declaration->hasFnAttribute("target-cpu"));
+}
@@ -1,6 +1,13 @@
 #include "doctest.h"
 
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+
 #include "mapsc/logging.hh"
+#include "mapsc/log_sink.hh"
+#include "mapsc/source_location.hh"
 
 using namespace Maps;
 
@@ -22,4 +29,215 @@ TEST_CASE("Lock should prevent setting options") {
     auto lock2 = LogStream::global.set_loglevel(LogLevel::error);
     
     CHECK((*lock)->options_->get_loglevel() == LogLevel::debug_extra);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Errors should never be compiled out") {
+    CHECK(LogInContext<LogContext::layer2>::is_enabled<LogLevel::compiler_error>);
+    CHECK(LogInContext<LogContext::layer2>::is_enabled<LogLevel::error>);
+    CHECK(LogInContext<LogContext::layer2>::is_enabled<LogLevel::debug_extra> == 
+        (MAX_LOGLEVEL == LogLevel::debug_extra));
+}
+
+TEST_CASE("Per-context ceilings should only lower the ceiling of their own context") {
+    constexpr auto log_levels = create_max_loglevels({{LogContext::lexer, LogLevel::info}});
+
+    CHECK(log_levels[static_cast<size_t>(LogContext::lexer)] == LogLevel::info);
+    CHECK(log_levels[static_cast<size_t>(LogContext::layer2)] == MAX_LOGLEVEL);
+}
+
+TEST_CASE("The lambda forms should only put the message together if it gets logged") {
+    using Log = LogInContext<LogContext::layer2>;
+
+    int calls = 0;
+    auto message = [&calls](auto& log) {
+        calls++;
+        log << "lambda form test" << Endl;
+    };
+
+    auto lock = LogStream::global.set_loglevel(LogContext::layer2, LogLevel::error);
+    REQUIRE(lock);
+
+    Log::debug(NO_SOURCE_LOCATION, message);
+    CHECK(calls == 0);
+
+    Log::error(NO_SOURCE_LOCATION, message);
+    CHECK(calls == 1);
+}
+
+TEST_CASE("Binary log records should survive a round trip") {
+    std::stringstream binary{};
+    LogRecord record{7, LogContext::layer2, LogLevel::warning, 12, 3, 0, "something happened\n"};
+
+    write_binary_header(binary);
+    write_binary_record(binary, record);
+
+    REQUIRE(read_binary_header(binary));
+    auto decoded = read_binary_record(binary);
+
+    REQUIRE(decoded);
+    CHECK(decoded->sequence == 7);
+    CHECK(decoded->context == LogContext::layer2);
+    CHECK(decoded->loglevel == LogLevel::warning);
+    CHECK(decoded->line == 12);
+    CHECK(decoded->column == 3);
+    CHECK(decoded->message == "something happened\n");
+}
+
+TEST_CASE("Decoding a binary log should produce the text format") {
+    std::stringstream binary{};
+    std::stringstream text{};
+    std::stringstream expected{};
+    LogRecord record{0, LogContext::lexer, LogLevel::error, 1, 2, 0, "bad token\n"};
+
+    write_binary_header(binary);
+    write_binary_record(binary, record);
+    write_text_record(expected, record);
+
+    CHECK(decode_binary_log(binary, text));
+    CHECK(text.str() == expected.str());
+
+    std::stringstream garbage{"definitely not a log"};
+    CHECK(!decode_binary_log(garbage, text));
+}
+
+TEST_CASE("Async LogStream should not lose or interleave messages from different threads") {
+    std::stringstream output{};
+    LogStream::Options options{};
+    options.inner_stream = &output;
+    LogStream stream{options};
+
+    stream.start_async();
+
+    auto log_lines = [&stream](int thread_id) {
+        for (int i = 0; i < 100; i++)
+            stream.begin(LogContext::no_context, LogLevel::info, {i, thread_id}) << 
+                "thread " << thread_id << " message " << i << Endl;
+
+        stream.flush();
+    };
+
+    std::thread first{log_lines, 1};
+    std::thread second{log_lines, 2};
+    first.join();
+    second.join();
+
+    stream.stop_async();
+
+    std::string line;
+    int line_count = 0;
+    while (std::getline(output, line)) {
+        CHECK(line.find("message") != std::string::npos);
+        line_count++;
+    }
+    CHECK(line_count == 200);
+}
+
+TEST_CASE("Async LogStream should write messages in the order they were started") {
+    std::stringstream output{};
+    LogStream::Options options{};
+    options.inner_stream = &output;
+    LogStream stream{options};
+
+    stream.start_async();
+
+    std::promise<void> logged{};
+    std::promise<void> exit{};
+
+    // keeps its message in its batch until it exits
+    std::thread first{[&stream, &logged, exit = exit.get_future()]() {
+        stream.begin(LogContext::no_context, LogLevel::info, {1, 1}) << "first" << Endl;
+        logged.set_value();
+        exit.wait();
+    }};
+
+    logged.get_future().wait();
+    stream.begin(LogContext::no_context, LogLevel::info, {2, 1}) << "second" << Endl;
+    stream.flush();
+
+    exit.set_value();
+    first.join();
+
+    stream.stop_async();
+
+    std::string text = output.str();
+    CHECK(text.find("first") != std::string::npos);
+    CHECK(text.find("first") < text.find("second"));
+}
+
+TEST_CASE("Async LogStream should not hold errors back behind other threads' batches") {
+    std::stringstream output{};
+    LogStream::Options options{};
+    options.inner_stream = &output;
+    LogStream stream{options};
+
+    stream.start_async();
+
+    std::promise<void> logged{};
+    std::promise<void> exit{};
+
+    std::thread first{[&stream, &logged, exit = exit.get_future()]() {
+        stream.begin(LogContext::no_context, LogLevel::info, {1, 1}) << "first" << Endl;
+        logged.set_value();
+        exit.wait();
+    }};
+
+    logged.get_future().wait();
+    stream.begin(LogContext::no_context, LogLevel::error, {2, 1}) << "second" << Endl;
+    stream.flush();
+
+    exit.set_value();
+    first.join();
+
+    stream.stop_async();
+
+    std::string text = output.str();
+    CHECK(text.find("first") != std::string::npos);
+    CHECK(text.find("second") < text.find("first"));
+}
+
+TEST_CASE("Text records should have context prefixes if asked to") {
+    LogRecord record{0, LogContext::lexer, LogLevel::error, 1, 2, 0, "bad token\n"};
+
+    std::stringstream without{};
+    write_text_record(without, record);
+    CHECK(without.str().find(context_prefix(LogContext::lexer)) == std::string::npos);
+
+    std::stringstream with{};
+    write_text_record(with, record, true);
+    CHECK(with.str().find(std::string{context_prefix(LogContext::lexer)} + "bad token") != 
+        std::string::npos);
+}
+
+TEST_CASE("Captured messages should be written out in the order they're replayed") {
+    std::stringstream output{};
+    LogStream::Options options{};
+    options.inner_stream = &output;
+    LogStream stream{options};
+
+    std::vector<LogRecord> first_records{};
+    std::vector<LogRecord> second_records{};
+
+    std::thread second{[&stream, &second_records]() {
+        LogStream::Capture capture{stream};
+        stream.begin(LogContext::no_context, LogLevel::error, {2, 1}) << "second" << Endl;
+        second_records = capture.take();
+    }};
+    second.join();
+
+    {
+        LogStream::Capture capture{stream};
+        stream.begin(LogContext::no_context, LogLevel::error, {1, 1}) << "first" << Endl;
+        first_records = capture.take();
+    }
+
+    CHECK(output.str().empty());
+    REQUIRE(first_records.size() == 1);
+    REQUIRE(second_records.size() == 1);
+
+    stream.write_records(std::move(first_records));
+    stream.write_records(std::move(second_records));
+
+    std::string text = output.str();
+    CHECK(text.find("first") != std::string::npos);
+    CHECK(text.find("first") < text.find("second"));
+}
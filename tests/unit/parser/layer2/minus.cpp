@@ -185,4 +185,71 @@ TEST_CASE("Minus as a binop should force rhs unary minus into unary call ") {
     auto [rhs_callee, rhs_args] = rhs->call_value();
 
     CHECK(*rhs_callee == *state.special_definitions_.unary_minus);
-}
\ No newline at end of file
+}
+TEST_CASE("Leading unary minus should start an operator chain") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto plus = create_testing_binary_operator(ast_store, "+", &IntInt_to_Int, 2, 
+        Operator::Associativity::left, TSL);
+    auto times = create_testing_binary_operator(ast_store, "*", &IntInt_to_Int, 3, 
+        Operator::Associativity::left, TSL);
+
+    auto minus = create_minus_sign(ast_store, TSL);
+    auto value1 = create_numeric_literal(ast_store, "7", TSL);
+    auto plus_ref = create_operator_reference(ast_store, plus, TSL);
+    auto value2 = create_numeric_literal(ast_store, "2", TSL);
+    auto times_ref = create_operator_reference(ast_store, times, TSL);
+    auto value3 = create_numeric_literal(ast_store, "3", TSL);
+
+    // -7 + 2 * 3
+    auto expr = create_layer2_expression_testing(ast_store, 
+        {minus, value1, plus_ref, value2, times_ref, value3}, TSL);
+
+    CHECK(run_layer2(state, expr));
+    REQUIRE(expr->expression_type == ExpressionType::call);
+
+    auto [callee, args] = expr->call_value();
+    CHECK(callee == plus);
+
+    // the leading minus becomes a unary call on just the first value
+    auto [lhs_callee, lhs_args] = args.at(0)->call_value();
+    REQUIRE(lhs_args.size() == 1);
+    CHECK(lhs_args.at(0) == value1);
+
+    auto [rhs_callee, rhs_args] = args.at(1)->call_value();
+    CHECK(rhs_callee == times);
+    CHECK(rhs_args.at(0) == value2);
+    CHECK(rhs_args.at(1) == value3);
+}
+
+TEST_CASE("Leading unary minus followed by a binary minus should start an operator chain") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto minus1 = create_minus_sign(ast_store, TSL);
+    auto value1 = create_numeric_literal(ast_store, "7", TSL);
+    auto minus2 = create_minus_sign(ast_store, TSL);
+    auto value2 = create_numeric_literal(ast_store, "2", TSL);
+    auto minus3 = create_minus_sign(ast_store, TSL);
+    auto value3 = create_numeric_literal(ast_store, "3", TSL);
+
+    // -7 - 2 - 3
+    auto expr = create_layer2_expression_testing(ast_store, 
+        {minus1, value1, minus2, value2, minus3, value3}, TSL);
+
+    CHECK(run_layer2(state, expr));
+    REQUIRE(expr->expression_type == ExpressionType::call);
+
+    auto [callee, args] = expr->call_value();
+    CHECK(callee == state.special_definitions_.binary_minus);
+    CHECK(args.at(1) == value3);
+
+    auto [lhs_callee, lhs_args] = args.at(0)->call_value();
+    CHECK(lhs_callee == state.special_definitions_.binary_minus);
+    CHECK(lhs_args.at(1) == value2);
+
+    auto [inner_callee, inner_args] = lhs_args.at(0)->call_value();
+    REQUIRE(inner_args.size() == 1);
+    CHECK(inner_args.at(0) == value1);
+}
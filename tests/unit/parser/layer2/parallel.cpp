@@ -0,0 +1,100 @@
+#include "doctest.h"
+
+#include <array>
+#include <vector>
+
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/ast/layer2_expression.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/test_helpers/test_definition.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/parser/layer2.hh"
+
+using namespace Maps;
+using namespace std;
+
+namespace {
+
+// creates 1 + 2 * 3 with fresh terms, like layer1 would
+Expression* create_binop_expression(CompilationState& state, const Operator* plus, 
+    const Operator* times) {
+
+    auto& ast_store = *state.ast_store_;
+    return create_layer2_expression_testing(ast_store, {
+        create_numeric_literal(ast_store, "1", TSL),
+        create_operator_reference(ast_store, plus, TSL),
+        create_numeric_literal(ast_store, "2", TSL),
+        create_operator_reference(ast_store, times, TSL),
+        create_numeric_literal(ast_store, "3", TSL)
+    }, TSL);
+}
+
+} // namespace
+
+TEST_CASE("Layer2 expressions nested in each other should be grouped together") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto inner = create_layer2_expression_testing(ast_store, 
+        {create_numeric_literal(ast_store, "1", TSL)}, TSL);
+    auto outer = create_layer2_expression_testing(ast_store, {inner}, TSL);
+    auto independent = create_layer2_expression_testing(ast_store, 
+        {create_numeric_literal(ast_store, "2", TSL)}, TSL);
+
+    auto shared_term = create_numeric_literal(ast_store, "3", TSL);
+    auto sharing1 = create_layer2_expression_testing(ast_store, {shared_term}, TSL);
+    auto sharing2 = create_layer2_expression_testing(ast_store, {shared_term}, TSL);
+
+    // the nested one comes first like it would from layer1
+    auto groups = group_layer2_expressions({inner, sharing1, outer, independent, sharing2});
+
+    REQUIRE(groups.size() == 3);
+    CHECK(groups.at(0) == vector<Expression*>{inner, outer});
+    CHECK(groups.at(1) == vector<Expression*>{sharing1, sharing2});
+    CHECK(groups.at(2) == vector<Expression*>{independent});
+}
+
+TEST_CASE("Parallel layer2 should parse the same as the serial one") {
+    auto [state, types] = CompilationState::create_test_state();
+
+    const Type* type = types->get_function_type(&NumberLiteral, 
+        array{&NumberLiteral, &NumberLiteral}, true);
+    auto plus = create_testing_binary_operator(*state.ast_store_, "+", type, 500, TSL);
+    auto times = create_testing_binary_operator(*state.ast_store_, "*", type, 600, TSL);
+
+    vector<Expression*> expressions{};
+    for (int i = 0; i < 200; i++)
+        expressions.push_back(create_binop_expression(state, plus, times));
+
+    size_t nodes_before = state.ast_store_->size();
+
+    CHECK(run_layer2_parallel(state, expressions, 4));
+    CHECK(state.ast_store_->size() > nodes_before);
+
+    for (Expression* expression: expressions) {
+        REQUIRE(expression->expression_type == ExpressionType::call);
+
+        auto [callee, args] = expression->call_value();
+        CHECK(callee == plus);
+        CHECK(args.at(1)->expression_type == ExpressionType::call);
+        CHECK(std::get<0>(args.at(1)->call_value()) == times);
+    }
+}
+
+TEST_CASE("Parallel layer2 should report failure") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto value = create_numeric_literal(ast_store, "23", TSL);
+
+    vector<Expression*> expressions{};
+    for (int i = 0; i < 10; i++)
+        expressions.push_back(create_layer2_expression_testing(ast_store, 
+            {create_numeric_literal(ast_store, "1", TSL)}, TSL));
+
+    expressions.push_back(create_layer2_expression_testing(ast_store, {value, value, value}, TSL));
+
+    CHECK(!run_layer2_parallel(state, expressions, 4));
+    CHECK(expressions.front()->expression_type == ExpressionType::known_value);
+}
@@ -208,3 +208,85 @@ TEST_CASE ("should handle more complex expressions") {
         CHECK(output.str() == expected_pre_order);
     }
 }
+
+TEST_CASE("should handle long operator chains") {
+    auto [state, _0] = CompilationState::create_test_state();
+    AST_Store& ast = *state.ast_store_;
+
+    constexpr size_t OPERATOR_COUNT = 10'000;
+
+    auto [op1_ref, op1] = create_operator_helper(state, "1", 1);
+    auto [op2_ref, op2] = create_operator_helper(state, "2", 2);
+    Expression* val = create_numeric_literal(ast, "v", {0,0});
+
+    Expression* expr = create_layer2_expression_testing(ast, {}, {0,0});
+
+    // v 1 v 2 v 1 v 2 v ..., i.e. a left leaning chain of 1s with a 2 as the rhs of each
+    string input{};
+    for (size_t i = 0; i < OPERATOR_COUNT; i++)
+        input += i % 2 == 0 ? '1' : '2';
+
+    prime_terms(expr, input, op1_ref, op2_ref, nullptr, val);
+
+    CHECK(run_layer2(state, expr));
+    REQUIRE(expr->expression_type == ExpressionType::call);
+
+    size_t op1_count = 0;
+    Expression* spine = expr;
+    while (spine->expression_type == ExpressionType::call) {
+        auto [op, args] = spine->call_value();
+        REQUIRE(op == op1);
+
+        Expression* rhs = args.at(1);
+        if (rhs->expression_type == ExpressionType::call) {
+            auto [rhs_op, rhs_args] = rhs->call_value();
+            CHECK(rhs_op == op2);
+            CHECK(rhs_args.at(0) == val);
+            CHECK(rhs_args.at(1) == val);
+        }
+
+        op1_count++;
+        spine = args.at(0);
+    }
+
+    CHECK(spine == val);
+    CHECK(op1_count == OPERATOR_COUNT / 2);
+}
+
+TEST_CASE("should handle deeply nested operator chains") {
+    auto [state, _0] = CompilationState::create_test_state();
+    AST_Store& ast = *state.ast_store_;
+
+    constexpr size_t DEPTH = 500;
+
+    auto [op1_ref, op1] = create_operator_helper(state, "1", 1);
+    auto [op2_ref, op2] = create_operator_helper(state, "2", 2);
+    Expression* val = create_numeric_literal(ast, "v", {0,0});
+
+    // v 2 v 1 (v 2 v 1 (v 2 v 1 (...)))
+    Expression* expr = create_layer2_expression_testing(ast, {val, op2_ref, val}, {0,0});
+    for (size_t i = 1; i < DEPTH; i++)
+        expr = create_layer2_expression_testing(ast, {val, op2_ref, val, op1_ref, expr}, {0,0});
+
+    CHECK(run_layer2(state, expr));
+
+    size_t depth = 1;
+    Expression* spine = expr;
+    while (true) {
+        REQUIRE(spine->expression_type == ExpressionType::call);
+        auto [op, args] = spine->call_value();
+
+        if (op == op2)
+            break;
+
+        REQUIRE(op == op1);
+
+        auto [lhs_op, lhs_args] = args.at(0)->call_value();
+        CHECK(lhs_op == op2);
+
+        depth++;
+        spine = args.at(1);
+    }
+
+    CHECK(depth == DEPTH);
+}
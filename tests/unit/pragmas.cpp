@@ -11,6 +11,57 @@ TEST_CASE("pragma should be created empty") {
     CHECK(pragmas.size() == 0);
 }
 
+TEST_CASE("pragma flags should have their default value before being set") {
+    PragmaStore pragmas{};
+
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::top_level_evaluation_context, {1, 1}));
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::top_level_evaluation_context, NO_SOURCE_LOCATION));
+}
+
+TEST_CASE("pragma flags should take effect from the declaration onwards") {
+    PragmaStore pragmas{};
+
+    CHECK(pragmas.set_flag("top-level evaluation", true, {3, 1}));
+    CHECK(pragmas.set_flag(PragmaFlagId::top_level_evaluation_context, false, {10, 1}));
+    CHECK(pragmas.size() == 2);
+
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::top_level_evaluation_context, {2, 5}));
+    CHECK(pragmas.check_flag_value(PragmaFlagId::top_level_evaluation_context, {3, 1}));
+    CHECK(pragmas.check_flag_value(PragmaFlagId::top_level_evaluation_context, {7, 2}));
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::top_level_evaluation_context, {10, 1}));
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::mutable_global_variables, {7, 2}));
+}
+
+TEST_CASE("pragma declarations can be added out of order") {
+    PragmaStore pragmas{};
+
+    CHECK(pragmas.set_flag(PragmaFlagId::mutable_global_variables, false, {10, 1}));
+    CHECK(pragmas.set_flag(PragmaFlagId::mutable_global_variables, true, {3, 1}));
+
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::mutable_global_variables, {1, 1}));
+    CHECK(pragmas.check_flag_value(PragmaFlagId::mutable_global_variables, {5, 1}));
+    CHECK(!pragmas.check_flag_value(PragmaFlagId::mutable_global_variables, {11, 1}));
+}
+
+TEST_CASE("setting an unknown pragma or a value of the wrong type should fail") {
+    PragmaStore pragmas{};
+
+    CHECK(!pragmas.set_flag("no such pragma", true, {1, 1}));
+    CHECK(!pragmas.set_flag(PragmaFlagId::mutable_global_variables, maps_Int{3}, {1, 1}));
+    CHECK(pragmas.empty());
+}
+
+TEST_CASE("flags_at should collect the bool flags at a location") {
+    PragmaStore pragmas{};
+
+    CHECK(pragmas.set_flag(PragmaFlagId::mutable_global_variables, true, {3, 1}));
+
+    auto flag_set = pragmas.flags_at({4, 1});
+    CHECK(flag_set.test(static_cast<size_t>(PragmaFlagId::mutable_global_variables)));
+    CHECK(!flag_set.test(static_cast<size_t>(PragmaFlagId::top_level_evaluation_context)));
+    CHECK(pragmas.flags_at({2, 1}).none());
+}
+
 // !!! known issue
 // TEST_CASE("pragmas should work with multiple files") {
 
@@ -0,0 +1,210 @@
+#include "doctest.h"
+
+#include <variant>
+
+#include "mapsc/types/type_store.hh"
+#include "mapsc/ast/definition.hh"
+#include "mapsc/ast/function_definition.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/statement.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/procedures/cse.hh"
+#include "mapsc/procedures/inline.hh"
+
+#include "unit/procedures/test_helpers.hh"
+
+using namespace Maps;
+using Maps::Tests::create_raw_call;
+using namespace std;
+
+namespace {
+
+// x + 1
+Expression* create_increment(CompilationState& state, const DefinitionHeader* x) {
+    return create_raw_call(*state.ast_store_, &plus_Int_,
+        {create_reference(*state.ast_store_, x, TSL), create_known_value(state, 1, TSL)});
+}
+
+DefinitionBody* create_function(CompilationState& state, DefinitionHeader* x, Expression* value) {
+    auto [header, body] = function_definition(state, {x}, nullptr, value, false, TSL);
+    body->set_type(state.types_->get_function_type(&Int, {&Int}, true));
+    return body;
+}
+
+} // namespace
+
+TEST_CASE("Structurally equal expressions should hash the same") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto x = create_parameter(ast_store, "x", &Int, TSL);
+    auto y = create_parameter(ast_store, "y", &Int, TSL);
+
+    Expression* lhs = create_increment(state, x);
+    Expression* rhs = create_increment(state, x);
+
+    CHECK(lhs != rhs);
+    CHECK(structurally_equal(*lhs, *rhs));
+    CHECK(structural_hash(*lhs) == structural_hash(*rhs));
+
+    SUBCASE("different arguments") {
+        Expression* other = create_increment(state, y);
+        CHECK(!structurally_equal(*lhs, *other));
+        CHECK(structural_hash(*lhs) != structural_hash(*other));
+    }
+
+    SUBCASE("different callees") {
+        Expression* other = create_raw_call(ast_store, &minus_Int_,
+            {create_reference(ast_store, x, TSL), create_known_value(state, 1, TSL)});
+        CHECK(!structurally_equal(*lhs, *other));
+    }
+
+    SUBCASE("different values") {
+        Expression* other = create_raw_call(ast_store, &plus_Int_,
+            {create_reference(ast_store, x, TSL), create_known_value(state, 2, TSL)});
+        CHECK(!structurally_equal(*lhs, *other));
+    }
+}
+
+TEST_CASE("structural_hash and structurally_equal should handle deeply nested expressions") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto x = create_parameter(ast_store, "x", &Int, TSL);
+
+    // x + 1 + 1 + ... nested deeper than the stack would allow recursing into
+    auto create_chain = [&state, &ast_store, x](maps_Int first) {
+        Expression* expression = create_reference(ast_store, x, TSL);
+        for (size_t i = 0; i < 100000; i++)
+            expression = create_raw_call(ast_store, &plus_Int_,
+                {expression, create_known_value(state, i == 0 ? first : 1, TSL)});
+        return expression;
+    };
+
+    Expression* lhs = create_chain(1);
+    Expression* rhs = create_chain(1);
+    Expression* other = create_chain(2);
+
+    CHECK(structurally_equal(*lhs, *rhs));
+    CHECK(structural_hash(*lhs) == structural_hash(*rhs));
+    CHECK(!structurally_equal(*lhs, *other));
+    CHECK(structural_hash(*lhs) != structural_hash(*other));
+}
+
+TEST_CASE("CSE should hoist repeated pure calls into a binding") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    // \(x: Int) -> (x + 1) * (x + 1)
+    auto x = create_parameter(ast_store, "x", &Int, TSL);
+    Expression* value = create_raw_call(ast_store, &mult_Int_,
+        {create_increment(state, x), create_increment(state, x)});
+    auto definition = create_function(state, x, value);
+
+    // it would be left for the inliner otherwise
+    state.compiler_options_.inline_budget = 0;
+
+    Profiler::global.reset();
+    Profiler::global.enable();
+
+    auto stats = eliminate_common_subexpressions(state, *definition);
+    CHECK(stats.bindings_created == 1);
+    CHECK(stats.calls_eliminated == 1);
+    CHECK(Profiler::global.get_count(ProfilerCounter::calls_eliminated) == 1);
+
+    REQUIRE(std::holds_alternative<Statement*>(definition->body()));
+    Statement* body = std::get<Statement*>(definition->body());
+    REQUIRE(body->statement_type == StatementType::block);
+
+    const auto& block = body->get_value<Block>();
+    REQUIRE(block.size() == 2);
+    REQUIRE(block.at(0)->statement_type == StatementType::assignment);
+    REQUIRE(block.at(1)->statement_type == StatementType::return_);
+
+    auto [identifier, binding] = block.at(0)->get_value<Assignment>();
+    REQUIRE(std::holds_alternative<Expression*>(binding->body()));
+    CHECK(structurally_equal(*std::get<Expression*>(binding->body()),
+        *create_increment(state, x)));
+
+    CHECK(std::get<Expression*>(block.at(1)->value) == value);
+    for (auto arg: std::get<1>(value->call_value())) {
+        CHECK(arg->expression_type == ExpressionType::reference);
+        CHECK(arg->reference_value() == binding->header_);
+    }
+
+    // nothing left to do
+    CHECK(eliminate_common_subexpressions(state, *definition).bindings_created == 0);
+}
+
+TEST_CASE("CSE should leave calls it can't prove to be the same alone") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+    state.compiler_options_.inline_budget = 0;
+
+    auto x = create_parameter(ast_store, "x", &Int, TSL);
+
+    SUBCASE("impure callee") {
+        auto [impure, impure_body] = create_let_definition(ast_store,
+            state.types_->get_function_type(&Int, {&Int}, false), TSL);
+
+        auto definition = create_function(state, x, create_raw_call(ast_store, &plus_Int_, {
+            create_raw_call(ast_store, impure, {create_reference(ast_store, x, TSL)}),
+            create_raw_call(ast_store, impure, {create_reference(ast_store, x, TSL)})
+        }));
+
+        CHECK(eliminate_common_subexpressions(state, *definition).calls_eliminated == 0);
+        CHECK(std::holds_alternative<Expression*>(definition->body()));
+    }
+
+    SUBCASE("ternary branches") {
+        Expression* ternary = ast_store.allocate_expression(Expression{
+            ExpressionType::ternary_expression,
+            TernaryExpressionValue{create_known_value(state, true, TSL),
+                create_increment(state, x), create_increment(state, x)},
+            &Int, TSL});
+
+        auto definition = create_function(state, x, ternary);
+
+        CHECK(eliminate_common_subexpressions(state, *definition).calls_eliminated == 0);
+        CHECK(std::holds_alternative<Expression*>(definition->body()));
+    }
+
+    SUBCASE("value definitions") {
+        auto [header, definition] = create_let_definition(ast_store, "value",
+            create_raw_call(ast_store, &plus_Int_,
+                {create_increment(state, x), create_increment(state, x)}), TSL);
+
+        CHECK(eliminate_common_subexpressions(state, *definition).calls_eliminated == 0);
+        CHECK(std::holds_alternative<Expression*>(definition->body()));
+    }
+}
+
+TEST_CASE("CSE should leave expression bodies that fit in the inline budget to the inliner") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    // \(x: Int) -> (x + 1) * (x + 1)
+    auto x = create_parameter(ast_store, "x", &Int, TSL);
+    Expression* value = create_raw_call(ast_store, &mult_Int_,
+        {create_increment(state, x), create_increment(state, x)});
+    auto definition = create_function(state, x, value);
+
+    auto cost = inline_cost(*definition);
+    REQUIRE(cost);
+    state.compiler_options_.inline_budget = *cost;
+
+    CHECK(eliminate_common_subexpressions(state, *definition).bindings_created == 0);
+    REQUIRE(std::holds_alternative<Expression*>(definition->body()));
+    CHECK(std::get<Expression*>(definition->body()) == value);
+
+    state.compiler_options_.inline_budget = *cost - 1;
+    CHECK(eliminate_common_subexpressions(state, *definition).bindings_created == 1);
+    CHECK(std::holds_alternative<Statement*>(definition->body()));
+}
@@ -0,0 +1,164 @@
+#include "doctest.h"
+
+#include <limits>
+#include <string>
+
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/statement.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/procedures/evaluate.hh"
+#include "mapsc/types/type_defs.hh"
+
+#include "unit/procedures/test_helpers.hh"
+
+using namespace Maps;
+using Maps::Tests::create_raw_call;
+using namespace std;
+
+namespace {
+
+Expression* create_int(CompilationState& state, maps_Int value) {
+    return create_known_value(state, value, TSL);
+}
+
+} // namespace
+
+TEST_CASE("fold_constants should fold nested Int arithmetic bottom-up") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    // 2 * 3 + 4
+    Expression* product = create_raw_call(ast_store, &mult_Int_,
+        {create_int(state, 2), create_int(state, 3)}, &Int);
+    Expression* sum = create_raw_call(ast_store, &plus_Int_,
+        {product, create_int(state, 4)}, &Int);
+
+    CHECK(evaluate(*sum) == KnownValue{10});
+
+    CHECK(fold_constants(state, *product));
+    CHECK(fold_constants(state, *sum));
+
+    CHECK(sum->expression_type == ExpressionType::known_value);
+    CHECK(*sum->type == Int);
+    CHECK(std::get<maps_Int>(sum->value) == 10);
+
+    CHECK(!fold_constants(state, *sum));
+}
+
+TEST_CASE("Int arithmetic should wrap around when folded") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Expression* overflow = create_raw_call(ast_store, &plus_Int_,
+        {create_int(state, numeric_limits<maps_Int>::max()), create_int(state, 1)}, &Int);
+    CHECK(evaluate(*overflow) == KnownValue{numeric_limits<maps_Int>::min()});
+
+    Expression* negation = create_raw_call(ast_store, &unary_minus_Int_,
+        {create_int(state, numeric_limits<maps_Int>::min())}, &Int);
+    CHECK(evaluate(*negation) == KnownValue{numeric_limits<maps_Int>::min()});
+}
+
+TEST_CASE("fold_constants should leave calls with runtime arguments alone") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Expression* unknown = ast_store.allocate_expression(
+        Expression{ExpressionType::missing_arg, &Int, TSL});
+    Expression* sum = create_raw_call(ast_store, &plus_Int_,
+        {unknown, create_int(state, 4)}, &Int);
+
+    CHECK(!evaluate(*sum));
+    CHECK(!fold_constants(state, *sum));
+    CHECK(sum->expression_type == ExpressionType::call);
+
+    // an unconcretized NumberLiteral isn't an Int yet
+    Expression* literal_sum = create_raw_call(ast_store, &plus_Int_,
+        {create_numeric_literal(ast_store, "1", TSL), create_int(state, 4)}, &Int);
+    CHECK(!fold_constants(state, *literal_sum));
+}
+
+TEST_CASE("fold_constants should fold casts to plain values but not to MutString") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Expression* to_float = create_raw_call(ast_store, &to_Float_Int,
+        {create_int(state, 3)}, &Float);
+    CHECK(fold_constants(state, *to_float));
+    CHECK(*to_float->type == Float);
+    CHECK(std::get<maps_Float>(to_float->value) == 3.0);
+
+    Expression* to_string = create_raw_call(ast_store, &to_String_Boolean,
+        {create_known_value(state, true, TSL)}, &String);
+    CHECK(fold_constants(state, *to_string));
+    CHECK(to_string->string_value() == "true");
+
+    Expression* to_mut_string = create_raw_call(ast_store, &to_MutString_Int,
+        {create_int(state, 3)}, &MutString);
+    CHECK(!fold_constants(state, *to_mut_string));
+}
+
+TEST_CASE("Folded calls should be memoized by callee and arguments") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+    auto& cache = *state.constant_folds_;
+
+    for (int i = 0; i < 3; i++) {
+        Expression* product = create_raw_call(ast_store, &mult_Int_,
+            {create_int(state, 6), create_int(state, 7)}, &Int);
+        CHECK(fold_constants(state, *product));
+        CHECK(std::get<maps_Int>(product->value) == 42);
+    }
+
+    Expression* other = create_raw_call(ast_store, &mult_Int_,
+        {create_int(state, 7), create_int(state, 6)}, &Int);
+    CHECK(fold_constants(state, *other));
+
+    CHECK(cache.size() == 2);
+    CHECK(cache.hits() == 2);
+
+    // copies of the state share the results
+    CompilationState copy = state;
+    CHECK(copy.constant_folds_->size() == 2);
+}
+
+TEST_CASE("Ternaries and conditionals with known conditions should fold into a branch") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Expression* success = create_int(state, 1);
+    Expression* failure = create_raw_call(ast_store, &plus_Int_,
+        {ast_store.allocate_expression(Expression{ExpressionType::missing_arg, &Int, TSL}),
+            create_int(state, 2)}, &Int);
+
+    Expression* ternary = ast_store.allocate_expression(Expression{
+        ExpressionType::ternary_expression,
+        TernaryExpressionValue{create_known_value(state, false, TSL), success, failure},
+        &Int, TSL});
+
+    CHECK(fold_constants(state, *ternary));
+    CHECK(ternary->expression_type == ExpressionType::call);
+    CHECK(*ternary == *failure);
+
+    Statement* body = create_expression_statement(ast_store, create_int(state, 5), TSL);
+
+    SUBCASE("true condition") {
+        Statement* conditional = ast_store.allocate_statement(Statement{
+            StatementType::conditional,
+            ConditionalValue{create_known_value(state, true, TSL), body}, &Void, TSL});
+
+        CHECK(fold_constants(state, *conditional));
+        CHECK(conditional->statement_type == StatementType::expression_statement);
+    }
+
+    SUBCASE("false condition without an else branch") {
+        Statement* conditional = ast_store.allocate_statement(Statement{
+            StatementType::conditional,
+            ConditionalValue{create_known_value(state, false, TSL), body}, &Void, TSL});
+
+        CHECK(fold_constants(state, *conditional));
+        CHECK(conditional->statement_type == StatementType::empty);
+    }
+}
@@ -10,10 +10,18 @@
 #include "mapsc/ast/reference.hh"
 #include "mapsc/ast/call_expression.hh"
 #include "mapsc/ast/value.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/let_definition.hh"
 #include "mapsc/compilation_state.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/builtins.hh"
+#include "mapsc/procedures/evaluate.hh"
 #include "mapsc/procedures/inline.hh"
 
+#include "unit/procedures/test_helpers.hh"
+
 using namespace Maps;
+using Maps::Tests::create_raw_call;
 using namespace std;
 
 namespace {
@@ -28,6 +36,20 @@ std::tuple<CompilationState, std::shared_ptr<AST_Store>, std::unique_ptr<TypeSto
     };
 }
 
+// \(x: Int) -> x + x
+std::pair<DefinitionHeader*, DefinitionBody*> create_doubling_function(CompilationState& state, 
+    bool is_pure = true) {
+
+    auto& ast_store = *state.ast_store_;
+    auto x = create_parameter(ast_store, "x", &Int, TSL);
+    auto value = create_raw_call(ast_store, &plus_Int_, 
+        {create_reference(ast_store, x, TSL), create_reference(ast_store, x, TSL)});
+
+    auto [header, body] = function_definition(state, {x}, nullptr, value, false, TSL);
+    body->set_type(state.types_->get_function_type(&Int, {&Int}, is_pure));
+    return {header, body};
+}
+
 } // namespace
 
 #define COMMON_TESTS(function)\
@@ -102,4 +124,149 @@ TEST_CASE("Should not be able to inline a nullary call to a nullary impure funct
 
     CHECK(!inline_call(ref, *body));
     CHECK(ref != *value);
-}
\ No newline at end of file
+}
+TEST_CASE("inline_cost should count the nodes in a function body") {
+    auto [state, ast_store, types] = setup();
+    auto [header, body] = create_doubling_function(state);
+
+    CHECK(body->parameters().size() == 1);
+    CHECK(inline_cost(*body) == 3);
+}
+
+TEST_CASE("Calls to small pure functions should be inlined with the arguments substituted") {
+    auto [state, ast_store, types] = setup();
+    auto [header, body] = create_doubling_function(state);
+    auto original_body = *std::get<Expression*>(body->body());
+
+    auto arg = create_known_value(state, maps_Int{5}, TSL);
+    auto call = create_raw_call(*ast_store, header, {arg});
+
+    CHECK(try_inline_call(state, *call, 32, {}) == InlineDecision::inlined);
+
+    REQUIRE(call->expression_type == ExpressionType::call);
+    CHECK(*call->type == Int);
+    CHECK(std::get<0>(call->call_value())->name_view() == plus_Int_.name_view());
+
+    auto args = std::get<1>(call->call_value());
+    REQUIRE(args.size() == 2);
+    CHECK(*args.at(0) == *arg);
+    CHECK(*args.at(1) == *arg);
+    // later transforms modify the nodes in place so each use gets its own copy
+    CHECK(args.at(0) != arg);
+    CHECK(args.at(0) != args.at(1));
+
+    CHECK(*std::get<Expression*>(body->body()) == original_body);
+    CHECK(evaluate(*call) == KnownValue{maps_Int{10}});
+}
+
+TEST_CASE("The inliner should leave impure, recursive and too big functions alone") {
+    auto [state, ast_store, types] = setup();
+    auto arg = create_known_value(state, maps_Int{5}, TSL);
+
+    SUBCASE("impure") {
+        auto [header, body] = create_doubling_function(state, false);
+        auto call = create_raw_call(*ast_store, header, {arg});
+        CHECK(try_inline_call(state, *call, 32, {}) == InlineDecision::impure);
+    }
+
+    SUBCASE("over budget") {
+        auto [header, body] = create_doubling_function(state);
+        auto call = create_raw_call(*ast_store, header, {arg});
+        CHECK(try_inline_call(state, *call, 2, {}) == InlineDecision::over_budget);
+        CHECK(std::get<0>(call->call_value()) == header);
+    }
+
+    SUBCASE("duplicated arguments count towards the cost") {
+        auto [header, body] = create_doubling_function(state);
+        auto big_arg = create_raw_call(*ast_store, &plus_Int_, {arg, arg});
+        auto call = create_raw_call(*ast_store, header, {big_arg});
+        CHECK(try_inline_call(state, *call, 5, {}) == InlineDecision::over_budget);
+        CHECK(try_inline_call(state, *call, 6, {}) == InlineDecision::inlined);
+    }
+
+    SUBCASE("already being inlined") {
+        auto [header, body] = create_doubling_function(state);
+        auto call = create_raw_call(*ast_store, header, {arg});
+        std::array<const DefinitionHeader*, 1> stack{header};
+        CHECK(try_inline_call(state, *call, 32, stack) == InlineDecision::recursive);
+    }
+
+    SUBCASE("calls itself") {
+        auto x = create_parameter(*ast_store, "x", &Int, TSL);
+        auto [header, body] = function_definition(state, {x}, nullptr, Undefined{}, false, TSL);
+        body->set_value(create_raw_call(*ast_store, header, {create_reference(*ast_store, x, TSL)}));
+        body->set_type(types->get_function_type(&Int, {&Int}, true));
+
+        auto call = create_raw_call(*ast_store, header, {arg});
+        CHECK(try_inline_call(state, *call, 32, {}) == InlineDecision::recursive);
+    }
+}
+
+TEST_CASE("inline_calls should inline nested calls and report the decisions") {
+    auto [state, ast_store, types] = setup();
+    auto [f, f_body] = create_doubling_function(state);
+
+    // let g = f (f 3)
+    auto inner = create_raw_call(*ast_store, f, {create_known_value(state, maps_Int{3}, TSL)});
+    auto [g, g_body] = create_let_definition(*ast_store, "g", 
+        create_raw_call(*ast_store, f, {inner}), TSL);
+
+    Profiler::global.reset();
+    Profiler::global.enable();
+
+    CHECK(inline_calls(state, *g_body) == 2);
+    CHECK(evaluate(*g_body) == KnownValue{maps_Int{12}});
+
+    auto sites = Profiler::global.inline_sites();
+    CHECK(Profiler::global.get_count(ProfilerCounter::calls_inlined) == 2);
+    REQUIRE(sites.size() == 2);
+    CHECK(sites.at(0).callee == f->name_string());
+    CHECK(sites.at(0).decision == inline_decision_name(InlineDecision::inlined));
+
+    Profiler::global.enable(false);
+    Profiler::global.reset();
+
+    // nothing left to inline
+    CHECK(inline_calls(state, *g_body) == 0);
+
+    SUBCASE("a budget of 0 turns inlining off") {
+        auto call = create_raw_call(*ast_store, f, {create_known_value(state, maps_Int{3}, TSL)});
+        auto [h, h_body] = create_let_definition(*ast_store, "h", call, TSL);
+
+        state.compiler_options_.inline_budget = 0;
+        CHECK(inline_calls(state, *h_body) == 0);
+    }
+}
+
+TEST_CASE("The inliner should handle deeply nested function bodies") {
+    auto [state, ast_store, types] = setup();
+    constexpr size_t DEPTH = 100000;
+
+    // \(x: Int) -> x + 1 + 1 + ... nested deeper than the stack would allow recursing into
+    auto x = create_parameter(*ast_store, "x", &Int, TSL);
+    Expression* value = create_reference(*ast_store, x, TSL);
+    for (size_t i = 0; i < DEPTH; i++)
+        value = create_raw_call(*ast_store, &plus_Int_, 
+            {value, create_known_value(state, maps_Int{1}, TSL)});
+
+    auto [f, f_body] = function_definition(state, {x}, nullptr, value, false, TSL);
+    f_body->set_type(types->get_function_type(&Int, {&Int}, true));
+    CHECK(inline_cost(*f_body) == 2 * DEPTH + 1);
+
+    // let g = f 5
+    auto arg = create_known_value(state, maps_Int{5}, TSL);
+    auto [g, g_body] = create_let_definition(*ast_store, "g", 
+        create_raw_call(*ast_store, f, {arg}), TSL);
+
+    state.compiler_options_.inline_budget = 4 * DEPTH;
+    CHECK(inline_calls(state, *g_body) == 1);
+
+    // the argument ends up at the bottom of the copied body
+    const Expression* bottom = std::get<Expression*>(g_body->body());
+    for (size_t i = 0; i < DEPTH; i++) {
+        REQUIRE(bottom->expression_type == ExpressionType::call);
+        bottom = std::get<1>(bottom->call_value()).front();
+    }
+    CHECK(*bottom == *arg);
+    CHECK(bottom != arg);
+}
@@ -73,4 +73,46 @@ TEST_CASE("Should resolve builtin value names into known values") {
     CHECK(identifier->expression_type == ExpressionType::known_value);
 
     CHECK(*identifier->known_value_value() == KnownValue{"val3"});
-}
\ No newline at end of file
+}
+TEST_CASE("Parallel name resolution should give the same result as the serial one") {
+    auto [state, ast_store, scope, _] = setup();
+    state.compiler_options_.thread_count = 4;
+
+    const string names[] = {"jii1", "hoo2", "jii3", "hoo1"};
+    vector<Expression*> identifiers{};
+
+    for (size_t i = 0; i < 3 * NAME_RESOLUTION_BATCH_SIZE; i++)
+        identifiers.push_back(create_identifier(ast_store, &scope, names[i % 4], TSL));
+
+    SUBCASE("Resolves everything") {
+        CHECK(resolve_identifiers(state, scope, identifiers, test_builtins));
+
+        for (size_t i = 0; i < identifiers.size(); i++) {
+            if (i % 2 == 0) {
+                CHECK(identifiers[i]->expression_type == ExpressionType::reference);
+            } else {
+                CHECK(identifiers[i]->expression_type == ExpressionType::known_value);
+            }
+        }
+
+        CHECK(*identifiers[2]->reference_value() == bex3);
+        CHECK(*identifiers[1]->known_value_value() == KnownValue{"val2"});
+    }
+
+    SUBCASE("Stops at the first unknown name in source order") {
+        size_t first_unknown = NAME_RESOLUTION_BATCH_SIZE + 7;
+        size_t second_unknown = 2 * NAME_RESOLUTION_BATCH_SIZE + 3;
+
+        identifiers[second_unknown] = create_identifier(ast_store, &scope, "nope", TSL);
+        identifiers[first_unknown] = create_identifier(ast_store, &scope, "nope", TSL);
+
+        CHECK(!resolve_identifiers(state, scope, identifiers, test_builtins));
+
+        CHECK(identifiers[first_unknown - 1]->expression_type != ExpressionType::identifier);
+        CHECK(identifiers[first_unknown]->expression_type == ExpressionType::identifier);
+        CHECK(identifiers[first_unknown + 1]->expression_type == ExpressionType::identifier);
+        CHECK(identifiers[second_unknown]->expression_type == ExpressionType::identifier);
+    }
+
+    CHECK(!state.types_->is_frozen());
+}
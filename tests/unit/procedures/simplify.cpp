@@ -0,0 +1,150 @@
+#include "doctest.h"
+
+#include <variant>
+
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/statement.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/procedures/simplify.hh"
+
+using namespace Maps;
+using namespace std;
+
+namespace {
+
+Statement* create_int_statement(CompilationState& state, maps_Int value) {
+    return create_expression_statement(*state.ast_store_,
+        create_known_value(state, value, TSL), TSL);
+}
+
+DefinitionBody* create_statement_definition(AST_Store& ast_store, Statement* statement) {
+    auto [header, body] = create_let_definition(ast_store, "test", LetDefinitionValue{statement},
+        TSL);
+    return body;
+}
+
+Statement* body_statement(const DefinitionBody& definition) {
+    REQUIRE(std::holds_alternative<Statement*>(definition.body()));
+    return std::get<Statement*>(definition.body());
+}
+
+} // namespace
+
+TEST_CASE("simplify should flatten nested blocks and drop empty statements") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Statement* innermost = create_block(ast_store, {create_int_statement(state, 2)}, TSL);
+    Statement* inner = create_block(ast_store, {create_int_statement(state, 1), innermost}, TSL);
+    Statement* root = create_block(ast_store, {create_empty_statement(ast_store, TSL), inner,
+        create_return_statement(ast_store, create_known_value(state, 3, TSL), TSL)}, TSL);
+
+    auto definition = create_statement_definition(ast_store, root);
+    auto counts = simplify(ast_store, *definition);
+
+    REQUIRE(counts);
+    CHECK(counts->empty_statements_removed == 1);
+    CHECK(counts->blocks_flattened == 2);
+    CHECK(counts->bodies_collapsed == 0);
+
+    CHECK(body_statement(*definition) == root);
+    const auto& block = root->get_value<Block>();
+    REQUIRE(block.size() == 3);
+    CHECK(block.at(0)->statement_type == StatementType::expression_statement);
+    CHECK(block.at(1)->statement_type == StatementType::expression_statement);
+    CHECK(block.at(2)->statement_type == StatementType::return_);
+
+    CHECK(inner->statement_type == StatementType::deleted);
+
+    // nothing left to do
+    CHECK(simplify(ast_store, *definition)->total() == 0);
+}
+
+TEST_CASE("simplify should fold conditionals with known conditions") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Statement* taken = create_int_statement(state, 1);
+    Statement* dropped = create_int_statement(state, 2);
+    Expression* dropped_value = std::get<Expression*>(dropped->value);
+
+    Statement* root = create_block(ast_store, {
+        create_if_else(ast_store, create_known_value(state, true, TSL), taken, dropped, TSL),
+        create_if(ast_store, create_known_value(state, false, TSL),
+            create_int_statement(state, 3), TSL),
+        create_return_statement(ast_store, create_known_value(state, 4, TSL), TSL)
+    }, TSL);
+
+    auto definition = create_statement_definition(ast_store, root);
+    auto counts = simplify(ast_store, *definition);
+
+    REQUIRE(counts);
+    CHECK(counts->conditionals_folded == 2);
+    // the false one left behind an empty statement
+    CHECK(counts->empty_statements_removed == 1);
+
+    const auto& block = root->get_value<Block>();
+    REQUIRE(block.size() == 2);
+    CHECK(block.at(0)->statement_type == StatementType::expression_statement);
+    CHECK(*std::get<Expression*>(block.at(0)->value)->known_value_value() == KnownValue{1});
+
+    CHECK(dropped->statement_type == StatementType::deleted);
+    CHECK(dropped_value->expression_type == ExpressionType::deleted);
+}
+
+TEST_CASE("simplify should collapse a body down to an expression if it can") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    SUBCASE("return in nested blocks") {
+        Expression* value = create_known_value(state, 4, TSL);
+        Statement* root = create_block(ast_store, {create_block(ast_store,
+            {create_return_statement(ast_store, value, TSL)}, TSL)}, TSL);
+
+        auto definition = create_statement_definition(ast_store, root);
+        auto counts = simplify(ast_store, *definition);
+
+        REQUIRE(counts);
+        CHECK(counts->bodies_collapsed == 1);
+        REQUIRE(std::holds_alternative<Expression*>(definition->body()));
+        CHECK(std::get<Expression*>(definition->body()) == value);
+    }
+
+    SUBCASE("empty blocks stay statements") {
+        Statement* root = create_block(ast_store, {create_block(ast_store, {}, TSL)}, TSL);
+
+        auto definition = create_statement_definition(ast_store, root);
+        auto counts = simplify(ast_store, *definition);
+
+        REQUIRE(counts);
+        CHECK(body_statement(*definition)->statement_type == StatementType::empty);
+    }
+
+    SUBCASE("errors fail") {
+        auto [header, definition] = create_let_definition(ast_store, "error",
+            LetDefinitionValue{Error{}}, TSL);
+        CHECK(!simplify(ast_store, *definition));
+    }
+}
+
+TEST_CASE("simplify should handle deeply nested blocks without recursing") {
+    auto [state, types] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    Expression* value = create_known_value(state, 5, TSL);
+    Statement* statement = create_return_statement(ast_store, value, TSL);
+
+    for (int i = 0; i < 100'000; i++)
+        statement = create_block(ast_store, {statement}, TSL);
+
+    auto definition = create_statement_definition(ast_store, statement);
+    auto counts = simplify(ast_store, *definition);
+
+    REQUIRE(counts);
+    CHECK(counts->blocks_flattened == 100'000);
+    REQUIRE(std::holds_alternative<Expression*>(definition->body()));
+    CHECK(std::get<Expression*>(definition->body()) == value);
+}
@@ -0,0 +1,26 @@
+#ifndef __PROCEDURES_TEST_HELPERS_HH
+#define __PROCEDURES_TEST_HELPERS_HH
+
+#include <vector>
+
+#include "mapsc/source_location.hh"
+#include "mapsc/types/type_defs.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/expression.hh"
+
+// Helpers shared by the procedure tests
+
+namespace Maps::Tests {
+
+// A call expression with the given type, built directly rather than through create_call so
+// that the arguments are taken as they are
+inline Expression* create_raw_call(AST_Store& ast_store, const DefinitionHeader* callee,
+    std::vector<Expression*> args, const Type* type = &Int) {
+
+    return ast_store.allocate_expression(Expression{ExpressionType::call,
+        CallExpressionValue{callee, args}, type, TSL});
+}
+
+} // namespace Maps::Tests
+
+#endif
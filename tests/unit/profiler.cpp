@@ -0,0 +1,138 @@
+#include "doctest.h"
+
+#include <sstream>
+
+#include "mapsc/profiler.hh"
+
+using namespace Maps;
+
+TEST_CASE("Profiler should do nothing when disabled") {
+    Profiler::global.reset();
+    Profiler::global.enable(false);
+
+    {
+        ProfileScope profile{"disabled"};
+        Profiler::count(ProfilerCounter::tokens_lexed, 5);
+    }
+
+    CHECK(Profiler::global.events().empty());
+    CHECK(Profiler::global.get_count(ProfilerCounter::tokens_lexed) == 0);
+}
+
+TEST_CASE("ProfileScope should record an event per scope") {
+    Profiler::global.reset();
+    Profiler::global.enable();
+
+    {
+        ProfileScope outer{"outer"};
+        ProfileScope inner{"inner", "transform"};
+        Profiler::count(ProfilerCounter::nodes_allocated);
+        Profiler::count(ProfilerCounter::nodes_allocated, 2);
+    }
+
+    Profiler::global.enable(false);
+
+    auto events = Profiler::global.events();
+    REQUIRE(events.size() == 2);
+    CHECK(events.at(0).name == "inner");
+    CHECK(events.at(0).category == "transform");
+    CHECK(events.at(1).name == "outer");
+    CHECK(events.at(1).duration >= events.at(0).duration);
+    CHECK(Profiler::global.get_count(ProfilerCounter::nodes_allocated) == 3);
+
+    std::stringstream report{};
+    Profiler::global.write_report(report);
+    CHECK(report.str().find("outer") != std::string::npos);
+    CHECK(report.str().find("nodes allocated") != std::string::npos);
+
+    std::stringstream trace{};
+    Profiler::global.write_chrome_trace(trace);
+    CHECK(trace.str().starts_with("{\"traceEvents\":["));
+    CHECK(trace.str().find("\"name\":\"inner\",\"cat\":\"transform\",\"ph\":\"X\"") != 
+        std::string::npos);
+
+    Profiler::global.reset();
+}
+
+TEST_CASE("Profiler should keep the memory high-water mark per stage") {
+    Profiler::global.reset();
+
+    MemoryStats small{};
+    small.add("expression:call", 100, 20);
+
+    MemoryStats large = small;
+    large.add("expression:call", 100, 80);
+    large.add_overhead(16);
+
+    Profiler::global.sample_memory("layer1", large);
+    Profiler::global.sample_memory("layer1", small);
+    Profiler::global.sample_memory("layer2", small);
+
+    CHECK(Profiler::global.memory_peak("layer1") == 316);
+    CHECK(Profiler::global.memory_peak("layer2") == 120);
+    CHECK(!Profiler::global.memory_peak("ir"));
+
+    std::stringstream report{};
+    Profiler::global.write_report(report);
+    CHECK(report.str().find("peak memory") != std::string::npos);
+    CHECK(report.str().find("expression:call") != std::string::npos);
+
+    std::stringstream trace{};
+    Profiler::global.write_chrome_trace(trace);
+    CHECK(trace.str().find("{\"name\":\"memory\",\"ph\":\"C\"") != std::string::npos);
+
+    Profiler::global.reset();
+}
+
+TEST_CASE("Profiler should sum up transform pass stats by name") {
+    Profiler::global.reset();
+
+    Profiler::global.record_pass("concretize", std::chrono::microseconds{5}, 10, 2);
+    Profiler::global.record_pass("simplify", std::chrono::microseconds{1}, 4, 0);
+    Profiler::global.record_pass("concretize", std::chrono::microseconds{5}, 3, 1);
+
+    auto totals = Profiler::global.pass_totals();
+    REQUIRE(totals.size() == 2);
+    CHECK(totals.at(0).name == "concretize");
+    CHECK(totals.at(0).duration == std::chrono::microseconds{10});
+    CHECK(totals.at(0).visits == 13);
+    CHECK(totals.at(0).changes == 3);
+    CHECK(totals.at(1).name == "simplify");
+
+    std::stringstream report{};
+    Profiler::global.write_report(report);
+    CHECK(report.str().find("transform passes") != std::string::npos);
+
+    Profiler::global.reset();
+    CHECK(Profiler::global.pass_totals().empty());
+}
+
+TEST_CASE("MemoryStats should merge usages by kind") {
+    MemoryStats stats{};
+    stats.add("scope", 10, 5);
+    stats.add("scope", 10);
+
+    MemoryStats other{};
+    other.add("scope", 10, 1);
+    other.add("type:function", 40, 8);
+    other.add_overhead(24);
+
+    stats += other;
+
+    CHECK(stats.get("scope") == MemoryUsage{3, 30, 6});
+    CHECK(stats.get("type:function") == MemoryUsage{1, 40, 8});
+    CHECK(!stats.get("statement:block"));
+    CHECK(stats.node_count() == 4);
+    CHECK(stats.total_bytes() == 30 + 6 + 40 + 8 + 24);
+}
+
+TEST_CASE("heap_bytes should not count small strings") {
+    CHECK(heap_bytes(std::string{"a"}) == 0);
+
+    std::string long_string(100, 'x');
+    CHECK(heap_bytes(long_string) == long_string.capacity() + 1);
+
+    std::vector<int> ints{};
+    ints.reserve(10);
+    CHECK(heap_bytes(ints) == 10 * sizeof(int));
+}
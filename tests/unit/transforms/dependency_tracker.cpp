@@ -0,0 +1,71 @@
+#include "doctest.h"
+
+#include <vector>
+
+#include "mapsc/compilation_state.hh"
+#include "mapsc/dependency_tracker.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/scope.hh"
+#include "mapsc/ast/value.hh"
+
+using namespace Maps;
+using namespace std;
+
+namespace {
+
+DefinitionHeader* add_definition(AST_Store& ast_store, Scope& scope, const string& name,
+    Expression* value) {
+
+    auto [header, body] = create_let_definition(ast_store, name, value, TSL);
+    scope.create_identifier(header);
+    return header;
+}
+
+void mark_all_clean(const Scope& scope) {
+    for (auto definition: scope)
+        (*definition->body_)->mark_clean();
+}
+
+} // namespace
+
+TEST_CASE("collect_references should list each referenced definition once") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+    Scope scope{};
+
+    auto a = add_definition(ast_store, scope, "a", create_numeric_literal(ast_store, "1", TSL));
+    auto b = add_definition(ast_store, scope, "b", create_reference(ast_store, a, TSL));
+
+    CHECK(collect_references(**a->body_).empty());
+    CHECK(collect_references(**b->body_) == vector<const DefinitionHeader*>{a});
+}
+
+TEST_CASE("DependencyTracker should only hand out new and dirty definitions") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+    Scope scope{};
+    DependencyTracker tracker{};
+
+    auto a = add_definition(ast_store, scope, "a", create_numeric_literal(ast_store, "1", TSL));
+    auto b = add_definition(ast_store, scope, "b", create_reference(ast_store, a, TSL));
+
+    CHECK((*a->body_)->is_dirty());
+    CHECK(tracker.dirty_definitions(scope) == vector<DefinitionHeader*>{a, b});
+
+    // b stays dirty, as if its transforms had failed
+    (*a->body_)->mark_clean();
+    tracker.commit(scope);
+
+    auto c = add_definition(ast_store, scope, "c", create_reference(ast_store, b, TSL));
+    CHECK(tracker.dirty_definitions(scope) == vector<DefinitionHeader*>{b, c});
+
+    mark_all_clean(scope);
+    tracker.commit(scope);
+
+    CHECK(tracker.dirty_definitions(scope).empty());
+    CHECK(tracker.dependencies(*c).size() == 1);
+    CHECK(tracker.dependencies(*c).front() == b);
+}
@@ -0,0 +1,269 @@
+#include "doctest.h"
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "mapsc/builtins.hh"
+#include "mapsc/compilation_state.hh"
+#include "mapsc/pass_manager.hh"
+#include "mapsc/profiler.hh"
+#include "mapsc/transform_stage.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/call_expression.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/expression.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/scope.hh"
+#include "mapsc/ast/statement.hh"
+#include "mapsc/ast/value.hh"
+
+using namespace Maps;
+using namespace std;
+
+namespace {
+
+TransformPass counting_pass(string name, vector<string>& visited, bool fusable = true) {
+    return TransformPass{
+        .name = name,
+        .expression_transform = [name, &visited](CompilationState&, Expression& expression) {
+            visited.push_back(name + ":" + (expression.expression_type ==
+                ExpressionType::layer2_expression ? "termed" : string{expression.string_value()}));
+            return PassResult::unchanged;
+        },
+        .fusable = fusable
+    };
+}
+
+} // namespace
+
+TEST_CASE("PassManager should fuse consecutive fusable passes into one traversal") {
+    vector<string> visited{};
+
+    PassManager pass_manager{};
+    pass_manager.add_pass(counting_pass("a", visited));
+    pass_manager.add_pass(counting_pass("b", visited));
+    pass_manager.add_pass(counting_pass("c", visited, false));
+    pass_manager.add_pass(counting_pass("d", visited));
+
+    CHECK(pass_manager.traversals() == vector<vector<size_t>>{{0, 1}, {2, 3}});
+
+    pass_manager.set_enabled("c", false);
+    CHECK(pass_manager.traversals() == vector<vector<size_t>>{{0, 1, 3}});
+
+    pass_manager.set_enabled("a", false);
+    pass_manager.set_enabled("b", false);
+    pass_manager.set_enabled("d", false);
+    CHECK(pass_manager.traversals().empty());
+}
+
+TEST_CASE("PassManager::apply_overrides should report unknown passes") {
+    vector<string> visited{};
+
+    PassManager pass_manager{};
+    pass_manager.add_pass(counting_pass("a", visited));
+    pass_manager.add_pass(counting_pass("b", visited));
+
+    CHECK(pass_manager.apply_overrides({{"a", false}}));
+    CHECK(!pass_manager.is_enabled("a"));
+    CHECK(pass_manager.is_enabled("b"));
+
+    CHECK(pass_manager.apply_overrides({{"a", true}, {"b", false}}));
+    CHECK(pass_manager.is_enabled("a"));
+    CHECK(!pass_manager.is_enabled("b"));
+
+    CHECK(!pass_manager.apply_overrides({{"nope", true}, {"b", true}}));
+    CHECK(pass_manager.is_enabled("b"));
+}
+
+TEST_CASE("PassManager should run fused passes on each node in post-order") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+    Scope scope{};
+
+    vector<Expression*> terms{
+        create_numeric_literal(ast_store, "1", TSL),
+        create_numeric_literal(ast_store, "2", TSL)
+    };
+    Expression* termed = ast_store.allocate_expression(Expression{
+        ExpressionType::layer2_expression, TermedExpressionValue{terms, &scope}, TSL});
+    auto [header, body] = create_let_definition(ast_store, "x", termed, TSL);
+
+    vector<string> visited{};
+    PassManager pass_manager{};
+    pass_manager.add_pass(counting_pass("a", visited));
+    pass_manager.add_pass(counting_pass("b", visited));
+
+    CHECK(pass_manager.run(state, *body));
+    CHECK(visited == vector<string>{"a:1", "b:1", "a:2", "b:2", "a:termed", "b:termed"});
+
+    CHECK(pass_manager.stats(0).visits == 3);
+    CHECK(pass_manager.stats(0).changes == 0);
+
+    pass_manager.flush_stats();
+    CHECK(pass_manager.stats(0).visits == 0);
+}
+
+TEST_CASE("PassManager should put changed nodes back through every fused pass") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+    Scope scope{};
+
+    Expression* literal = create_numeric_literal(ast_store, "1", TSL);
+    Expression* inner = ast_store.allocate_expression(Expression{
+        ExpressionType::layer2_expression, TermedExpressionValue{{literal}, &scope}, TSL});
+    Expression* outer = ast_store.allocate_expression(Expression{
+        ExpressionType::layer2_expression, TermedExpressionValue{{inner}, &scope}, TSL});
+    auto [header, body] = create_let_definition(ast_store, "x", outer, TSL);
+
+    vector<string> order{};
+
+    PassManager pass_manager{};
+    // replaces single term expressions with the term
+    pass_manager.add_pass({
+        .name = "unwrap",
+        .expression_transform = [](CompilationState&, Expression& expression) {
+            if (expression.expression_type != ExpressionType::layer2_expression ||
+                expression.terms().size() != 1)
+                return PassResult::unchanged;
+
+            Expression term = *expression.terms().front();
+            expression = term;
+            return PassResult::changed;
+        }
+    });
+    pass_manager.add_pass({
+        .name = "bump",
+        .expression_transform = [](CompilationState&, Expression& expression) {
+            if (expression.expression_type != ExpressionType::known_value ||
+                expression.string_value() != "1")
+                return PassResult::unchanged;
+
+            expression.value = "2";
+            return PassResult::changed;
+        },
+        .definition_transform = [&order](CompilationState&, DefinitionBody& definition) {
+            order.push_back("definition after " + string{
+                std::get<Expression*>(definition.get_value())->string_value()});
+            return PassResult::unchanged;
+        }
+    });
+
+    CHECK(pass_manager.run(state, *body));
+
+    CHECK(outer->expression_type == ExpressionType::known_value);
+    CHECK(outer->string_value() == "2");
+    CHECK(pass_manager.stats(0).changes == 2);
+    CHECK(pass_manager.stats(1).changes == 1);
+    CHECK(order == vector<string>{"definition after 2"});
+}
+
+TEST_CASE("PassManager should stop at the first failing pass") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto [header, body] = create_let_definition(ast_store, "x",
+        create_numeric_literal(ast_store, "1", TSL), TSL);
+
+    bool later_pass_ran = false;
+
+    PassManager pass_manager{};
+    pass_manager.add_pass({
+        .name = "fail",
+        .definition_transform = [](CompilationState&, DefinitionBody&) {
+            return PassResult::failed;
+        }
+    });
+    pass_manager.add_pass({
+        .name = "later",
+        .definition_transform = [&later_pass_ran](CompilationState&, DefinitionBody&) {
+            later_pass_ran = true;
+            return PassResult::unchanged;
+        },
+        .fusable = false
+    });
+
+    CHECK(!pass_manager.run(state, *body));
+    CHECK(!later_pass_ran);
+}
+
+TEST_CASE("The default transform passes should simplify, inline and concretize, then fold constants and eliminate common subexpressions in one walk") {
+    auto pass_manager = create_transform_pass_manager();
+
+    CHECK(pass_manager.is_enabled("simplify"));
+    CHECK(pass_manager.is_enabled("inline"));
+    CHECK(pass_manager.is_enabled("concretize"));
+    CHECK(pass_manager.is_enabled("constant_fold"));
+    CHECK(pass_manager.is_enabled("cse"));
+    CHECK(!pass_manager.is_enabled("type_check"));
+
+    CHECK(pass_manager.traversals() == vector<vector<size_t>>{{0}, {1, 2}, {3, 4}});
+
+    pass_manager.set_enabled("type_check", true);
+    CHECK(pass_manager.traversals() == vector<vector<size_t>>{{0}, {1, 2}, {3, 4, 5}});
+}
+
+TEST_CASE("The default transform passes should simplify a body and then fold it") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto sum = create_call(state, &plus_Int_, {create_known_value(state, maps_Int{3}, TSL),
+        create_known_value(state, maps_Int{4}, TSL)}, TSL);
+    REQUIRE(sum);
+
+    Statement* root = create_block(ast_store, {create_empty_statement(ast_store, TSL),
+        create_return_statement(ast_store, *sum, TSL)}, TSL);
+    auto [header, body] = create_let_definition(ast_store, "x", LetDefinitionValue{root}, TSL);
+
+    auto pass_manager = create_transform_pass_manager();
+    REQUIRE(pass_manager.run(state, *body));
+
+    REQUIRE(std::holds_alternative<Expression*>(body->body()));
+    Expression* value = std::get<Expression*>(body->body());
+    CHECK(value->expression_type == ExpressionType::known_value);
+    CHECK(std::get<maps_Int>(value->value) == 7);
+
+    // the block dropping its empty statement and the body being collapsed
+    CHECK(pass_manager.stats(0).changes == 2);
+    // the call
+    CHECK(pass_manager.stats(3).changes == 1);
+    // cse got the body once the walk was done with it
+    CHECK(pass_manager.stats(4).visits == 1);
+}
+
+TEST_CASE("Enabling type_check should let calls and references through") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto [a_header, a_body] = create_let_definition(ast_store, "a", 
+        LetDefinitionValue{create_known_value(state, maps_Int{3}, TSL)}, TSL);
+
+    auto sum = create_call(state, &plus_Int_, {create_reference(ast_store, a_header, TSL),
+        create_known_value(state, maps_Int{4}, TSL)}, TSL);
+    REQUIRE(sum);
+    auto [header, body] = create_let_definition(ast_store, "x", LetDefinitionValue{*sum}, TSL);
+
+    auto pass_manager = create_transform_pass_manager();
+    pass_manager.set_enabled("constant_fold", false);
+    pass_manager.set_enabled("type_check", true);
+
+    CHECK(pass_manager.run(state, *body));
+    CHECK(pass_manager.stats(5).visits > 0);
+}
+
+TEST_CASE("PassManager should only time the passes while profiling") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    REQUIRE(!Profiler::global.is_enabled());
+
+    auto [header, body] = create_let_definition(ast_store, "x", 
+        LetDefinitionValue{create_known_value(state, maps_Int{3}, TSL)}, TSL);
+
+    auto pass_manager = create_transform_pass_manager();
+    REQUIRE(pass_manager.run(state, *body));
+
+    CHECK(pass_manager.stats(3).visits > 0);
+    CHECK(pass_manager.stats(3).duration == Profiler::Clock::duration::zero());
+}
@@ -0,0 +1,128 @@
+#include "doctest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mapsc/compilation_state.hh"
+#include "mapsc/ast/ast_store.hh"
+#include "mapsc/ast/definition_body.hh"
+#include "mapsc/ast/identifier.hh"
+#include "mapsc/ast/let_definition.hh"
+#include "mapsc/ast/reference.hh"
+#include "mapsc/ast/value.hh"
+#include "mapsc/transform_scheduler.hh"
+
+using namespace Maps;
+using namespace std;
+
+namespace {
+
+size_t component_of(const DefinitionGraph& graph, size_t index) {
+    for (size_t component = 0; component < graph.components.size(); component++) {
+        const auto& members = graph.components[component];
+        if (std::find(members.begin(), members.end(), index) != members.end())
+            return component;
+    }
+
+    FAIL("definition not in any component");
+    return 0;
+}
+
+vector<DefinitionBody*> create_literal_definitions(AST_Store& ast_store, size_t count) {
+    vector<DefinitionBody*> definitions{};
+
+    for (size_t i = 0; i < count; i++) {
+        auto [header, body] = create_let_definition(ast_store, "x" + to_string(i), 
+            create_numeric_literal(ast_store, to_string(i), TSL), TSL);
+        definitions.push_back(body);
+    }
+
+    return definitions;
+}
+
+} // namespace
+
+TEST_CASE("build_definition_graph should order components by dependency") {
+    auto [state, _] = CompilationState::create_test_state();
+    auto& ast_store = *state.ast_store_;
+
+    auto [a, a_body] = create_let_definition(ast_store, "a", 
+        create_numeric_literal(ast_store, "1", TSL), TSL);
+    auto [c, c_body] = create_let_definition(ast_store, "c", create_reference(ast_store, a, TSL), TSL);
+    auto [b, b_body] = create_let_definition(ast_store, "b", 
+        create_reference(ast_store, c, TSL), TSL);
+
+    // d and e refer to each other
+    Expression* d_value = create_numeric_literal(ast_store, "2", TSL);
+    auto [d, d_body] = create_let_definition(ast_store, "d", d_value, TSL);
+    auto [e, e_body] = create_let_definition(ast_store, "e", create_reference(ast_store, d, TSL), TSL);
+    *d_value = *create_reference(ast_store, e, TSL);
+
+    vector<DefinitionBody*> definitions{c_body, a_body, b_body, d_body, e_body};
+    auto graph = build_definition_graph(definitions);
+
+    REQUIRE(graph.components.size() == 4);
+    CHECK(graph.dependents.size() == 4);
+    CHECK(graph.dependency_counts.size() == 4);
+
+    size_t a_component = component_of(graph, 1);
+    size_t b_component = component_of(graph, 2);
+    size_t c_component = component_of(graph, 0);
+    size_t de_component = component_of(graph, 3);
+
+    CHECK(a_component < c_component);
+    CHECK(c_component < b_component);
+    CHECK(graph.components[de_component] == vector<size_t>{3, 4});
+
+    CHECK(graph.dependency_counts[a_component] == 0);
+    CHECK(graph.dependency_counts[c_component] == 1);
+    CHECK(graph.dependency_counts[b_component] == 1);
+    CHECK(graph.dependency_counts[de_component] == 0);
+
+    CHECK(graph.dependents[a_component] == vector<size_t>{c_component});
+    CHECK(graph.dependents[b_component].empty());
+}
+
+TEST_CASE("schedule_transforms should run the transforms on every definition") {
+    for (unsigned int thread_count: {1, 4}) {
+        CAPTURE(thread_count);
+
+        auto [state, _] = CompilationState::create_test_state();
+        Scope scope{};
+        auto definitions = create_literal_definitions(*state.ast_store_, 32);
+
+        CHECK(schedule_transforms(state, scope, definitions, thread_count));
+
+        for (auto definition: definitions)
+            CHECK(definition->get_type()->is_concrete());
+    }
+}
+
+TEST_CASE("schedule_transforms should carry on with independent definitions after a failure") {
+    for (unsigned int thread_count: {1, 4}) {
+        CAPTURE(thread_count);
+
+        auto [state, _] = CompilationState::create_test_state();
+        auto& ast_store = *state.ast_store_;
+        Scope scope{};
+        auto definitions = create_literal_definitions(ast_store, 32);
+
+        // concretize can't handle a bare identifier
+        auto [broken, broken_body] = create_let_definition(ast_store, "broken", 
+            create_identifier(ast_store, &scope, "what", TSL), TSL);
+        auto [dependent, dependent_body] = create_let_definition(ast_store, "dependent", 
+            create_reference(ast_store, broken, TSL), TSL);
+
+        definitions.insert(definitions.begin() + 5, broken_body);
+        definitions.push_back(dependent_body);
+
+        CHECK(!schedule_transforms(state, scope, definitions, thread_count));
+
+        for (auto definition: definitions) {
+            if (definition == broken_body || definition == dependent_body)
+                continue;
+
+            CHECK(definition->get_type()->is_concrete());
+        }
+    }
+}
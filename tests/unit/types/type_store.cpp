@@ -4,6 +4,7 @@
 
 #include "mapsc/types/type_defs.hh"
 #include "mapsc/types/type_store.hh"
+#include "mapsc/types/function_type.hh"
 
 using namespace std;
 using namespace Maps;
@@ -64,3 +65,38 @@ TEST_CASE("Should get a compile-time functiontype without issue") {
     CHECK(function_type == &test_ct_function_type);
 }
 
+TEST_CASE("TypeStore::memory_stats should count the created function types") {
+    TypeStore types{};
+    auto builtin_entries = types.memory_stats();
+    CHECK(builtin_entries.node_count() == 0);
+
+    types.get_function_type(&TestingType, array{&TestingType, &TestingType}, true);
+    auto stats = types.memory_stats();
+
+    auto function_types = stats.get("type:function");
+    REQUIRE(function_types);
+    CHECK(function_types->count == 1);
+    CHECK(function_types->node_bytes == sizeof(RTFunctionType));
+    CHECK(function_types->payload_bytes >= 2 * sizeof(const Type*));
+    CHECK(stats.overhead_bytes() > builtin_entries.overhead_bytes());
+}
+
+TEST_CASE("TypeStore::Freeze should be undone at the end of its scope") {
+    TypeStore types{};
+    CHECK(!types.is_frozen());
+
+    {
+        TypeStore::Freeze freeze{types};
+        CHECK(types.is_frozen());
+        CHECK(types.get("Int"));
+
+        {
+            TypeStore::Freeze inner_freeze{types};
+            CHECK(types.is_frozen());
+        }
+
+        CHECK(types.is_frozen());
+    }
+
+    CHECK(!types.is_frozen());
+}